@@ -0,0 +1,35 @@
+#include <stdlib.h>
+
+#include "bench_alloc.h"
+
+/**
+ * Counts the calls of malloc, calloc and realloc by wrapping them at link time (-Wl,--wrap=malloc,...).
+ */
+
+bool count_allocations = false;
+unsigned long long allocation_count = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    if(count_allocations)
+        allocation_count++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    if(count_allocations)
+        allocation_count++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if(count_allocations)
+        allocation_count++;
+    return __real_realloc(ptr, size);
+}
@@ -0,0 +1,11 @@
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#include <stdbool.h>
+
+/// Allocations are only counted while count_allocations is set, the benchmarks have to be linked with
+/// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+extern bool count_allocations;
+extern unsigned long long allocation_count;
+
+#endif
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "stats.h"
+#include "snmp_ber.h"
+#include "sim_ber.h"
+#include "bench_alloc.h"
+
+/**
+ * Micro benchmark of the BER codec.
+ *
+ * Decodes generated responses with 1 to 64 LLDP-MIB/IF-MIB varbinds (snmp_ber_decode_pdu, snmp_ber_next_varbind and
+ * snmp_ber_decode_oid on each varbind) and encodes requests from templates. Allocations are counted by wrapping
+ * malloc, calloc and realloc at link time (bench_alloc.c), the codec itself must not allocate.
+ */
+
+static void usage(void)
+{
+    printf("Usage: bench_ber [-n PDUs per measurement]\n");
+}
+
+/**
+ * @brief Appends a varbind of an lldpRemTable or ifTable column, the value type depends on the column.
+ */
+static bool bench_put_varbind(sim_ber_buffer_t *buffer, int index)
+{
+    static const char sys_name[] = "switch-0042.plant.local";
+    static const uint8_t mac[] = { 0x00, 0x1B, 0x1B, 0x42, 0x00, 0x07 };
+    uint32_t oid[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 0, 0 };
+    uint8_t value_data[64];
+    sim_ber_buffer_t value = { value_data, 0, sizeof(value_data) };
+
+    oid[10] = index / 4 + 1;
+
+    switch(index % 4)
+    {
+        case 0:
+            oid[9] = 2; /* ifDescr */
+            sim_ber_put_header(&value, BER_OCTET_STRING, sizeof(sys_name) - 1);
+            sim_ber_put(&value, sys_name, sizeof(sys_name) - 1);
+            break;
+        case 1:
+            oid[9] = 3; /* ifType */
+            sim_ber_put_integer(&value, 6);
+            break;
+        case 2:
+            oid[9] = 5; /* ifSpeed */
+            sim_ber_put_unsigned(&value, BER_GAUGE32, 1000000000);
+            break;
+        default:
+            oid[9] = 6; /* ifPhysAddress */
+            sim_ber_put_header(&value, BER_OCTET_STRING, sizeof(mac));
+            sim_ber_put(&value, mac, sizeof(mac));
+            break;
+    }
+
+    uint8_t oid_ber[64];
+    int oid_ber_len = sim_ber_encode_oid(oid, 11, oid_ber);
+
+    return sim_ber_put_header(buffer, BER_SEQUENCE, sim_ber_header_len(oid_ber_len) + oid_ber_len + value.len)
+        && sim_ber_put_header(buffer, BER_OID, oid_ber_len)
+        && sim_ber_put(buffer, oid_ber, oid_ber_len)
+        && sim_ber_put(buffer, value.data, value.len);
+}
+
+/**
+ * @brief Builds a SNMPv2c response with varbind_count varbinds.
+ * @return the length of the response.
+ */
+static size_t bench_build_response(uint8_t *out, size_t capacity, int varbind_count)
+{
+    uint8_t varbinds_data[8192];
+    sim_ber_buffer_t varbinds = { varbinds_data, 0, sizeof(varbinds_data) };
+
+    for(int i = 0; i < varbind_count; i++)
+        bench_put_varbind(&varbinds, i);
+
+    uint8_t pdu_data[64];
+    sim_ber_buffer_t pdu = { pdu_data, 0, sizeof(pdu_data) };
+    sim_ber_put_integer(&pdu, snmp_ber_request_id(12345));
+    sim_ber_put_integer(&pdu, 0);
+    sim_ber_put_integer(&pdu, 0);
+    sim_ber_put_header(&pdu, BER_SEQUENCE, varbinds.len);
+
+    size_t pdu_len = pdu.len + varbinds.len;
+    size_t message_len = 3 + 8 + sim_ber_header_len(pdu_len) + pdu_len;
+
+    sim_ber_buffer_t message = { out, 0, capacity };
+    sim_ber_put_header(&message, BER_SEQUENCE, message_len);
+    sim_ber_put_integer(&message, 1);
+    sim_ber_put_header(&message, BER_OCTET_STRING, 6);
+    sim_ber_put(&message, "public", 6);
+    sim_ber_put_header(&message, SNMP_PDU_RESPONSE, pdu_len);
+    sim_ber_put(&message, pdu.data, pdu.len);
+    sim_ber_put(&message, varbinds.data, varbinds.len);
+
+    return message.len;
+}
+
+/**
+ * @brief Decodes a response pdu_count times and prints a line with the results.
+ */
+static void bench_decode(int varbind_count, int pdu_count)
+{
+    uint8_t packet[8192];
+    size_t packet_len = bench_build_response(packet, sizeof(packet), varbind_count);
+    uint32_t oid[SNMP_BER_MAX_OID_LEN];
+    unsigned long long checksum = 0;
+    int errors = 0;
+
+    allocation_count = 0;
+    count_allocations = true;
+    uint64_t start_us = stats_now_us();
+
+    for(int i = 0; i < pdu_count; i++)
+    {
+        snmp_ber_pdu_t pdu;
+        snmp_ber_varbind_t varbind;
+        int status;
+
+        if(!snmp_ber_decode_pdu(packet, packet_len, &pdu))
+        {
+            errors++;
+            continue;
+        }
+
+        while((status = snmp_ber_next_varbind(&pdu, &varbind)) == 1)
+        {
+            int oid_len = snmp_ber_decode_oid(varbind.oid, varbind.oid_len, oid);
+            checksum += oid[oid_len - 1] + varbind.value_len;
+        }
+
+        errors += status < 0;
+    }
+
+    uint64_t elapsed_us = stats_now_us() - start_us;
+    count_allocations = false;
+
+    if(elapsed_us < 1)
+        elapsed_us = 1;
+
+    printf("decode %4d varbinds %6zu bytes %9.1f ns/PDU %12.0f PDUs/s %12.0f varbinds/s %6.2f allocs/PDU%s\n",
+        varbind_count, packet_len, elapsed_us * 1000.0 / pdu_count, pdu_count * 1e6 / elapsed_us,
+        (double)pdu_count * varbind_count * 1e6 / elapsed_us, (double)allocation_count / pdu_count,
+        errors > 0 || checksum == 0 ? " DECODE ERRORS" : "");
+}
+
+/**
+ * @brief Encodes GETNEXT requests of a walk and patches a GET template with many OIDs.
+ */
+static void bench_encode(int pdu_count)
+{
+    static const char community[] = "public";
+    uint32_t oid[] = { 1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 9, 0, 7, 1 };
+    int oid_len = sizeof(oid) / sizeof(oid[0]);
+    uint8_t request[SNMP_BER_MAX_REQUEST];
+    unsigned long long checksum = 0;
+
+    snmp_ber_template_t getnext_template;
+    snmp_ber_template_init(&getnext_template, SNMP_PDU_GETNEXT, 1, community, sizeof(community) - 1, 0, 0);
+
+    allocation_count = 0;
+    count_allocations = true;
+    uint64_t start_us = stats_now_us();
+
+    for(int i = 0; i < pdu_count; i++)
+    {
+        oid[12] = i & 0xFF;
+        checksum += snmp_ber_template_encode(&getnext_template, snmp_ber_request_id(i), oid, oid_len, request);
+    }
+
+    uint64_t elapsed_us = stats_now_us() - start_us;
+    count_allocations = false;
+
+    printf("encode GETNEXT from template        %9.1f ns/PDU %12.0f PDUs/s %6.2f allocs/PDU\n",
+        elapsed_us * 1000.0 / pdu_count, pdu_count * 1e6 / (elapsed_us > 0 ? elapsed_us : 1), (double)allocation_count / pdu_count);
+
+    snmp_ber_template_t get_template;
+    snmp_ber_template_init(&get_template, SNMP_PDU_GET, 1, community, sizeof(community) - 1, 0, 0);
+    int varbind_count = 0;
+    for(int port = 1; port <= 24; port++)
+    {
+        oid[12] = port;
+        if(snmp_ber_template_add_oid(&get_template, oid, oid_len) == EXIT_SUCCESS)
+            varbind_count++;
+    }
+
+    allocation_count = 0;
+    count_allocations = true;
+    start_us = stats_now_us();
+
+    for(int i = 0; i < pdu_count; i++)
+    {
+        snmp_ber_template_set_request_id(&get_template, snmp_ber_request_id(i));
+        checksum += get_template.data[get_template.len - 1];
+    }
+
+    elapsed_us = stats_now_us() - start_us;
+    count_allocations = false;
+
+    printf("patch GET template, %2d varbinds     %9.1f ns/PDU %12.0f PDUs/s %6.2f allocs/PDU (%zu bytes)\n",
+        varbind_count, elapsed_us * 1000.0 / pdu_count, pdu_count * 1e6 / (elapsed_us > 0 ? elapsed_us : 1),
+        (double)allocation_count / pdu_count, get_template.len);
+
+    if(checksum == 0)
+        printf("no requests encoded\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int pdu_count = 1000000;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n':
+                pdu_count = atoi(optarg);
+                break;
+            default:
+                usage();
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if(pdu_count < 1)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    static const int varbind_counts[] = { 1, 10, 25, 64 };
+
+    for(int i = 0; i < (int)(sizeof(varbind_counts) / sizeof(varbind_counts[0])); i++)
+        bench_decode(varbind_counts[i], pdu_count);
+
+    bench_encode(pdu_count);
+
+    return EXIT_SUCCESS;
+}
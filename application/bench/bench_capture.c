@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snmp_oid.h"
+#include "bench_capture.h"
+
+/**
+ * @brief Generates the output of the init walks of a simulated agent
+ *
+ * The output looks like "snmpwalk -One" against an agent of snmp_agent_sim, the walks are in the order of the
+ * OID init list. Interface 1 and 2 are linked to the neighbouring agents.
+ *
+ * @param agent number of the agent.
+ * @param agent_count number of agents in the ring.
+ * @param port_count number of interfaces.
+ * @return the capture, needs to be freed with sdsfree.
+ */
+sds bench_capture_generate(int agent, int agent_count, int port_count)
+{
+    sds capture_str = sdsempty();
+    int neighbours = agent_count > 1 ? 2 : 0;
+
+    capture_str = sdscatprintf(capture_str, "%s.0 = STRING: \"sim%d\"\n", LLDPMIB_lldpLocSysName, agent);
+    capture_str = sdscatprintf(capture_str, "%s.0 = Hex-STRING: 28 00 \n", LLDPMIB_lldpLocSysCapSupported);
+    capture_str = sdscatprintf(capture_str, "%s.0 = Hex-STRING: 28 00 \n", LLDPMIB_lldpLocSysCapEnabled);
+
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = INTEGER: 5\n", LLDPMIB_lldpLocPortIdSubtype, port);
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = STRING: \"port%d\"\n", LLDPMIB_lldpLocPortId, port, port);
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = INTEGER: %d\n", IFMIB_ifIndex, port, port);
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = INTEGER: 6\n", IFMIB_ifType, port);
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = Gauge32: 1000000000\n", IFMIB_ifSpeed, port);
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = STRING: 2:0:%x:%x:%x:%x\n", IFMIB_ifPhysAddress, port, agent >> 8, agent & 0xFF, port >> 8, port & 0xFF);
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = INTEGER: 1\n", IFMIB_ifOperStatus, port);
+    for(int port = 1; port <= port_count; port++)
+        capture_str = sdscatprintf(capture_str, "%s.%d = STRING: \"port%d\"\n", IFMIB_ifName, port, port);
+
+    /// Remote table, the neighbour of interface 1 is the next agent, the one of interface 2 the previous agent
+    int neighbour_agent[3] = { 0, (agent + 1) % agent_count, (agent + agent_count - 1) % agent_count };
+    int neighbour_port[3] = { 0, 2, 1 };
+
+    const char *remote_oids[] = {
+        LLDPMIB_lldpRemChassisIdSubtype, LLDPMIB_lldpRemChassisId, LLDPMIB_lldpRemPortIdSubtype, LLDPMIB_lldpRemPortId,
+        LLDPMIB_lldpRemSysName, LLDPMIB_lldpRemSysCapSupported, LLDPMIB_lldpRemSysCapEnabled
+    };
+
+    for(int column = 0; column < 7; column++)
+    {
+        if(neighbours == 0)
+        {
+            capture_str = sdscatprintf(capture_str, "%s = No Such Instance currently exists at this OID\n", remote_oids[column]);
+            continue;
+        }
+
+        for(int port = 1; port <= neighbours; port++)
+        {
+            int remote_agent = neighbour_agent[port];
+            int remote_port = neighbour_port[port];
+
+            capture_str = sdscatprintf(capture_str, "%s.0.%d.1 = ", remote_oids[column], port);
+
+            switch(column)
+            {
+                case 0: capture_str = sdscat(capture_str, "INTEGER: 4\n"); break;
+                case 1: capture_str = sdscatprintf(capture_str, "Hex-STRING: 02 00 %02X %02X %02X %02X \n", remote_agent >> 8, remote_agent & 0xFF, remote_port >> 8, remote_port & 0xFF); break;
+                case 2: capture_str = sdscat(capture_str, "INTEGER: 5\n"); break;
+                case 3: capture_str = sdscatprintf(capture_str, "STRING: \"port%d\"\n", remote_port); break;
+                case 4: capture_str = sdscatprintf(capture_str, "STRING: \"sim%d\"\n", remote_agent); break;
+                default: capture_str = sdscat(capture_str, "Hex-STRING: 28 00 \n"); break;
+            }
+        }
+    }
+
+    return capture_str;
+}
+
+/**
+ * @brief Loads a recorded capture, e.g. the output of several "snmpwalk -One" runs.
+ *
+ * @param path path of the file.
+ * @return the capture or NULL if the file can't be read, needs to be freed with sdsfree.
+ */
+sds bench_capture_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if(file == NULL)
+        return NULL;
+
+    sds capture_str = sdsempty();
+    char buffer[4096];
+    size_t len;
+
+    while((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        capture_str = sdscatlen(capture_str, buffer, len);
+
+    fclose(file);
+
+    return capture_str;
+}
+
+/**
+ * @brief Returns the number of lines of a capture.
+ */
+int bench_capture_count_lines(sds capture_str)
+{
+    int count = 0;
+    size_t len = sdslen(capture_str);
+
+    for(size_t i = 0; i < len; i++)
+    {
+        if(capture_str[i] == '\n')
+            count++;
+    }
+
+    if(len > 0 && capture_str[len - 1] != '\n')
+        count++;
+
+    return count;
+}
@@ -0,0 +1,10 @@
+#ifndef BENCH_CAPTURE_H
+#define BENCH_CAPTURE_H
+
+#include "lib/sds.h"
+
+sds bench_capture_generate(int agent, int agent_count, int port_count);
+sds bench_capture_load(const char *path);
+int bench_capture_count_lines(sds capture_str);
+
+#endif
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
+
+#include "lib/sds.h"
+
+#include "ip.h"
+#include "kcolor.h"
+#include "stats.h"
+#include "arena.h"
+#include "database.h"
+#include "snmp_oid.h"
+#include "snmp_network.h"
+#include "snmp_pipeline.h"
+#include "snmp_credential.h"
+#include "snmp_walker.h"
+#include "target_set.h"
+#include "snmp_agent_sim.h"
+
+/**
+ * End to end benchmark of the discovery against a simulated agent fleet.
+ *
+ * Runs the network scan, the SNMP walks, the parser and the database mapping like the application does,
+ * only the database is kept in memory. Needs root because the agents listen on port 161.
+ */
+
+static atomic_int hosts_written = 0;
+
+static void host_data_pair_written(host_data_pair_t *host_data_pair)
+{
+    atomic_fetch_add(&hosts_written, 1);
+    snmp_parse_free_host_data_pair_t(host_data_pair);
+}
+
+static int count_rows(sqlite3 *database, const char *table)
+{
+    sds sql_str = sdscatprintf(sdsempty(), "SELECT COUNT(*) FROM %s;", table);
+    sqlite3_stmt *statement;
+    int count = -1;
+
+    if(sqlite3_prepare_v2(database, sql_str, -1, &statement, NULL) == SQLITE_OK)
+    {
+        if(sqlite3_step(statement) == SQLITE_ROW)
+            count = sqlite3_column_int(statement, 0);
+        sqlite3_finalize(statement);
+    }
+
+    sdsfree(sql_str);
+
+    return count;
+}
+
+static void usage(void)
+{
+    printf("Usage: bench_fleet [-n agents] [-p ports per agent] [-v VLAN interfaces per agent] [-t agent threads] [-d response delay us] [-l latency us] [-m max response bytes] [-W window] [-L rate] [-D deadline s] [-c community] [-C credentials]\n");
+}
+
+static sds get_exec_path(const char *argv0)
+{
+    sds exec_path_str = sdsnew(argv0);
+    char *slash = strrchr(exec_path_str, '/');
+
+    if(slash == NULL)
+        sdsclear(exec_path_str);
+    else
+        sdsrange(exec_path_str, 0, slash - exec_path_str);
+
+    return exec_path_str;
+}
+
+/**
+ * @brief Returns the smallest network which contains all agents.
+ */
+static sds get_sim_network(int agent_count)
+{
+    int prefix = 32;
+    while(prefix > 8 && (1u << (32 - prefix)) < (uint32_t)agent_count + 2)
+        prefix--;
+
+    sds network_str = str_from_ipv4(SIM_BASE_ADDRESS);
+    return sdscatprintf(network_str, "/%d", prefix);
+}
+
+int main(int argc, char *argv[])
+{
+    sim_config_t config = {
+        .agent_count = 64,
+        .port_count = 24,
+        .virtual_count = 0,
+        .thread_count = 2,
+        .community = "public",
+        .response_delay_us = 0,
+        .latency_us = 0,
+        .max_response = 0,
+    };
+
+    /// Additional credentials the sweep tries, to measure the cost of several communities per host
+    const char *credentials_path = NULL;
+    /// Requests in flight per agent, 0 walks with the external snmpwalk
+    int window = SNMP_WALKER_WINDOW;
+    /// Requests per second per agent, 0 for no limit
+    int rate = SNMP_WALKER_RATE;
+    /// Seconds per walk, 0 for no limit
+    int deadline_s = SNMP_WALKER_DEADLINE_S;
+
+    int option;
+    while((option = getopt(argc, argv, "n:p:v:t:d:l:m:W:L:D:c:C:h")) != -1)
+    {
+        switch(option)
+        {
+            case 'n': config.agent_count = atoi(optarg); break;
+            case 'p': config.port_count = atoi(optarg); break;
+            case 'v': config.virtual_count = atoi(optarg); break;
+            case 't': config.thread_count = atoi(optarg); break;
+            case 'd': config.response_delay_us = atoi(optarg); break;
+            case 'l': config.latency_us = atoi(optarg); break;
+            case 'm': config.max_response = atoi(optarg); break;
+            case 'W': window = atoi(optarg); break;
+            case 'L': rate = atoi(optarg); break;
+            case 'D': deadline_s = atoi(optarg); break;
+            case 'c': config.community = optarg; break;
+            case 'C': credentials_path = optarg; break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    if(config.agent_count < 1 || config.agent_count > 65000 || config.port_count < 2 || config.virtual_count < 0)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if(sim_start(&config))
+        return EXIT_FAILURE;
+
+    sds exec_path_str = get_exec_path(argv[0]);
+    sds community_str = sdsnew(config.community);
+    sds network_str = get_sim_network(config.agent_count);
+
+    if(snmp_credential_setup(&community_str, credentials_path) || snmp_walker_setup(window, rate, deadline_s))
+        return EXIT_FAILURE;
+
+    printf("Simulating %d agents with %d ports and %d VLAN interfaces each on %s, %d OIDs per agent.\n", config.agent_count, config.port_count,
+        config.virtual_count, network_str, sim_varbinds_per_agent());
+
+    /// Sweep
+    ipv4_vec_t device_list;
+    vec_init(&device_list);
+
+    uint64_t sweep_start_us = stats_now_us();
+    target_set_t target_set;
+    target_set_init(&target_set);
+    target_set_add_str(&target_set, network_str, false);
+    snmp_network_scan_run(&exec_path_str, &target_set, 0, 0, &device_list);
+    target_set_free(&target_set);
+    uint64_t sweep_us = stats_now_us() - sweep_start_us;
+    stats_record(STATS_PHASE_SWEEP, sweep_us);
+
+    if(device_list.size != config.agent_count)
+        printf(KYELLOW "[WARNING] Sweep found %d of %d agents.\n" KNORMAL, device_list.size, config.agent_count);
+
+    /// Walk, parse and write all devices
+    sqlite3 *database;
+    if(database_open(":memory:", &database) || database_drop(database) || database_generate(database))
+        return EXIT_FAILURE;
+
+    snmp_oid_generate_oid_lists();
+
+    if(snmp_pipeline_setup(&exec_path_str, snmp_oid_get_oid_init_list(), database, &host_data_pair_written))
+        return EXIT_FAILURE;
+
+    uint64_t discovery_start_us = stats_now_us();
+
+    for(int i = 0; i < device_list.size; i++)
+        snmp_pipeline_submit(device_list.data[i]);
+
+    snmp_pipeline_wait_idle();
+
+    int resolved_links_count = 0;
+    database_resolve_pending_links(database, &resolved_links_count);
+
+    uint64_t discovery_us = stats_now_us() - discovery_start_us;
+
+    snmp_pipeline_shutdown();
+    snmp_walker_shutdown();
+    snmp_credential_shutdown();
+
+    /// Report
+    static stats_histogram_t phases[STATS_PHASE_COUNT];
+    uint64_t counters[STATS_COUNTER_COUNT];
+    int64_t gauges[STATS_GAUGE_COUNT];
+    stats_snapshot(phases, counters, gauges);
+
+    double discovery_s = discovery_us / 1e6;
+    stats_histogram_t *host = &phases[STATS_PHASE_HOST];
+
+    printf("\n");
+    stats_print_summary();
+    printf("\n");
+    printf("sweep:          %10.3f s, %d devices\n", sweep_us / 1e6, device_list.size);
+    printf("discovery:      %10.3f s, %d devices written\n", discovery_s, atomic_load(&hosts_written));
+    printf("devices/sec:    %10.1f\n", atomic_load(&hosts_written) / discovery_s);
+    printf("varbinds/sec:   %10.1f\n", counters[STATS_COUNTER_VARBINDS] / discovery_s);
+    printf("host p50:       %10.3f ms\n", stats_histogram_percentile(host, 0.5) / 1000.0);
+    printf("host p99:       %10.3f ms\n", stats_histogram_percentile(host, 0.99) / 1000.0);
+    printf("agent requests: %10llu\n", (unsigned long long)sim_requests_served());
+    printf("agent peak:     %10d requests/s\n", sim_peak_agent_rate());
+    printf("pending links resolved after discovery: %d\n", resolved_links_count);
+    printf("database: %d devices, %d ports, %d links\n", count_rows(database, "Devices"), count_rows(database, "Ports"), count_rows(database, "Links"));
+
+    database_close(database);
+    sim_stop();
+
+    vec_free(&device_list);
+    snmp_oid_free_oid_lists();
+    arena_pool_clear();
+    sdsfree(exec_path_str);
+    sdsfree(community_str);
+    sdsfree(network_str);
+
+    return EXIT_SUCCESS;
+}
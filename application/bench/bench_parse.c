@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "lib/sds.h"
+
+#include "stats.h"
+#include "arena.h"
+#include "database.h"
+#include "snmp_oid.h"
+#include "snmp_parse.h"
+#include "bench_capture.h"
+#include "bench_alloc.h"
+
+/**
+ * Micro benchmark of snmp_parse_from_list and snmp_host_data_pair_to_database.
+ *
+ * Feeds captures of "snmpwalk -One" output into the parser and maps the result to an in-memory database.
+ * Allocations are counted by wrapping malloc, calloc and realloc at link time (bench_alloc.c),
+ * this covers the application code and sds but not SQLite. Statements are counted with sqlite3_trace_v2.
+ */
+
+static unsigned long long statement_count = 0;
+
+static int count_statement(unsigned type, void *context, void *statement, void *sql)
+{
+    statement_count++;
+    return 0;
+}
+
+static void usage(void)
+{
+    printf("Usage: bench_parse [-r repetitions] [-n agents of the generated captures] [capture files...]\n");
+    printf("Without capture files, captures with 8 to 512 ports are generated.\n");
+}
+
+/**
+ * @brief Runs the parser and the database mapping on a capture and prints a line with the results.
+ */
+static void bench_capture(const char *name_str, sds capture_str, int repetitions)
+{
+    oid_vec_t *oid_list = snmp_oid_get_oid_init_list();
+    ipv4_t host = 0x7F010001;
+    int line_count = bench_capture_count_lines(capture_str);
+
+    /// Parser
+    host_data_pair_t *host_data_pair = NULL;
+    uint64_t parse_us = 0;
+    unsigned long long parse_allocations = 0;
+
+    for(int i = 0; i < repetitions; i++)
+    {
+        if(host_data_pair != NULL)
+            snmp_parse_free_host_data_pair_t(host_data_pair);
+
+        host_data_pair = malloc(sizeof(host_data_pair_t));
+        host_data_pair->host = host;
+        vec_init(&host_data_pair->oid_string_tuple_list);
+        host_data_pair->arena = arena_pool_get();
+
+        allocation_count = 0;
+        count_allocations = true;
+        uint64_t start_us = stats_now_us();
+
+        snmp_parse_from_list(&capture_str, host, oid_list, host_data_pair->arena, &host_data_pair->oid_string_tuple_list);
+
+        parse_us += stats_now_us() - start_us;
+        count_allocations = false;
+        parse_allocations += allocation_count;
+    }
+
+    /// Database mapping, first into an empty database and then as an update of the same device
+    sqlite3 *database;
+    database_open(":memory:", &database);
+    sqlite3_trace_v2(database, SQLITE_TRACE_STMT, count_statement, NULL);
+
+    uint64_t insert_us = 0;
+    uint64_t update_us = 0;
+    unsigned long long insert_statements = 0;
+    unsigned long long update_statements = 0;
+    int port_count = 0;
+
+    for(int i = 0; i < repetitions; i++)
+    {
+        database_drop(database);
+        database_generate(database);
+
+        statement_count = 0;
+        uint64_t start_us = stats_now_us();
+        snmp_host_data_pair_to_database(host_data_pair, database, &port_count);
+        insert_us += stats_now_us() - start_us;
+        insert_statements += statement_count;
+
+        statement_count = 0;
+        start_us = stats_now_us();
+        snmp_host_data_pair_to_database(host_data_pair, database, NULL);
+        update_us += stats_now_us() - start_us;
+        update_statements += statement_count;
+    }
+
+    database_close(database);
+
+    int varbind_count = host_data_pair->oid_string_tuple_list.size;
+    snmp_parse_free_host_data_pair_t(host_data_pair);
+
+    if(port_count < 1)
+        port_count = 1;
+
+    printf("%-14s %6d %6d %9.1f %11.2f %10.3f %10.3f %9.1f %9.1f\n",
+        name_str, line_count, varbind_count,
+        parse_us * 1000.0 / repetitions / line_count,
+        (double)parse_allocations / repetitions / line_count,
+        insert_us / 1000.0 / repetitions,
+        update_us / 1000.0 / repetitions,
+        (double)insert_statements / repetitions / port_count,
+        (double)update_statements / repetitions / port_count);
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = 50;
+    int agent_count = 16;
+
+    int option;
+    while((option = getopt(argc, argv, "r:n:h")) != -1)
+    {
+        switch(option)
+        {
+            case 'r': repetitions = atoi(optarg); break;
+            case 'n': agent_count = atoi(optarg); break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    if(repetitions < 1 || agent_count < 1)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    snmp_oid_generate_oid_lists();
+
+    printf("%d repetitions, ports = ports written by the first mapping\n", repetitions);
+    printf("%-14s %6s %6s %9s %11s %10s %10s %9s %9s\n", "capture", "lines", "vars", "ns/line", "allocs/line", "insert ms", "update ms", "stmt/port", "stmt/port");
+    printf("%-14s %6s %6s %9s %11s %10s %10s %9s %9s\n", "", "", "", "", "", "", "", "(insert)", "(update)");
+
+    if(optind < argc)
+    {
+        for(int i = optind; i < argc; i++)
+        {
+            sds capture_str = bench_capture_load(argv[i]);
+            if(capture_str == NULL)
+            {
+                printf("Can't read %s\n", argv[i]);
+                continue;
+            }
+
+            const char *name_str = strrchr(argv[i], '/') != NULL ? strrchr(argv[i], '/') + 1 : argv[i];
+            bench_capture(name_str, capture_str, repetitions);
+            sdsfree(capture_str);
+        }
+    }
+    else
+    {
+        for(int port_count = 8; port_count <= 512; port_count *= 2)
+        {
+            char name_str[32];
+            snprintf(name_str, sizeof(name_str), "%d ports", port_count);
+
+            sds capture_str = bench_capture_generate(0, agent_count, port_count);
+            bench_capture(name_str, capture_str, repetitions);
+            sdsfree(capture_str);
+        }
+    }
+
+    snmp_oid_free_oid_lists();
+    arena_pool_clear();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,605 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sqlite3.h>
+
+#include "lib/sds.h"
+
+#include "ip.h"
+#include "kcolor.h"
+#include "stats.h"
+#include "metrics.h"
+#include "sim_ber.h"
+#include "snmp_agent_sim.h"
+
+/**
+ * Trap storm load generator with end to end trap to database latency.
+ *
+ * Starts a simulated agent fleet and the application, waits for the discovery and then fires bursts of
+ * linkDown/linkUp traps from the agent addresses. Before each trap the ifOperStatus of interface 1 of the agent is
+ * flipped, the latency is the time until the new status can be read from the database of the application.
+ * A trap which is superseded by a newer trap of the same agent before it has been reflected counts as coalesced.
+ * Needs root because the agents listen on port 161 and snmptrapd on port 162.
+ */
+
+#define TRAP_PORT 162
+#define POLL_INTERVAL_US 1000
+
+/// Latest unreflected trap of an agent
+typedef struct
+{
+    bool pending;
+    int expected_status;
+    uint64_t sent_us;
+} trap_state_t;
+
+static trap_state_t *trap_states;
+static int trap_state_count;
+static pthread_mutex_t trap_states_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static stats_histogram_t latency_histogram;
+static int reflected_count = 0;
+static int coalesced_count = 0;
+
+static atomic_bool poll_running = true;
+static const char *database_path = "application.db";
+
+static void usage(void)
+{
+    printf("Usage: bench_trapstorm [-n agents] [-p ports per agent] [-b traps per burst] [-r bursts] [-i ms between bursts]\n");
+    printf("                       [-v 1|2c] [-c community] [-D database] [-w seconds to wait for stragglers] [-f] [-x]\n");
+    printf("-f keeps ifTableLastChange of the agents when a link changes, like agents which only update it for new rows.\n");
+    printf("-x attaches to an application which is already running on the simulated network, e.g. started by hand.\n");
+}
+
+static sds get_exec_path(const char *argv0)
+{
+    sds exec_path_str = sdsnew(argv0);
+    char *slash = strrchr(exec_path_str, '/');
+
+    if(slash == NULL)
+        sdsclear(exec_path_str);
+    else
+        sdsrange(exec_path_str, 0, slash - exec_path_str);
+
+    return exec_path_str;
+}
+
+static sds get_sim_network(int agent_count)
+{
+    int prefix = 32;
+    while(prefix > 8 && (1u << (32 - prefix)) < (uint32_t)agent_count + 2)
+        prefix--;
+
+    sds network_str = str_from_ipv4(SIM_BASE_ADDRESS);
+    return sdscatprintf(network_str, "/%d", prefix);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Application                                                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Starts the application on the simulated network, its output goes to trapstorm_application.log.
+ *
+ * @return pid of the application or -1 on failure.
+ */
+static pid_t application_start(sds exec_path_str, sds network_str, const char *community)
+{
+    sds binary_path_str = sdscat(sdsdup(exec_path_str), "application");
+
+    if(access(binary_path_str, X_OK) != 0)
+    {
+        printf(KRED "[ERROR] application_start can't run file: %s\n" KNORMAL, binary_path_str);
+        sdsfree(binary_path_str);
+        return -1;
+    }
+
+    pid_t pid = fork();
+
+    if(pid == 0)
+    {
+        /// Own process group, stopping it like Ctrl+C also stops snmptrapd which blocks the trap thread otherwise
+        setpgid(0, 0);
+
+        int log_fd = open("trapstorm_application.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(log_fd >= 0)
+        {
+            dup2(log_fd, STDOUT_FILENO);
+            dup2(log_fd, STDERR_FILENO);
+            close(log_fd);
+        }
+
+        execl(binary_path_str, binary_path_str, network_str, community, NULL);
+        _exit(EXIT_FAILURE);
+    }
+
+    sdsfree(binary_path_str);
+
+    return pid;
+}
+
+static int query_int(sqlite3 *database, const char *sql)
+{
+    sqlite3_stmt *statement;
+    int value = -1;
+
+    if(sqlite3_prepare_v2(database, sql, -1, &statement, NULL) == SQLITE_OK)
+    {
+        if(sqlite3_step(statement) == SQLITE_ROW)
+            value = sqlite3_column_int(statement, 0);
+        sqlite3_finalize(statement);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Waits until interface 1 of every agent is in the database.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE after the timeout or if the application exited.
+ */
+static int application_wait_discovery(pid_t pid, int agent_count, int timeout_s)
+{
+    uint64_t deadline_us = stats_now_us() + (uint64_t)timeout_s * 1000000;
+    int count = -1;
+
+    while(stats_now_us() < deadline_us)
+    {
+        if(pid > 0 && waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            printf(KRED "[ERROR] application_wait_discovery the application exited, see trapstorm_application.log\n" KNORMAL);
+            return EXIT_FAILURE;
+        }
+
+        sqlite3 *database;
+        if(sqlite3_open_v2(database_path, &database, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK)
+        {
+            sqlite3_busy_timeout(database, 100);
+            count = query_int(database, "SELECT COUNT(*) FROM Ports JOIN Devices ON Ports.DeviceId = Devices.Id WHERE Ports.InterfaceId = 1;");
+        }
+        sqlite3_close(database);
+
+        if(count >= agent_count)
+            return EXIT_SUCCESS;
+
+        usleep(100000);
+    }
+
+    printf(KRED "[ERROR] application_wait_discovery found %d of %d devices after %d s.\n" KNORMAL, count < 0 ? 0 : count, agent_count, timeout_s);
+
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Reads a counter from the metrics endpoint of the application.
+ *
+ * @return the value or -1 if the endpoint can't be reached.
+ */
+static long long metrics_scrape(const char *name)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(METRICS_PORT), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+
+    if(fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)))
+    {
+        if(fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    const char *request = "GET /metrics HTTP/1.0\r\n\r\n";
+    if(write(fd, request, strlen(request)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    sds response_str = sdsempty();
+    char buffer[4096];
+    ssize_t len;
+
+    while((len = read(fd, buffer, sizeof(buffer))) > 0)
+        response_str = sdscatlen(response_str, buffer, len);
+
+    close(fd);
+
+    long long value = -1;
+    sds pattern_str = sdscatprintf(sdsempty(), "\n%s ", name);
+    char *line = strstr(response_str, pattern_str);
+
+    if(line != NULL)
+        value = strtoll(line + sdslen(pattern_str), NULL, 10);
+
+    sdsfree(pattern_str);
+    sdsfree(response_str);
+
+    return value;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Traps                                                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Encodes a linkDown (status 2) or linkUp (status 1) trap for interface 1 of an agent.
+ *
+ * @return length of the message or 0 if it doesn't fit.
+ */
+static size_t trap_encode(uint8_t *message, size_t capacity, bool version_1, const char *community, int agent, int status, int32_t request_id)
+{
+    static const uint32_t sys_uptime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+    static const uint32_t snmp_trap_oid[] = { 1, 3, 6, 1, 6, 3, 1, 1, 4, 1, 0 };
+    static const uint32_t if_index_oid[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 1, 1 };
+    const uint32_t link_trap_oid[] = { 1, 3, 6, 1, 6, 3, 1, 1, 5, status == 2 ? 3 : 4 };
+    /// Enterprise of the generic v1 traps: snmpTraps
+    static const uint32_t enterprise_oid[] = { 1, 3, 6, 1, 6, 3, 1, 1, 5 };
+
+    uint32_t uptime = sim_uptime();
+
+    /// Variable bindings, v1 carries sysUpTime and the trap type in the PDU header instead
+    uint8_t varbind_data[256];
+    sim_ber_buffer_t varbinds = { varbind_data, 0, sizeof(varbind_data) };
+    uint8_t value_data[64];
+    sim_ber_buffer_t value;
+
+    if(!version_1)
+    {
+        value = (sim_ber_buffer_t){ value_data, 0, sizeof(value_data) };
+        sim_ber_put_oid(&value, sys_uptime_oid, 9);
+        sim_ber_put_unsigned(&value, BER_TIMETICKS, uptime);
+        sim_ber_put_header(&varbinds, BER_SEQUENCE, value.len);
+        sim_ber_put(&varbinds, value.data, value.len);
+
+        value = (sim_ber_buffer_t){ value_data, 0, sizeof(value_data) };
+        sim_ber_put_oid(&value, snmp_trap_oid, 11);
+        sim_ber_put_oid(&value, link_trap_oid, 10);
+        sim_ber_put_header(&varbinds, BER_SEQUENCE, value.len);
+        sim_ber_put(&varbinds, value.data, value.len);
+    }
+
+    value = (sim_ber_buffer_t){ value_data, 0, sizeof(value_data) };
+    sim_ber_put_oid(&value, if_index_oid, 11);
+    sim_ber_put_integer(&value, 1);
+    sim_ber_put_header(&varbinds, BER_SEQUENCE, value.len);
+    sim_ber_put(&varbinds, value.data, value.len);
+
+    /// PDU
+    uint8_t pdu_data[512];
+    sim_ber_buffer_t pdu = { pdu_data, 0, sizeof(pdu_data) };
+
+    if(version_1)
+    {
+        uint32_t agent_address = htonl(sim_agent_address(agent));
+
+        sim_ber_put_oid(&pdu, enterprise_oid, 9);
+        sim_ber_put_header(&pdu, BER_IP_ADDRESS, 4);
+        sim_ber_put(&pdu, &agent_address, 4);
+        sim_ber_put_integer(&pdu, status == 2 ? 2 : 3); /* generic-trap linkDown / linkUp */
+        sim_ber_put_integer(&pdu, 0);
+        sim_ber_put_unsigned(&pdu, BER_TIMETICKS, uptime);
+    }
+    else
+    {
+        sim_ber_put_integer(&pdu, request_id);
+        sim_ber_put_integer(&pdu, 0);
+        sim_ber_put_integer(&pdu, 0);
+    }
+
+    if(!sim_ber_put_header(&pdu, BER_SEQUENCE, varbinds.len) || !sim_ber_put(&pdu, varbinds.data, varbinds.len))
+        return 0;
+
+    /// Message
+    uint8_t header_data[256];
+    sim_ber_buffer_t header = { header_data, 0, sizeof(header_data) };
+    size_t community_len = strlen(community);
+
+    sim_ber_put_integer(&header, version_1 ? 0 : 1);
+    sim_ber_put_header(&header, BER_OCTET_STRING, community_len);
+    sim_ber_put(&header, community, community_len);
+    sim_ber_put_header(&header, version_1 ? 0xA4 : 0xA7, pdu.len);
+
+    sim_ber_buffer_t out = { message, 0, capacity };
+
+    if(!sim_ber_put_header(&out, BER_SEQUENCE, header.len + pdu.len)
+        || !sim_ber_put(&out, header.data, header.len)
+        || !sim_ber_put(&out, pdu.data, pdu.len))
+        return 0;
+
+    return out.len;
+}
+
+/**
+ * @brief Opens a socket per agent, v2c traps are attributed to the source address.
+ */
+static int *trap_sockets_open(int agent_count)
+{
+    int *sockets = malloc(agent_count * sizeof(int));
+
+    for(int agent = 0; agent < agent_count; agent++)
+    {
+        struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(sim_agent_address(agent)) };
+
+        sockets[agent] = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if(sockets[agent] < 0 || bind(sockets[agent], (struct sockaddr *)&address, sizeof(address)))
+        {
+            printf(KRED "[ERROR] trap_sockets_open couldn't bind a socket to %s.\n" KNORMAL, inet_ntoa(address.sin_addr));
+            for(int i = 0; i <= agent; i++)
+            {
+                if(sockets[i] >= 0)
+                    close(sockets[i]);
+            }
+            free(sockets);
+            return NULL;
+        }
+    }
+
+    return sockets;
+}
+
+/**
+ * @brief Reads interface 1 of all devices from the database and records the latency of reflected traps.
+ */
+static void *poll_thread(void *param)
+{
+    sqlite3 *database;
+
+    if(sqlite3_open_v2(database_path, &database, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        printf(KRED "[ERROR] poll_thread can't open %s\n" KNORMAL, database_path);
+        sqlite3_close(database);
+        return NULL;
+    }
+
+    sqlite3_busy_timeout(database, 1000);
+
+    sqlite3_stmt *statement;
+    sqlite3_prepare_v2(database, "SELECT Devices.ManagementAddress, Ports.OperatingStatus FROM Ports JOIN Devices ON Ports.DeviceId = Devices.Id WHERE Ports.InterfaceId = 1;", -1, &statement, NULL);
+
+    while(atomic_load(&poll_running))
+    {
+        while(sqlite3_step(statement) == SQLITE_ROW)
+        {
+            int agent = (int)((ipv4_t)sqlite3_column_int64(statement, 0) - SIM_BASE_ADDRESS - 1);
+            int status = sqlite3_column_int(statement, 1);
+            uint64_t now_us = stats_now_us();
+
+            if(agent < 0 || agent >= trap_state_count)
+                continue;
+
+            pthread_mutex_lock(&trap_states_mutex);
+            trap_state_t *state = &trap_states[agent];
+            if(state->pending && state->expected_status == status)
+            {
+                stats_histogram_add(&latency_histogram, now_us - state->sent_us);
+                state->pending = false;
+                reflected_count++;
+            }
+            pthread_mutex_unlock(&trap_states_mutex);
+        }
+
+        sqlite3_reset(statement);
+        usleep(POLL_INTERVAL_US);
+    }
+
+    sqlite3_finalize(statement);
+    sqlite3_close(database);
+
+    return NULL;
+}
+
+static int pending_count(void)
+{
+    int count = 0;
+
+    pthread_mutex_lock(&trap_states_mutex);
+    for(int i = 0; i < trap_state_count; i++)
+        count += trap_states[i].pending;
+    pthread_mutex_unlock(&trap_states_mutex);
+
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    sim_config_t config = {
+        .agent_count = 64,
+        .port_count = 8,
+        .thread_count = 2,
+        .community = "public",
+        .response_delay_us = 0,
+        .frozen_last_change = 0,
+    };
+
+    int burst_size = 100;
+    int burst_count = 10;
+    int burst_interval_ms = 1000;
+    bool version_1 = false;
+    int wait_s = 30;
+    bool attach = false;
+
+    int option;
+    while((option = getopt(argc, argv, "n:p:b:r:i:v:c:D:w:fxh")) != -1)
+    {
+        switch(option)
+        {
+            case 'n': config.agent_count = atoi(optarg); break;
+            case 'p': config.port_count = atoi(optarg); break;
+            case 'b': burst_size = atoi(optarg); break;
+            case 'r': burst_count = atoi(optarg); break;
+            case 'i': burst_interval_ms = atoi(optarg); break;
+            case 'v': version_1 = strcmp(optarg, "1") == 0; break;
+            case 'c': config.community = optarg; break;
+            case 'D': database_path = optarg; break;
+            case 'w': wait_s = atoi(optarg); break;
+            case 'f': config.frozen_last_change = 1; break;
+            case 'x': attach = true; break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    if(config.agent_count < 1 || config.agent_count > 65000 || config.port_count < 2 || burst_size < 1 || burst_count < 1 || burst_interval_ms < 0)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if(sim_start(&config))
+        return EXIT_FAILURE;
+
+    sds exec_path_str = get_exec_path(argv[0]);
+    sds network_str = get_sim_network(config.agent_count);
+    pid_t application_pid = -1;
+
+    printf("Simulating %d agents with %d ports each on %s.\n", config.agent_count, config.port_count, network_str);
+
+    if(!attach)
+    {
+        application_pid = application_start(exec_path_str, network_str, config.community);
+        if(application_pid < 0)
+            return EXIT_FAILURE;
+    }
+
+    int *sockets = trap_sockets_open(config.agent_count);
+
+    if(sockets == NULL || application_wait_discovery(application_pid, config.agent_count, 120))
+    {
+        if(application_pid > 0)
+            kill(-application_pid, SIGINT);
+        sim_stop();
+        return EXIT_FAILURE;
+    }
+
+    /// snmptrapd is started after the discovery has been written
+    sleep(1);
+    printf("Discovery finished, sending %d bursts of %d %s traps.\n", burst_count, burst_size, version_1 ? "v1" : "v2c");
+
+    trap_state_count = config.agent_count;
+    trap_states = calloc(trap_state_count, sizeof(trap_state_t));
+    int *oper_status = malloc(config.agent_count * sizeof(int));
+    for(int agent = 0; agent < config.agent_count; agent++)
+        oper_status[agent] = 1;
+
+    long long received_before = metrics_scrape("snmp_discovery_traps_received_total");
+    long long dropped_before = metrics_scrape("snmp_discovery_traps_dropped_total");
+    long long unchanged_before = metrics_scrape("snmp_discovery_unchanged_walks_total");
+    long long planned_before = metrics_scrape("snmp_discovery_planned_walks_total");
+
+    pthread_t poller;
+    pthread_create(&poller, NULL, poll_thread, NULL);
+
+    struct sockaddr_in trap_address = { .sin_family = AF_INET, .sin_port = htons(TRAP_PORT), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    uint8_t message[1024];
+    int sent_count = 0;
+    int send_errors = 0;
+    int next_agent = 0;
+
+    uint64_t start_us = stats_now_us();
+
+    for(int burst = 0; burst < burst_count; burst++)
+    {
+        uint64_t burst_start_us = stats_now_us();
+
+        for(int i = 0; i < burst_size; i++)
+        {
+            int agent = next_agent;
+            next_agent = (next_agent + 1) % config.agent_count;
+
+            oper_status[agent] = oper_status[agent] == 1 ? 2 : 1;
+            sim_set_oper_status(agent, 1, oper_status[agent]);
+
+            size_t len = trap_encode(message, sizeof(message), version_1, config.community, agent, oper_status[agent], sent_count + 1);
+
+            pthread_mutex_lock(&trap_states_mutex);
+            trap_state_t *state = &trap_states[agent];
+            if(state->pending)
+                coalesced_count++;
+            state->pending = true;
+            state->expected_status = oper_status[agent];
+            state->sent_us = stats_now_us();
+            pthread_mutex_unlock(&trap_states_mutex);
+
+            if(sendto(sockets[agent], message, len, 0, (struct sockaddr *)&trap_address, sizeof(trap_address)) != (ssize_t)len)
+                send_errors++;
+
+            sent_count++;
+        }
+
+        uint64_t elapsed_us = stats_now_us() - burst_start_us;
+        if(burst + 1 < burst_count && elapsed_us < (uint64_t)burst_interval_ms * 1000)
+            usleep((uint64_t)burst_interval_ms * 1000 - elapsed_us);
+    }
+
+    uint64_t send_us = stats_now_us() - start_us;
+
+    /// Wait for the stragglers
+    uint64_t deadline_us = stats_now_us() + (uint64_t)wait_s * 1000000;
+    while(pending_count() > 0 && stats_now_us() < deadline_us)
+        usleep(10000);
+
+    uint64_t total_us = stats_now_us() - start_us;
+
+    atomic_store(&poll_running, false);
+    pthread_join(poller, NULL);
+
+    long long received_after = metrics_scrape("snmp_discovery_traps_received_total");
+    long long dropped_after = metrics_scrape("snmp_discovery_traps_dropped_total");
+    long long unchanged_after = metrics_scrape("snmp_discovery_unchanged_walks_total");
+    long long planned_after = metrics_scrape("snmp_discovery_planned_walks_total");
+
+    /// Report
+    int lost_count = pending_count();
+
+    printf("\n");
+    printf("traps sent:        %10d in %.3f s, %d send errors\n", sent_count, send_us / 1e6, send_errors);
+    printf("offered rate:      %10.1f traps/sec\n", sent_count / (send_us / 1e6));
+    printf("reflected:         %10d\n", reflected_count);
+    printf("coalesced:         %10d (superseded by a newer trap of the same agent)\n", coalesced_count);
+    printf("lost:              %10d (not in the database after %d s)\n", lost_count, wait_s);
+    printf("sustained rate:    %10.1f traps/sec (reflected + coalesced until the last change was reflected)\n", (reflected_count + coalesced_count) / (total_us / 1e6));
+    printf("latency p50:       %10.3f ms\n", stats_histogram_percentile(&latency_histogram, 0.5) / 1000.0);
+    printf("latency p99:       %10.3f ms\n", stats_histogram_percentile(&latency_histogram, 0.99) / 1000.0);
+    printf("latency max:       %10.3f ms\n", latency_histogram.max_us / 1000.0);
+
+    if(received_before >= 0 && received_after >= 0)
+    {
+        printf("snmptrapd traps:   %10lld received by the application\n", received_after - received_before);
+        printf("ip_buffer drops:   %10lld\n", dropped_after - dropped_before);
+        printf("unchanged walks:   %10lld (skipped, must stay 0 for traps)\n", unchanged_after - unchanged_before);
+        printf("planned walks:     %10lld (read with the GETs of the last walk)\n", planned_after - planned_before);
+    }
+    else
+    {
+        printf(KYELLOW "[WARNING] Metrics endpoint on port %d isn't reachable, trap drops are unknown.\n" KNORMAL, METRICS_PORT);
+    }
+
+    if(application_pid > 0)
+    {
+        kill(-application_pid, SIGINT);
+        waitpid(application_pid, NULL, 0);
+    }
+
+    for(int agent = 0; agent < config.agent_count; agent++)
+        close(sockets[agent]);
+
+    sim_stop();
+
+    free(sockets);
+    free(oper_status);
+    free(trap_states);
+    sdsfree(exec_path_str);
+    sdsfree(network_str);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+#include <string.h>
+
+#include "sim_ber.h"
+
+/**
+ * @brief Appends raw bytes.
+ *
+ * @return false if the buffer is full.
+ */
+bool sim_ber_put(sim_ber_buffer_t *buffer, const void *data, size_t len)
+{
+    if(buffer->len + len > buffer->capacity)
+        return false;
+
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+
+    return true;
+}
+
+/**
+ * @brief Appends a TLV header with a definite length of up to two bytes.
+ *
+ * @return false if the buffer is full.
+ */
+bool sim_ber_put_header(sim_ber_buffer_t *buffer, uint8_t tag, size_t len)
+{
+    uint8_t header[4] = { tag };
+    int header_len;
+
+    if(len < 0x80)
+    {
+        header[1] = len;
+        header_len = 2;
+    }
+    else if(len <= 0xFF)
+    {
+        header[1] = 0x81;
+        header[2] = len;
+        header_len = 3;
+    }
+    else
+    {
+        header[1] = 0x82;
+        header[2] = len >> 8;
+        header[3] = len & 0xFF;
+        header_len = 4;
+    }
+
+    return sim_ber_put(buffer, header, header_len);
+}
+
+/**
+ * @brief Returns the size of the TLV header written by sim_ber_put_header for a content length.
+ */
+size_t sim_ber_header_len(size_t len)
+{
+    return len < 0x80 ? 2 : (len <= 0xFF ? 3 : 4);
+}
+
+/**
+ * @brief Appends an unsigned 32 bit value, e.g. Gauge32 or TimeTicks.
+ *
+ * @return false if the buffer is full.
+ */
+bool sim_ber_put_unsigned(sim_ber_buffer_t *buffer, uint8_t tag, uint32_t value)
+{
+    uint8_t bytes[5];
+    int len = 0;
+
+    /// Big endian with a leading zero byte if the highest bit is set
+    for(int shift = 24; shift >= 0; shift -= 8)
+    {
+        uint8_t byte = value >> shift;
+        if(len == 0 && byte == 0 && shift > 0)
+            continue;
+        if(len == 0 && (byte & 0x80))
+            bytes[len++] = 0;
+        bytes[len++] = byte;
+    }
+
+    return sim_ber_put_header(buffer, tag, len) && sim_ber_put(buffer, bytes, len);
+}
+
+/**
+ * @brief Appends an INTEGER.
+ *
+ * @return false if the buffer is full.
+ */
+bool sim_ber_put_integer(sim_ber_buffer_t *buffer, int32_t value)
+{
+    uint8_t bytes[4];
+    int len = 4;
+
+    for(int i = 0; i < 4; i++)
+        bytes[i] = (uint32_t)value >> (24 - 8 * i);
+
+    /// Remove redundant leading bytes
+    int start = 0;
+    while(len - start > 1 && ((bytes[start] == 0x00 && !(bytes[start + 1] & 0x80)) || (bytes[start] == 0xFF && (bytes[start + 1] & 0x80))))
+        start++;
+
+    return sim_ber_put_header(buffer, BER_INTEGER, len - start) && sim_ber_put(buffer, bytes + start, len - start);
+}
+
+/**
+ * @brief Encodes the content of an OID without TLV header.
+ *
+ * @param out needs room for 5 bytes per sub identifier.
+ * @return the length of the encoded content.
+ */
+int sim_ber_encode_oid(const uint32_t *oid, int oid_len, uint8_t *out)
+{
+    int len = 0;
+
+    out[len++] = oid_len >= 2 ? oid[0] * 40 + oid[1] : 0;
+
+    for(int i = 2; i < oid_len; i++)
+    {
+        uint32_t value = oid[i];
+        uint8_t bytes[5];
+        int count = 0;
+
+        do
+        {
+            bytes[count++] = value & 0x7F;
+            value >>= 7;
+        } while(value > 0);
+
+        while(count > 0)
+        {
+            count--;
+            out[len++] = bytes[count] | (count > 0 ? 0x80 : 0);
+        }
+    }
+
+    return len;
+}
+
+
+/**
+ * @brief Appends an OID including its TLV header.
+ *
+ * @return false if the buffer is full.
+ */
+bool sim_ber_put_oid(sim_ber_buffer_t *buffer, const uint32_t *oid, int oid_len)
+{
+    uint8_t oid_ber[5 * 128];
+
+    if(oid_len > 128)
+        return false;
+
+    int oid_ber_len = sim_ber_encode_oid(oid, oid_len, oid_ber);
+
+    return sim_ber_put_header(buffer, BER_OID, oid_ber_len) && sim_ber_put(buffer, oid_ber, oid_ber_len);
+}
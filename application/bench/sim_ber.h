@@ -0,0 +1,37 @@
+#ifndef SIM_BER_H
+#define SIM_BER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define BER_INTEGER 0x02
+#define BER_OCTET_STRING 0x04
+#define BER_NULL 0x05
+#define BER_OID 0x06
+#define BER_SEQUENCE 0x30
+#define BER_IP_ADDRESS 0x40
+#define BER_GAUGE32 0x42
+#define BER_TIMETICKS 0x43
+#define BER_NO_SUCH_OBJECT 0x80
+#define BER_END_OF_MIB_VIEW 0x82
+
+/**
+ * Fixed size output buffer, writes fail instead of growing the buffer.
+ */
+typedef struct
+{
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+} sim_ber_buffer_t;
+
+bool sim_ber_put(sim_ber_buffer_t *buffer, const void *data, size_t len);
+bool sim_ber_put_header(sim_ber_buffer_t *buffer, uint8_t tag, size_t len);
+size_t sim_ber_header_len(size_t len);
+bool sim_ber_put_unsigned(sim_ber_buffer_t *buffer, uint8_t tag, uint32_t value);
+bool sim_ber_put_integer(sim_ber_buffer_t *buffer, int32_t value);
+int sim_ber_encode_oid(const uint32_t *oid, int oid_len, uint8_t *out);
+bool sim_ber_put_oid(sim_ber_buffer_t *buffer, const uint32_t *oid, int oid_len);
+
+#endif
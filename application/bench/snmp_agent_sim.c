@@ -0,0 +1,935 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "kcolor.h"
+#include "sim_ber.h"
+#include "snmp_agent_sim.h"
+
+#define SIM_MAX_PACKET 65507
+/// Responses to GETBULK requests are cut before they exceed this size, larger GET and GETNEXT responses get tooBig.
+#define SIM_MAX_RESPONSE 8192
+#define SIM_MAX_VARBINDS 128
+
+#define PDU_GET 0xA0
+#define PDU_GETNEXT 0xA1
+#define PDU_RESPONSE 0xA2
+#define PDU_GETBULK 0xA5
+
+#define SNMP_ERROR_TOO_BIG 1
+#define SNMP_ERROR_NO_SUCH_NAME 2
+
+/**
+ * Kind of value served for an OID, the value itself is generated from the agent and interface number.
+ */
+typedef enum
+{
+    SIM_SYS_DESCR,
+    SIM_SYS_UPTIME,
+    SIM_IF_INDEX,
+    SIM_IF_TYPE,
+    SIM_IF_SPEED,
+    SIM_IF_PHYS_ADDRESS,
+    SIM_IF_OPER_STATUS,
+    SIM_IF_NAME,
+    SIM_IF_TABLE_LAST_CHANGE,
+    SIM_LLDP_REM_TABLES_LAST_CHANGE,
+    SIM_LLDP_LOC_SYS_NAME,
+    SIM_LLDP_LOC_SYS_CAP,
+    SIM_LLDP_LOC_PORT_ID_SUBTYPE,
+    SIM_LLDP_LOC_PORT_ID,
+    SIM_LLDP_REM_CHASSIS_ID_SUBTYPE,
+    SIM_LLDP_REM_CHASSIS_ID,
+    SIM_LLDP_REM_PORT_ID_SUBTYPE,
+    SIM_LLDP_REM_PORT_ID,
+    SIM_LLDP_REM_SYS_NAME,
+    SIM_LLDP_REM_SYS_CAP,
+} sim_value_kind_t;
+
+/**
+ * A served OID, all agents serve the same OIDs in lexicographic order.
+ */
+typedef struct
+{
+    uint32_t oid[SIM_MAX_OID_LEN];
+    int oid_len;
+    sim_value_kind_t kind;
+    int port;
+} sim_entry_t;
+
+typedef struct
+{
+    int socket;
+    int agent;
+    /// sysUpTime of the last change of an ifOperStatus, served as ifTableLastChange.
+    atomic_uint if_table_last_change;
+    /// Requests received in the second since window_start_us, only used by the worker of the agent.
+    uint64_t window_start_us;
+    int window_count;
+    /// Most requests received within one second.
+    atomic_int peak_rate;
+} sim_agent_t;
+
+/**
+ * Response held back until the simulated link latency has passed.
+ */
+typedef struct sim_delayed
+{
+    struct sim_delayed *next;
+    uint64_t due_us;
+    int socket;
+    struct sockaddr_in peer;
+    socklen_t peer_len;
+    size_t len;
+    uint8_t data[];
+} sim_delayed_t;
+
+typedef struct
+{
+    pthread_t thread;
+    int epoll_fd;
+    /// Delayed responses in the order they are due, the latency is the same for all of them
+    sim_delayed_t *delayed_head;
+    sim_delayed_t *delayed_tail;
+} sim_worker_t;
+
+static sim_config_t sim_config;
+static sim_entry_t *sim_entries = NULL;
+static int sim_entry_count = 0;
+static sim_agent_t *sim_agents = NULL;
+static sim_worker_t *sim_workers = NULL;
+/// ifOperStatus of all interfaces, index agent * port_count + port - 1.
+static atomic_uchar *sim_oper_status = NULL;
+static atomic_bool sim_running = false;
+static atomic_uint_fast64_t sim_requests = 0;
+static struct timespec sim_start_time;
+
+/* -------------------------------------------------------------------------- */
+/* MIB                                                                        */
+/* -------------------------------------------------------------------------- */
+
+static void sim_add_entry(const uint32_t *prefix, int prefix_len, const uint32_t *index, int index_len, sim_value_kind_t kind, int port)
+{
+    sim_entry_t *entry = &sim_entries[sim_entry_count++];
+
+    memcpy(entry->oid, prefix, prefix_len * sizeof(uint32_t));
+    memcpy(entry->oid + prefix_len, index, index_len * sizeof(uint32_t));
+    entry->oid_len = prefix_len + index_len;
+    entry->kind = kind;
+    entry->port = port;
+}
+
+static int sim_oid_compare(const uint32_t *a, int a_len, const uint32_t *b, int b_len)
+{
+    int len = a_len < b_len ? a_len : b_len;
+
+    for(int i = 0; i < len; i++)
+    {
+        if(a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+
+    return a_len - b_len;
+}
+
+static int sim_entry_compare(const void *a, const void *b)
+{
+    const sim_entry_t *entry_a = a;
+    const sim_entry_t *entry_b = b;
+
+    return sim_oid_compare(entry_a->oid, entry_a->oid_len, entry_b->oid, entry_b->oid_len);
+}
+
+#define SIM_OID(...) (const uint32_t[]){ __VA_ARGS__ }, sizeof((const uint32_t[]){ __VA_ARGS__ }) / sizeof(uint32_t)
+
+/**
+ * @brief Builds the sorted OID table which is served by every agent.
+ */
+static void sim_build_mib(int port_count, int virtual_count)
+{
+    sim_entries = malloc((16 + 20 * port_count + 6 * virtual_count) * sizeof(sim_entry_t));
+    sim_entry_count = 0;
+
+    uint32_t scalar[] = { 0 };
+
+    sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 1, 1), scalar, 1, SIM_SYS_DESCR, 0);
+    sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 1, 3), scalar, 1, SIM_SYS_UPTIME, 0);
+    sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 31, 1, 5), scalar, 1, SIM_IF_TABLE_LAST_CHANGE, 0);
+    sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 2, 1), scalar, 1, SIM_LLDP_REM_TABLES_LAST_CHANGE, 0);
+    sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 3, 3), scalar, 1, SIM_LLDP_LOC_SYS_NAME, 0);
+    sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 3, 5), scalar, 1, SIM_LLDP_LOC_SYS_CAP, 0);
+    sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 3, 6), scalar, 1, SIM_LLDP_LOC_SYS_CAP, 0);
+
+    for(uint32_t port = 1; port <= (uint32_t)port_count; port++)
+    {
+        uint32_t if_index[] = { port };
+
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 1), if_index, 1, SIM_IF_INDEX, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 3), if_index, 1, SIM_IF_TYPE, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 5), if_index, 1, SIM_IF_SPEED, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 6), if_index, 1, SIM_IF_PHYS_ADDRESS, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 8), if_index, 1, SIM_IF_OPER_STATUS, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 1), if_index, 1, SIM_IF_NAME, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 3, 7, 1, 2), if_index, 1, SIM_LLDP_LOC_PORT_ID_SUBTYPE, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 3, 7, 1, 3), if_index, 1, SIM_LLDP_LOC_PORT_ID, port);
+
+        /// Neighbours on interface 1 and 2 connect the agents to a ring
+        if(port > 2 || sim_config.agent_count < 2)
+            continue;
+
+        /// lldpRemEntry index: lldpRemTimeMark.lldpRemLocalPortNum.lldpRemIndex
+        uint32_t rem_index[] = { 0, port, 1 };
+
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 4), rem_index, 3, SIM_LLDP_REM_CHASSIS_ID_SUBTYPE, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 5), rem_index, 3, SIM_LLDP_REM_CHASSIS_ID, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 6), rem_index, 3, SIM_LLDP_REM_PORT_ID_SUBTYPE, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 7), rem_index, 3, SIM_LLDP_REM_PORT_ID, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 9), rem_index, 3, SIM_LLDP_REM_SYS_NAME, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 11), rem_index, 3, SIM_LLDP_REM_SYS_CAP, port);
+        sim_add_entry(SIM_OID(1, 0, 8802, 1, 1, 2, 1, 4, 1, 1, 12), rem_index, 3, SIM_LLDP_REM_SYS_CAP, port);
+    }
+
+    /// VLAN interfaces and the loopback are only in the ifTable
+    for(uint32_t port = port_count + 1; port <= (uint32_t)(port_count + virtual_count); port++)
+    {
+        uint32_t if_index[] = { port };
+
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 1), if_index, 1, SIM_IF_INDEX, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 3), if_index, 1, SIM_IF_TYPE, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 5), if_index, 1, SIM_IF_SPEED, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 6), if_index, 1, SIM_IF_PHYS_ADDRESS, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 2, 2, 1, 8), if_index, 1, SIM_IF_OPER_STATUS, port);
+        sim_add_entry(SIM_OID(1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 1), if_index, 1, SIM_IF_NAME, port);
+    }
+
+    qsort(sim_entries, sim_entry_count, sizeof(sim_entry_t), sim_entry_compare);
+}
+
+/**
+ * @brief Returns the first entry greater than the OID (strictly) or equal to it (exact), -1 if there is none.
+ */
+static int sim_find(const uint32_t *oid, int oid_len, bool exact)
+{
+    int low = 0;
+    int high = sim_entry_count;
+
+    while(low < high)
+    {
+        int middle = (low + high) / 2;
+        int compare = sim_oid_compare(sim_entries[middle].oid, sim_entries[middle].oid_len, oid, oid_len);
+
+        if(compare < 0 || (!exact && compare == 0))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if(low >= sim_entry_count)
+        return -1;
+
+    if(exact && sim_oid_compare(sim_entries[low].oid, sim_entries[low].oid_len, oid, oid_len) != 0)
+        return -1;
+
+    return low;
+}
+
+/* -------------------------------------------------------------------------- */
+/* BER                                                                        */
+/* -------------------------------------------------------------------------- */
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} sim_reader_t;
+
+/**
+ * @brief Reads a TLV header, returns the content length or -1 on malformed data.
+ */
+static int sim_get_header(sim_reader_t *reader, uint8_t *tag)
+{
+    if(reader->pos + 2 > reader->len)
+        return -1;
+
+    *tag = reader->data[reader->pos++];
+    size_t len = reader->data[reader->pos++];
+
+    if(len & 0x80)
+    {
+        int count = len & 0x7F;
+        if(count > 3 || reader->pos + count > reader->len)
+            return -1;
+
+        len = 0;
+        while(count-- > 0)
+            len = (len << 8) | reader->data[reader->pos++];
+    }
+
+    if(reader->pos + len > reader->len)
+        return -1;
+
+    return (int)len;
+}
+
+static bool sim_get_integer(sim_reader_t *reader, int32_t *value)
+{
+    uint8_t tag;
+    int len = sim_get_header(reader, &tag);
+
+    if(len < 1 || len > 5 || tag != BER_INTEGER)
+        return false;
+
+    int32_t result = (reader->data[reader->pos] & 0x80) ? -1 : 0;
+    for(int i = 0; i < len; i++)
+        result = (int32_t)((uint32_t)result << 8 | reader->data[reader->pos++]);
+
+    *value = result;
+
+    return true;
+}
+
+static bool sim_get_oid(sim_reader_t *reader, uint32_t *oid, int *oid_len)
+{
+    uint8_t tag;
+    int len = sim_get_header(reader, &tag);
+
+    if(len < 1 || tag != BER_OID)
+        return false;
+
+    size_t end = reader->pos + len;
+    uint8_t first = reader->data[reader->pos++];
+
+    oid[0] = first / 40 < 2 ? first / 40 : 2;
+    oid[1] = first - oid[0] * 40;
+    *oid_len = 2;
+
+    uint32_t value = 0;
+    while(reader->pos < end)
+    {
+        uint8_t byte = reader->data[reader->pos++];
+        value = (value << 7) | (byte & 0x7F);
+
+        if(!(byte & 0x80))
+        {
+            if(*oid_len >= SIM_MAX_OID_LEN)
+                return false;
+
+            oid[(*oid_len)++] = value;
+            value = 0;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Agent                                                                      */
+/* -------------------------------------------------------------------------- */
+
+static void sim_mac_address(int agent, int port, uint8_t *mac)
+{
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = agent >> 8;
+    mac[3] = agent & 0xFF;
+    mac[4] = port >> 8;
+    mac[5] = port & 0xFF;
+}
+
+static void sim_neighbour(int agent, int port, int *neighbour_agent, int *neighbour_port)
+{
+    if(port == 1)
+    {
+        *neighbour_agent = (agent + 1) % sim_config.agent_count;
+        *neighbour_port = 2;
+    }
+    else
+    {
+        *neighbour_agent = (agent + sim_config.agent_count - 1) % sim_config.agent_count;
+        *neighbour_port = 1;
+    }
+}
+
+static uint64_t sim_now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint32_t sim_uptime_ticks(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - sim_start_time.tv_sec) * 100 + (now.tv_nsec - sim_start_time.tv_nsec) / 10000000;
+}
+
+static bool sim_put_string(sim_ber_buffer_t *buffer, const char *str)
+{
+    size_t len = strlen(str);
+    return sim_ber_put_header(buffer, BER_OCTET_STRING, len) && sim_ber_put(buffer, str, len);
+}
+
+/**
+ * @brief Encodes the value of an entry for an agent.
+ */
+static bool sim_put_value(sim_ber_buffer_t *buffer, const sim_entry_t *entry, int agent)
+{
+    char str[64];
+    uint8_t mac[6];
+    const uint8_t capabilities[2] = { 0x28, 0x00 }; /* bridge, router */
+    int neighbour_agent = 0;
+    int neighbour_port = 0;
+
+    if(entry->kind >= SIM_LLDP_REM_CHASSIS_ID_SUBTYPE)
+        sim_neighbour(agent, entry->port, &neighbour_agent, &neighbour_port);
+
+    switch(entry->kind)
+    {
+        case SIM_SYS_DESCR:
+            snprintf(str, sizeof(str), "Simulated switch %d", agent);
+            return sim_put_string(buffer, str);
+        case SIM_SYS_UPTIME:
+            return sim_ber_put_unsigned(buffer, BER_TIMETICKS, sim_uptime_ticks());
+        case SIM_IF_TABLE_LAST_CHANGE:
+            return sim_ber_put_unsigned(buffer, BER_TIMETICKS, atomic_load(&sim_agents[agent].if_table_last_change));
+        case SIM_LLDP_REM_TABLES_LAST_CHANGE:
+            return sim_ber_put_unsigned(buffer, BER_TIMETICKS, 0);
+        case SIM_IF_INDEX:
+            return sim_ber_put_integer(buffer, entry->port);
+        case SIM_IF_TYPE:
+            if(entry->port <= sim_config.port_count)
+                return sim_ber_put_integer(buffer, 6); /* ethernetCsmacd */
+            if(entry->port < sim_config.port_count + sim_config.virtual_count)
+                return sim_ber_put_integer(buffer, 136); /* l3ipvlan */
+            return sim_ber_put_integer(buffer, 24); /* softwareLoopback */
+        case SIM_IF_SPEED:
+            return sim_ber_put_unsigned(buffer, BER_GAUGE32, 1000000000);
+        case SIM_IF_PHYS_ADDRESS:
+            /// VLAN interfaces share the address of the switch
+            sim_mac_address(agent, entry->port <= sim_config.port_count ? entry->port : 0, mac);
+            return sim_ber_put_header(buffer, BER_OCTET_STRING, 6) && sim_ber_put(buffer, mac, 6);
+        case SIM_IF_OPER_STATUS:
+            if(entry->port > sim_config.port_count)
+                return sim_ber_put_integer(buffer, 1); /* up */
+            return sim_ber_put_integer(buffer, atomic_load(&sim_oper_status[agent * sim_config.port_count + entry->port - 1]));
+        case SIM_IF_NAME:
+            if(entry->port > sim_config.port_count)
+            {
+                snprintf(str, sizeof(str), "vlan%d", entry->port - sim_config.port_count);
+                return sim_put_string(buffer, str);
+            }
+            snprintf(str, sizeof(str), "port%d", entry->port);
+            return sim_put_string(buffer, str);
+        case SIM_LLDP_LOC_PORT_ID:
+            snprintf(str, sizeof(str), "port%d", entry->port);
+            return sim_put_string(buffer, str);
+        case SIM_LLDP_LOC_SYS_NAME:
+            snprintf(str, sizeof(str), "sim%d", agent);
+            return sim_put_string(buffer, str);
+        case SIM_LLDP_LOC_SYS_CAP:
+        case SIM_LLDP_REM_SYS_CAP:
+            return sim_ber_put_header(buffer, BER_OCTET_STRING, 2) && sim_ber_put(buffer, capabilities, 2);
+        case SIM_LLDP_LOC_PORT_ID_SUBTYPE:
+        case SIM_LLDP_REM_PORT_ID_SUBTYPE:
+            return sim_ber_put_integer(buffer, 5); /* interfaceName */
+        case SIM_LLDP_REM_CHASSIS_ID_SUBTYPE:
+            return sim_ber_put_integer(buffer, 4); /* macAddress */
+        case SIM_LLDP_REM_CHASSIS_ID:
+            sim_mac_address(neighbour_agent, neighbour_port, mac);
+            return sim_ber_put_header(buffer, BER_OCTET_STRING, 6) && sim_ber_put(buffer, mac, 6);
+        case SIM_LLDP_REM_PORT_ID:
+            snprintf(str, sizeof(str), "port%d", neighbour_port);
+            return sim_put_string(buffer, str);
+        case SIM_LLDP_REM_SYS_NAME:
+            snprintf(str, sizeof(str), "sim%d", neighbour_agent);
+            return sim_put_string(buffer, str);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Appends a varbind, entry -1 encodes the exception given in exception_tag.
+ */
+static bool sim_put_varbind(sim_ber_buffer_t *buffer, const uint32_t *oid, int oid_len, int entry, uint8_t exception_tag, int agent)
+{
+    uint8_t oid_ber[SIM_MAX_OID_LEN * 5];
+    uint8_t value_data[128];
+    sim_ber_buffer_t value = { value_data, 0, sizeof(value_data) };
+
+    if(entry >= 0)
+    {
+        oid = sim_entries[entry].oid;
+        oid_len = sim_entries[entry].oid_len;
+        sim_put_value(&value, &sim_entries[entry], agent);
+    }
+    else
+    {
+        sim_ber_put_header(&value, exception_tag, 0);
+    }
+
+    int oid_ber_len = sim_ber_encode_oid(oid, oid_len, oid_ber);
+    size_t content_len = sim_ber_header_len(oid_ber_len) + oid_ber_len + value.len;
+
+    return sim_ber_put_header(buffer, BER_SEQUENCE, content_len)
+        && sim_ber_put_header(buffer, BER_OID, oid_ber_len)
+        && sim_ber_put(buffer, oid_ber, oid_ber_len)
+        && sim_ber_put(buffer, value.data, value.len);
+}
+
+/**
+ * @brief Answers a single request, returns the length of the response or 0 if the request gets ignored.
+ */
+static size_t sim_handle_request(int agent, const uint8_t *request, size_t request_len, uint8_t *response, size_t response_capacity)
+{
+    sim_reader_t reader = { request, request_len, 0 };
+    uint8_t tag;
+    int32_t version, request_id, non_repeaters, max_repetitions;
+
+    if(sim_get_header(&reader, &tag) < 0 || tag != BER_SEQUENCE)
+        return 0;
+    if(!sim_get_integer(&reader, &version) || version > 1)
+        return 0;
+
+    int community_len = sim_get_header(&reader, &tag);
+    if(community_len < 0 || tag != BER_OCTET_STRING)
+        return 0;
+    const char *community = (const char *)request + reader.pos;
+    reader.pos += community_len;
+
+    if((size_t)community_len != strlen(sim_config.community) || memcmp(community, sim_config.community, community_len) != 0)
+        return 0;
+
+    uint8_t pdu_type;
+    if(sim_get_header(&reader, &pdu_type) < 0)
+        return 0;
+    if(pdu_type != PDU_GET && pdu_type != PDU_GETNEXT && (pdu_type != PDU_GETBULK || version == 0))
+        return 0;
+
+    if(!sim_get_integer(&reader, &request_id) || !sim_get_integer(&reader, &non_repeaters) || !sim_get_integer(&reader, &max_repetitions))
+        return 0;
+
+    if(sim_get_header(&reader, &tag) < 0 || tag != BER_SEQUENCE)
+        return 0;
+
+    static _Thread_local uint32_t oids[SIM_MAX_VARBINDS][SIM_MAX_OID_LEN];
+    int oid_lens[SIM_MAX_VARBINDS];
+    int varbind_count = 0;
+
+    while(reader.pos < reader.len && varbind_count < SIM_MAX_VARBINDS)
+    {
+        if(sim_get_header(&reader, &tag) < 0 || tag != BER_SEQUENCE)
+            return 0;
+        if(!sim_get_oid(&reader, oids[varbind_count], &oid_lens[varbind_count]))
+            return 0;
+
+        /// Skip the value, it's NULL in requests
+        int value_len = sim_get_header(&reader, &tag);
+        if(value_len < 0)
+            return 0;
+        reader.pos += value_len;
+
+        varbind_count++;
+    }
+
+    uint8_t varbinds_data[SIM_MAX_RESPONSE];
+    sim_ber_buffer_t varbinds = { varbinds_data, 0, sizeof(varbinds_data) };
+    if(sim_config.max_response > 0 && (size_t)sim_config.max_response < varbinds.capacity)
+        varbinds.capacity = sim_config.max_response;
+    int error_status = 0;
+    int error_index = 0;
+
+    if(pdu_type == PDU_GETBULK)
+    {
+        if(non_repeaters < 0)
+            non_repeaters = 0;
+        if(non_repeaters > varbind_count)
+            non_repeaters = varbind_count;
+        if(max_repetitions < 0)
+            max_repetitions = 0;
+
+        for(int i = 0; i < non_repeaters; i++)
+        {
+            int entry = sim_find(oids[i], oid_lens[i], false);
+            sim_put_varbind(&varbinds, oids[i], oid_lens[i], entry, BER_END_OF_MIB_VIEW, agent);
+        }
+
+        /// Position of each repeater in the MIB, the rows are interleaved like RFC 3416 asks for
+        int positions[SIM_MAX_VARBINDS];
+        for(int i = non_repeaters; i < varbind_count; i++)
+            positions[i] = sim_find(oids[i], oid_lens[i], false);
+
+        for(int repetition = 0; repetition < max_repetitions; repetition++)
+        {
+            bool all_done = true;
+            size_t row_start = varbinds.len;
+
+            for(int i = non_repeaters; i < varbind_count; i++)
+            {
+                int entry = positions[i];
+                if(!sim_put_varbind(&varbinds, oids[i], oid_lens[i], entry, BER_END_OF_MIB_VIEW, agent))
+                {
+                    /// Response full, drop the incomplete row
+                    varbinds.len = row_start;
+                    repetition = max_repetitions;
+                    break;
+                }
+
+                if(entry >= 0)
+                {
+                    memcpy(oids[i], sim_entries[entry].oid, sim_entries[entry].oid_len * sizeof(uint32_t));
+                    oid_lens[i] = sim_entries[entry].oid_len;
+                    positions[i] = entry + 1 < sim_entry_count ? entry + 1 : -1;
+                    all_done = false;
+                }
+            }
+
+            if(all_done)
+                break;
+        }
+    }
+    else
+    {
+        for(int i = 0; i < varbind_count; i++)
+        {
+            int entry = sim_find(oids[i], oid_lens[i], pdu_type == PDU_GET);
+
+            if(entry < 0 && version == 0)
+            {
+                /// SNMPv1 has no exceptions, the request is returned with noSuchName
+                error_status = SNMP_ERROR_NO_SUCH_NAME;
+                error_index = i + 1;
+                varbinds.len = 0;
+
+                for(int j = 0; j < varbind_count; j++)
+                    sim_put_varbind(&varbinds, oids[j], oid_lens[j], -1, BER_NULL, agent);
+                break;
+            }
+
+            if(!sim_put_varbind(&varbinds, oids[i], oid_lens[i], entry, pdu_type == PDU_GET ? BER_NO_SUCH_OBJECT : BER_END_OF_MIB_VIEW, agent))
+            {
+                /// The response doesn't fit, it is answered with an empty varbind list (RFC 3416 4.2.1)
+                error_status = SNMP_ERROR_TOO_BIG;
+                error_index = 0;
+                varbinds.len = 0;
+                break;
+            }
+        }
+    }
+
+    /// Wrap the varbinds into the PDU and the message
+    uint8_t header_data[64];
+    sim_ber_buffer_t pdu_header = { header_data, 0, sizeof(header_data) };
+    sim_ber_put_integer(&pdu_header, request_id);
+    sim_ber_put_integer(&pdu_header, error_status);
+    sim_ber_put_integer(&pdu_header, error_index);
+    sim_ber_put_header(&pdu_header, BER_SEQUENCE, varbinds.len);
+
+    size_t pdu_len = pdu_header.len + varbinds.len;
+
+    uint8_t message_header_data[64];
+    sim_ber_buffer_t message_header = { message_header_data, 0, sizeof(message_header_data) };
+    sim_ber_put_integer(&message_header, version);
+    sim_ber_put_header(&message_header, BER_OCTET_STRING, community_len);
+    sim_ber_put(&message_header, community, community_len);
+    sim_ber_put_header(&message_header, PDU_RESPONSE, pdu_len);
+
+    sim_ber_buffer_t out = { response, 0, response_capacity };
+    sim_ber_put_header(&out, BER_SEQUENCE, message_header.len + pdu_len);
+    sim_ber_put(&out, message_header.data, message_header.len);
+    sim_ber_put(&out, pdu_header.data, pdu_header.len);
+    sim_ber_put(&out, varbinds.data, varbinds.len);
+
+    return out.len;
+}
+
+static void sim_delay_response(sim_worker_t *worker, int socket, const struct sockaddr_in *peer, socklen_t peer_len, const uint8_t *response, size_t len)
+{
+    sim_delayed_t *delayed = malloc(sizeof(sim_delayed_t) + len);
+    delayed->next = NULL;
+    delayed->due_us = sim_now_us() + sim_config.latency_us;
+    delayed->socket = socket;
+    delayed->peer = *peer;
+    delayed->peer_len = peer_len;
+    delayed->len = len;
+    memcpy(delayed->data, response, len);
+
+    if(worker->delayed_tail != NULL)
+        worker->delayed_tail->next = delayed;
+    else
+        worker->delayed_head = delayed;
+    worker->delayed_tail = delayed;
+}
+
+/**
+ * @brief Sends the delayed responses which are due.
+ *
+ * @return milliseconds until the next delayed response is due, 100 if there is none.
+ */
+static int sim_send_delayed(sim_worker_t *worker)
+{
+    uint64_t now_us = sim_now_us();
+
+    while(worker->delayed_head != NULL && worker->delayed_head->due_us <= now_us)
+    {
+        sim_delayed_t *delayed = worker->delayed_head;
+        sendto(delayed->socket, delayed->data, delayed->len, 0, (struct sockaddr *)&delayed->peer, delayed->peer_len);
+        atomic_fetch_add_explicit(&sim_requests, 1, memory_order_relaxed);
+
+        worker->delayed_head = delayed->next;
+        if(worker->delayed_head == NULL)
+            worker->delayed_tail = NULL;
+        free(delayed);
+    }
+
+    if(worker->delayed_head == NULL)
+        return 100;
+
+    uint64_t wait_ms = (worker->delayed_head->due_us - now_us + 999) / 1000;
+    return wait_ms < 100 ? (int)wait_ms : 100;
+}
+
+/**
+ * @brief Counts a received request in the one second window of the agent, which starts with the first request after
+ * the previous window.
+ */
+static void sim_count_request(sim_agent_t *agent)
+{
+    uint64_t now_us = sim_now_us();
+
+    if(now_us - agent->window_start_us >= 1000000)
+    {
+        agent->window_start_us = now_us;
+        agent->window_count = 0;
+    }
+
+    if(++agent->window_count > atomic_load(&agent->peak_rate))
+        atomic_store(&agent->peak_rate, agent->window_count);
+}
+
+static void *sim_worker_thread(void *param)
+{
+    sim_worker_t *worker = param;
+    struct epoll_event events[64];
+    uint8_t request[SIM_MAX_PACKET];
+    uint8_t response[SIM_MAX_RESPONSE + 256];
+    int timeout_ms = 100;
+
+    while(atomic_load(&sim_running))
+    {
+        int count = epoll_wait(worker->epoll_fd, events, 64, timeout_ms);
+
+        for(int i = 0; i < count; i++)
+        {
+            sim_agent_t *agent = events[i].data.ptr;
+            struct sockaddr_in peer;
+            socklen_t peer_len = sizeof(peer);
+
+            ssize_t len;
+            while((len = recvfrom(agent->socket, request, sizeof(request), MSG_DONTWAIT, (struct sockaddr *)&peer, &peer_len)) > 0)
+            {
+                sim_count_request(agent);
+
+                size_t response_len = sim_handle_request(agent->agent, request, len, response, sizeof(response));
+                if(response_len == 0)
+                    continue;
+
+                if(sim_config.response_delay_us > 0)
+                    usleep(sim_config.response_delay_us);
+
+                if(sim_config.latency_us > 0)
+                {
+                    sim_delay_response(worker, agent->socket, &peer, peer_len, response, response_len);
+                }
+                else
+                {
+                    sendto(agent->socket, response, response_len, 0, (struct sockaddr *)&peer, peer_len);
+                    atomic_fetch_add_explicit(&sim_requests, 1, memory_order_relaxed);
+                }
+
+                peer_len = sizeof(peer);
+            }
+        }
+
+        timeout_ms = sim_send_delayed(worker);
+    }
+
+    while(worker->delayed_head != NULL)
+    {
+        sim_delayed_t *delayed = worker->delayed_head;
+        worker->delayed_head = delayed->next;
+        free(delayed);
+    }
+    worker->delayed_tail = NULL;
+
+    return NULL;
+}
+
+/**
+ * @brief Returns the IPv4 address of an agent in host byte order.
+ */
+uint32_t sim_agent_address(int agent)
+{
+    return SIM_BASE_ADDRESS + 1 + agent;
+}
+
+/**
+ * @brief Starts the simulated agents, each agent listens on its own loopback address.
+ *
+ * @param config settings of the fleet, the community string must stay valid until sim_stop.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int sim_start(const sim_config_t *config)
+{
+    sim_config = *config;
+    if(sim_config.thread_count < 1)
+        sim_config.thread_count = 1;
+
+    if(sim_config.virtual_count < 0)
+        sim_config.virtual_count = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &sim_start_time);
+    sim_build_mib(sim_config.port_count, sim_config.virtual_count);
+
+    sim_agents = calloc(sim_config.agent_count, sizeof(sim_agent_t));
+    sim_workers = calloc(sim_config.thread_count, sizeof(sim_worker_t));
+    sim_oper_status = malloc(sim_config.agent_count * sim_config.port_count * sizeof(atomic_uchar));
+
+    for(int i = 0; i < sim_config.agent_count * sim_config.port_count; i++)
+        atomic_init(&sim_oper_status[i], 1); /* up */
+
+    for(int i = 0; i < sim_config.thread_count; i++)
+        sim_workers[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    for(int agent = 0; agent < sim_config.agent_count; agent++)
+    {
+        sim_agent_t *sim_agent = &sim_agents[agent];
+        sim_agent->agent = agent;
+        sim_agent->socket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(SIM_PORT);
+        address.sin_addr.s_addr = htonl(sim_agent_address(agent));
+
+        if(sim_agent->socket < 0 || bind(sim_agent->socket, (struct sockaddr *)&address, sizeof(address)))
+        {
+            printf(KRED "[ERROR] sim_start couldn't bind agent %d to %s:%d, root is needed for port 161.\n" KNORMAL, agent, inet_ntoa(address.sin_addr), SIM_PORT);
+            return EXIT_FAILURE;
+        }
+
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = sim_agent };
+        epoll_ctl(sim_workers[agent % sim_config.thread_count].epoll_fd, EPOLL_CTL_ADD, sim_agent->socket, &event);
+    }
+
+    atomic_store(&sim_running, true);
+
+    for(int i = 0; i < sim_config.thread_count; i++)
+        pthread_create(&sim_workers[i].thread, NULL, sim_worker_thread, &sim_workers[i]);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Stops all agents.
+ */
+void sim_stop(void)
+{
+    if(atomic_exchange(&sim_running, false))
+    {
+        for(int i = 0; i < sim_config.thread_count; i++)
+            pthread_join(sim_workers[i].thread, NULL);
+    }
+
+    for(int agent = 0; agent < sim_config.agent_count && sim_agents != NULL; agent++)
+    {
+        if(sim_agents[agent].socket > 0)
+            close(sim_agents[agent].socket);
+    }
+
+    for(int i = 0; i < sim_config.thread_count && sim_workers != NULL; i++)
+        close(sim_workers[i].epoll_fd);
+
+    free(sim_agents);
+    free(sim_workers);
+    free(sim_entries);
+    free(sim_oper_status);
+    sim_agents = NULL;
+    sim_workers = NULL;
+    sim_entries = NULL;
+    sim_oper_status = NULL;
+}
+
+/**
+ * @brief Returns the number of answered requests of all agents.
+ */
+uint64_t sim_requests_served(void)
+{
+    return atomic_load(&sim_requests);
+}
+
+/**
+ * @brief Returns the most requests a single agent received within one second.
+ */
+int sim_peak_agent_rate(void)
+{
+    int peak = 0;
+
+    for(int i = 0; sim_agents != NULL && i < sim_config.agent_count; i++)
+    {
+        if(atomic_load(&sim_agents[i].peak_rate) > peak)
+            peak = atomic_load(&sim_agents[i].peak_rate);
+    }
+
+    return peak;
+}
+
+/**
+ * @brief Returns the number of OIDs served by each agent.
+ */
+int sim_varbinds_per_agent(void)
+{
+    return sim_entry_count;
+}
+
+/**
+ * @brief Changes the ifOperStatus of an interface, e.g. before a linkDown or linkUp trap is sent.
+ *
+ * ifTableLastChange of the agent is set to the current sysUpTime, unless frozen_last_change is set.
+ *
+ * @param agent number of the agent.
+ * @param port interface number, starting at 1.
+ * @param status new ifOperStatus, 1 = up, 2 = down.
+ */
+void sim_set_oper_status(int agent, int port, int status)
+{
+    if(agent < 0 || agent >= sim_config.agent_count || port < 1 || port > sim_config.port_count)
+        return;
+
+    atomic_store(&sim_oper_status[agent * sim_config.port_count + port - 1], status);
+    if(!sim_config.frozen_last_change)
+        atomic_store(&sim_agents[agent].if_table_last_change, sim_uptime_ticks());
+}
+
+/**
+ * @brief Returns the sysUpTime of the agents in hundredths of a second.
+ */
+uint32_t sim_uptime(void)
+{
+    return sim_uptime_ticks();
+}
@@ -0,0 +1,52 @@
+#ifndef SNMP_AGENT_SIM_H
+#define SNMP_AGENT_SIM_H
+
+#include <stdint.h>
+
+/// First address of the simulated agents, agent i listens on SIM_BASE_ADDRESS + i.
+#ifndef SIM_BASE_ADDRESS
+#define SIM_BASE_ADDRESS 0x7F010000 /* 127.1.0.0 */
+#endif
+
+#ifndef SIM_PORT
+#define SIM_PORT 161
+#endif
+
+/// Largest number of sub identifiers of a served OID.
+#define SIM_MAX_OID_LEN 24
+
+/**
+ * Settings of the simulated agent fleet
+ */
+typedef struct
+{
+    /// Number of agents, each gets its own loopback address.
+    int agent_count;
+    /// Number of interfaces per agent, interface 1 and 2 are linked to the neighbouring agents (ring).
+    int port_count;
+    /// Number of VLAN interfaces per agent after the ports, the last one is a loopback. They have no LLDP neighbours.
+    int virtual_count;
+    /// Threads serving the agents, the agents are distributed over the threads.
+    int thread_count;
+    /// Only requests with this community get answered.
+    const char *community;
+    /// Delay before each response in microseconds, simulates slow agents.
+    int response_delay_us;
+    /// Round trip time in microseconds added to each response without blocking the agent, simulates a WAN link.
+    int latency_us;
+    /// Largest varbind list of a response in bytes, 0 for SIM_MAX_RESPONSE. Simulates agents with small message buffers.
+    int max_response;
+    /// ifTableLastChange stays the same when an ifOperStatus changes, simulates agents which only update it when rows are added or removed.
+    int frozen_last_change;
+} sim_config_t;
+
+int sim_start(const sim_config_t *config);
+void sim_stop(void);
+uint32_t sim_agent_address(int agent);
+uint64_t sim_requests_served(void);
+int sim_peak_agent_rate(void);
+int sim_varbinds_per_agent(void);
+void sim_set_oper_status(int agent, int port, int status);
+uint32_t sim_uptime(void);
+
+#endif
@@ -18,6 +18,7 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 #include <stdio.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -36,7 +37,6 @@
 #endif
 
 #define MAX_COMMUNITIES 16384
-#define MAX_HOSTS 65535
 #define MAX_COMMUNITY_SIZE 32
 
 char* snmp_errors[] = {
@@ -67,19 +67,27 @@ struct {
   int port;
   int print_ip;
   int quiet;
+  int v3;
   long wait;
+  long tail_wait;
   FILE* log_fd;
 } o;
 
 int community_count = 2;
 char* community[MAX_COMMUNITIES] = { "public", "private" };
 
-int host_count = 0;
-struct {
-  int addr;
-  char* sysDescr;
-  /*	char* communities[];*/
-} host[MAX_HOSTS];
+/* targets are kept as address ranges in host byte order and expanded while sending,
+   so the memory doesn't grow with the number of hosts */
+unsigned long host_count = 0;
+struct host_range {
+  uint32_t first;
+  uint32_t last;
+} *host_range = NULL;
+int host_range_count = 0;
+int host_range_capacity = 0;
+
+/* community of the last parsed response, printed with -s if several communities are probed */
+char response_community[MAX_COMMUNITY_SIZE + 1];
 
 
 void usage()
@@ -94,11 +102,12 @@ void usage()
   printf("  -s                 short mode, only print IP addresses\n\n");
   printf("  -w n               wait n milliseconds (1/1000 of a second) between sending packets (default 10)\n");
   printf("  -q                 quiet mode, do not print log to stdout, use with -l\n");
-  printf("host is either an IPv4 address or an IPv4 address and a netmask\n");
+  printf("  -3                 also send a SNMPv3 engine discovery probe to each host\n");
+  printf("  -t n               wait n milliseconds for late responses after the last packet (default 5000)\n");
+  printf("host is either an IPv4 address, an IPv4 address and a netmask or a range first-last\n");
   printf("default community names are:");
   for (i = 0; i < community_count; i++) printf(" %s", community[i]);
   printf("\n\n");
-  printf("Max number of hosts : \t\t%d\n", MAX_HOSTS);
   printf("Max community length: \t\t%d\n", MAX_COMMUNITY_SIZE);
   printf("Max number of communities: \t%d\n", MAX_COMMUNITIES);
   printf("\n\n");
@@ -148,21 +157,42 @@ void read_communities(char* filename)
   fclose(fd);
 }
 
+int parse_ipv4(const char *addr, uint32_t *ip)
+{
+  struct addrinfo hints;
+  struct addrinfo *result = NULL;
+
+  memset(&hints, 0, sizeof(struct addrinfo));
+  hints.ai_family = AF_INET;	 /* Allow IPv4 */
+  hints.ai_socktype = SOCK_DGRAM; /* Datagram socket */
+  hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV; /* no dns */
+  hints.ai_protocol = 0;			 /* IPv4 */
+  hints.ai_canonname = NULL;
+  hints.ai_addr = NULL;
+  hints.ai_next = NULL;
+
+  if (getaddrinfo(addr, NULL, &hints, &result) != 0) {
+    return -1;
+  }
+
+  *ip = ntohl(((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(result);
+  return 0;
+}
+
 int add_host(const char *ipmask)
 {
   int ret = -1;
   char *addr = NULL;
   char *slash;
-  struct addrinfo hints;
-  struct addrinfo *result = NULL;
-  in_addr_t longtmp;
-  unsigned long i, ips;
-  struct in_addr startaddr;
-  struct in_addr endaddr;
+  char *dash;
+  uint32_t startaddr;
+  uint32_t endaddr;
   int netmask = 32;
 
   addr = strdup(ipmask);
   slash = strchr(addr, '/');
+  dash = strchr(addr, '-');
   if (slash != NULL) {
     netmask = atoi(slash + 1);
     if (netmask <= 0 || netmask > 32) {
@@ -171,39 +201,41 @@ int add_host(const char *ipmask)
     *slash = '\0';
   }
 
-
-  memset(&hints, 0, sizeof(struct addrinfo));
-  hints.ai_family = AF_INET;	 /* Allow IPv4 */
-  hints.ai_socktype = SOCK_DGRAM; /* Datagram socket */
-  hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV; /* no dns */
-  hints.ai_protocol = 0;			 /* IPv4 */
-  hints.ai_canonname = NULL;
-  hints.ai_addr = NULL;
-  hints.ai_next = NULL;
-
-  if (getaddrinfo(addr, NULL, &hints, &result) != 0) {
-    goto OUT;
+  if (dash != NULL && slash == NULL) {
+    *dash = '\0';
+    if (parse_ipv4(addr, &startaddr) == -1 || parse_ipv4(dash + 1, &endaddr) == -1) {
+      goto OUT;
+    }
+  }
+  else {
+    if (parse_ipv4(addr, &startaddr) == -1) {
+      goto OUT;
+    }
+    endaddr = startaddr | (netmask == 32 ? 0 : 0xffffffffu >> netmask);
+    startaddr = startaddr & (netmask == 32 ? 0xffffffffu : ~(0xffffffffu >> netmask));
   }
 
-  longtmp = ntohl(((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr);
-  startaddr.s_addr = longtmp & (0 - (1 << (32 - netmask)));
-  endaddr.s_addr = longtmp | ((1 << (32 - netmask)) - 1);
-  if (startaddr.s_addr > endaddr.s_addr) {
+  if (startaddr > endaddr) {
     goto OUT;
   }
 
-  ips = endaddr.s_addr - startaddr.s_addr + 1;
-  for (i = 0; i < ips; i++) {
-    if (host_count >= MAX_HOSTS) {
-      goto OUT;
+  if (host_range_count == host_range_capacity) {
+    host_range_capacity = host_range_capacity ? host_range_capacity * 2 : 16;
+    host_range = realloc(host_range, host_range_capacity * sizeof(*host_range));
+    if (host_range == NULL) {
+      printf("Out of memory\n");
+      exit(1);
     }
-    host[host_count++].addr = htonl(startaddr.s_addr++);
   }
+
+  host_range[host_range_count].first = startaddr;
+  host_range[host_range_count].last = endaddr;
+  host_range_count++;
+  host_count += (unsigned long)(endaddr - startaddr) + 1;
   ret = 0;
 
 OUT:
   free(addr);
-  freeaddrinfo(result);
   return ret;
 }
 
@@ -227,6 +259,7 @@ void read_hosts(char* filename)
   }
 
   host_count = 0;
+  host_range_count = 0;
   c = 0; ch = 0;
 
   do {
@@ -252,7 +285,7 @@ void read_hosts(char* filename)
 
   if (fd != stdin) fclose(fd);
 
-  if (o.debug > 0) printf("%d hosts read from file\n", host_count);
+  if (o.debug > 0) printf("%lu hosts in %d ranges read from file\n", host_count, host_range_count);
 }
 
 void init_options(int argc, char *argv[])
@@ -270,13 +303,15 @@ void init_options(int argc, char *argv[])
   o.port = 161;
   o.print_ip = 0;
   o.quiet = 0;
+  o.v3 = 0;
   o.wait = 10;
+  o.tail_wait = 5000;
   input_file = 0;
   community_file = 0;
 
   o.log_fd = NULL;
 
-  while ((arg = getopt(argc, argv, "c:di:o:p:s:w:q")) != EOF) {
+  while ((arg = getopt(argc, argv, "c:di:o:p:s:w:q3t:")) != EOF) {
     switch (arg) {
     case 'c':	community_file = 1;
       strncpy(community_filename, optarg, sizeof(community_filename));
@@ -304,6 +339,10 @@ void init_options(int argc, char *argv[])
       break;
     case 'q':	o.quiet = 1;
       break;
+    case 't':  o.tail_wait = atol(optarg);
+      break;
+    case '3':	o.v3 = 1;
+      break;
     case '?':  usage();
       exit(1);
       break;
@@ -646,6 +685,14 @@ int parse_snmp_community(u_char* buf, int buf_size, int* i)
     return -1;
   }
 
+  int j = *i;
+  int len = parse_asn_length(buf, buf_size, &j);
+  if (len >= 0) {
+    if (len > MAX_COMMUNITY_SIZE) len = MAX_COMMUNITY_SIZE;
+    memcpy(response_community, buf + j, len);
+    response_community[len] = 0;
+  }
+
   logr("[");
   if (print_asn_string(buf, buf_size, i) == -1)
     return -1;
@@ -784,29 +831,77 @@ int parse_snmp_value(u_char* buf, int buf_size, int* i)
   return 0;
 }
 
-void parse_snmp_response(u_char* buf, int buf_size)
+int parse_snmp_response(u_char* buf, int buf_size)
 {
   int i;
 
   i = 0;
+  response_community[0] = 0;
 
-  if (parse_snmp_header(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_version(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_community(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_pdu(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_requestid(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_errorcode(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_errorindex(buf, buf_size, &i) == -1) return;
+  if (parse_snmp_header(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_version(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_community(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_pdu(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_requestid(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_errorcode(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_errorindex(buf, buf_size, &i) == -1) return -1;
 
   if (i + 3 <= buf_size && buf[i] == 0x00 && buf[i + 1] == 0x30 && buf[i + 2] == 0x20)	// Bug in an HP JetDirect
     i += 3;
 
-  if (parse_snmp_objheader(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_objheader(buf, buf_size, &i) == -1) return;		// yes, this should be called twice
-  if (parse_snmp_objheader6(buf, buf_size, &i) == -1) return;
-  if (parse_snmp_value(buf, buf_size, &i) == -1) return;
+  if (parse_snmp_objheader(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_objheader(buf, buf_size, &i) == -1) return -1;		// yes, this should be called twice
+  if (parse_snmp_objheader6(buf, buf_size, &i) == -1) return -1;
+  if (parse_snmp_value(buf, buf_size, &i) == -1) return -1;
 
   logr("\n");
+
+  return 0;
+}
+
+/* any SNMPv3 message, e.g. the report answering an engine discovery probe */
+int is_snmpv3_message(u_char* buf, int buf_size)
+{
+  int i = 1;
+
+  if (buf_size < 2 || buf[0] != 0x30)
+    return 0;
+  if (parse_asn_length(buf, buf_size, &i) < 0)
+    return 0;
+
+  return i + 3 <= buf_size && buf[i] == 0x02 && buf[i + 1] == 0x01 && buf[i + 2] == 0x03;
+}
+
+/* SNMPv3 GET without user and engine id, agents answer with a usmStatsUnknownEngineIDs report */
+int build_snmpv3_discovery(char* buf)
+{
+  static const u_char probe[] = {
+    0x30, 0x3e,
+    0x02, 0x01, 0x03,                                     /* msgVersion 3 */
+    0x30, 0x11,                                           /* msgGlobalData */
+    0x02, 0x04, 0x00, 0x00, 0x00, 0x00,                   /* msgID */
+    0x02, 0x03, 0x00, 0xff, 0xe3,                         /* msgMaxSize 65507 */
+    0x04, 0x01, 0x04,                                     /* msgFlags reportable */
+    0x02, 0x01, 0x03,                                     /* msgSecurityModel USM */
+    0x04, 0x10, 0x30, 0x0e,                               /* msgSecurityParameters */
+    0x04, 0x00, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00,
+    0x04, 0x00, 0x04, 0x00, 0x04, 0x00,
+    0x30, 0x14,                                           /* scopedPDU */
+    0x04, 0x00, 0x04, 0x00,
+    0xa0, 0x0e,                                           /* GET */
+    0x02, 0x04, 0x00, 0x00, 0x00, 0x00,                   /* request id */
+    0x02, 0x01, 0x00, 0x02, 0x01, 0x00, 0x30, 0x00
+  };
+  static int id = 0x1610;
+
+  memcpy(buf, probe, sizeof(probe));
+  id = (id + 1) & 0x7fffffff;
+  buf[9] = buf[52] = (char)((id >> 24) & 0xff);
+  buf[10] = buf[53] = (char)((id >> 16) & 0xff);
+  buf[11] = buf[54] = (char)((id >> 8) & 0xff);
+  buf[12] = buf[55] = (char)(id & 0xff);
+
+  return sizeof(probe);
 }
 
 /* Subtract the `struct timeval' values X and Y,
@@ -879,12 +974,23 @@ void receive_snmp(int sock, long wait, struct sockaddr_in* remote_addr)
           printf("Error in recvfrom\n");
         }
       }
+      int v3 = ret > 0 && is_snmpv3_message((u_char*)&buf, ret);
+      int parsed = -1;
       logr("%s ", inet_ntoa(remote_addr->sin_addr));
-      parse_snmp_response((u_char*)&buf, ret);
+      if (v3)
+        logr("[v3]\n");
+      else
+        parsed = parse_snmp_response((u_char*)&buf, ret);
       if (o.print_ip) {
         int quiet = o.quiet;
         o.quiet = 0;
-        logr("%s\n", inet_ntoa(remote_addr->sin_addr));
+        /* the responding community is needed to tell several communities apart */
+        if (v3)
+          logr("%s v3\n", inet_ntoa(remote_addr->sin_addr));
+        else if (parsed == 0 && (community_count > 1 || o.v3))
+          logr("%s %s\n", inet_ntoa(remote_addr->sin_addr), response_community);
+        else
+          logr("%s\n", inet_ntoa(remote_addr->sin_addr));
         o.quiet = quiet;
       }
       if (o.log) fflush(o.log_fd);
@@ -900,7 +1006,8 @@ int main(int argc, char* argv[])
   struct sockaddr_in remote_addr;
   int sock;
   int ret;
-  int c, i;
+  int c, r;
+  uint32_t a;
   char sendbuf[1500];
   int sendbuf_size;
 
@@ -927,31 +1034,41 @@ int main(int argc, char* argv[])
   remote_addr.sin_family = AF_INET;
   remote_addr.sin_port = htons(o.port);
 
-  if (!o.quiet) printf("Scanning %d hosts, %d communities\n", host_count, community_count);
-
-  for (c = 0; c < community_count; c++) {
-    if (o.debug > 0) printf("Trying community %s\n", community[c]);
+  if (!o.quiet) printf("Scanning %lu hosts, %d communities\n", host_count, community_count);
 
-    sendbuf_size = build_snmp_req((char*)&sendbuf, sizeof(sendbuf), community[c]);
-
-    for (i = 0; i < host_count; i++) {
-      remote_addr.sin_addr.s_addr = host[i].addr;
+  /* all communities are sent to a host back to back, the wait between hosts paces the sweep.
+     Several communities don't multiply the scan time this way. */
+  for (r = 0; r < host_range_count; r++) {
+    for (a = host_range[r].first; ; a++) {
+      remote_addr.sin_addr.s_addr = htonl(a);
       if (o.debug > 1) printf("Sending to ip %s\n", inet_ntoa(*(struct in_addr*)&remote_addr.sin_addr.s_addr));
 
-      ret = sendto(sock, &sendbuf, sendbuf_size, 0, (struct sockaddr*)&remote_addr, sizeof(remote_addr));
-      if (ret < 0) {
-        if (!o.quiet) printf("Error in sendto: %s\n", strerror(errno));
-        /* exit(1); */
+      for (c = 0; c < community_count + o.v3; c++) {
+        if (c < community_count) {
+          if (o.debug > 1) printf("Trying community %s\n", community[c]);
+          sendbuf_size = build_snmp_req((char*)&sendbuf, sizeof(sendbuf), community[c]);
+        }
+        else {
+          sendbuf_size = build_snmpv3_discovery((char*)&sendbuf);
+        }
+
+        ret = sendto(sock, &sendbuf, sendbuf_size, 0, (struct sockaddr*)&remote_addr, sizeof(remote_addr));
+        if (ret < 0) {
+          if (!o.quiet) printf("Error in sendto: %s\n", strerror(errno));
+          /* exit(1); */
+        }
       }
 
       receive_snmp(sock, o.wait, &remote_addr);
+
+      if (a == host_range[r].last) break;
     }
   }
 
   if (o.debug > 0) printf("All packets sent, waiting for responses.\n");
 
-  /* wait for 5 seconds */
-  receive_snmp(sock, 5000, &remote_addr);
+  /* wait for late responses, 5 seconds by default */
+  receive_snmp(sock, o.tail_wait, &remote_addr);
 
   if (o.debug > 0) printf("done.\n");
 
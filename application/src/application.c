@@ -3,7 +3,6 @@
 #include <unistd.h>
 #include <signal.h>
 
-#include "lib/gll.h"
 #include "lib/sds.h"
 
 #include "ip.h"
@@ -13,6 +12,18 @@
 #include "snmp_trap.h"
 #include "network_tree_nodes.h"
 #include "database.h"
+#include "snmp_pipeline.h"
+#include "arena.h"
+#include "host_table.h"
+#include "stats.h"
+#include "metrics.h"
+#include "capture.h"
+#include "snmp_credential.h"
+#include "sweep_cache.h"
+#include "target_set.h"
+#include "sweeper.h"
+#include "snmp_walker.h"
+#include "snmp_policy.h"
 
 #include "snmp_oid.h"
 #include "snmp_parse.h"
@@ -21,6 +32,11 @@ static sds exec_path_str;
 static sds appl_name_str;
 static sqlite3 *database = NULL;
 
+/// Known hosts with their latest data, only used by the pipeline database stage while it runs.
+static host_table_t* host_table = NULL;
+/// Addresses to sweep, the host argument minus the -x exclusions
+static target_set_t target_set;
+
 /**
  * @brief Get the exec path and application name
  * 
@@ -64,10 +80,34 @@ void get_exec_path_and_appl_name(sds* exec_path_argv_str)
  */
 void clean_exit(int exit_code)
 {
+    /// The rescan submits to the pipeline and uses the sweep cache and the target set
+    sweeper_shutdown();
+
+    snmp_pipeline_shutdown();
+
+    snmp_walker_shutdown();
+
+    snmp_policy_shutdown();
+
+    snmp_credential_shutdown();
+
+    if(host_table != NULL)
+        host_table_destroy(host_table);
+
+    arena_pool_clear();
+
     snmp_oid_free_oid_lists();
 
     snmp_trap_wait_for_thread();
 
+    capture_shutdown();
+
+    sweep_cache_shutdown();
+    target_set_free(&target_set);
+
+    metrics_shutdown();
+    stats_shutdown();
+
     if(database != NULL)
         database_close(database);
 
@@ -78,6 +118,23 @@ void clean_exit(int exit_code)
     exit(exit_code);
 }
 
+/**
+ * @brief Saves the latest data of a host
+ * 
+ * Called by the pipeline database stage after a host has been written, replaces older data of the same host.
+ * 
+ * @param host_data_pair the host data pair that has been written.
+ */
+static void host_data_pair_written(host_data_pair_t *host_data_pair)
+{
+    host_entry_t *entry = host_table_insert(host_table, host_data_pair->host);
+
+    if(entry->host_data_pair != NULL)
+        snmp_parse_free_host_data_pair_t(entry->host_data_pair);
+
+    entry->host_data_pair = host_data_pair;
+}
+
 static volatile bool run_loop = true;
 
 static void signal_handler(int signo) {
@@ -88,19 +145,184 @@ static void signal_handler(int signo) {
 }
 
 
+/**
+ * @brief Replays a capture file through the parse and database stages of the pipeline.
+ *
+ * No SNMP requests are made, the walk results are taken from the capture as fast as the pipeline accepts them.
+ *
+ * @param capture_path path of a capture written with -w.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+static int replay_capture(const char *capture_path)
+{
+    capture_reader_t *reader = capture_reader_open(capture_path);
+    if(reader == NULL)
+        return EXIT_FAILURE;
+
+    host_table = host_table_init();
+
+    sds community_str = sdsempty();
+    int status = snmp_credential_setup(&community_str, NULL);
+    sdsfree(community_str);
+
+    if(status || snmp_pipeline_setup(&exec_path_str, snmp_oid_get_oid_init_list(), database, &host_data_pair_written))
+    {
+        capture_reader_close(reader);
+        return EXIT_FAILURE;
+    }
+
+    printf("Replaying %s\n", capture_path);
+
+    capture_record_t record;
+    int record_count = 0;
+    uint64_t varbind_count = 0;
+    uint64_t start_us = stats_now_us();
+
+    while(capture_reader_next(reader, &record) == EXIT_SUCCESS)
+    {
+        record_count++;
+        varbind_count += record.varbind_count;
+
+        /// The pipeline takes the ownership of the data
+        snmp_pipeline_submit_data(record.host, record.data_str);
+    }
+
+    capture_reader_close(reader);
+
+    snmp_pipeline_wait_idle();
+
+    int resolved_links_count = 0;
+    database_resolve_pending_links(database, &resolved_links_count);
+
+    double replay_s = (stats_now_us() - start_us) / 1e6;
+
+    stats_print_summary();
+    printf("Replayed %d walks (%d hosts, %llu varbinds) in %.3f s, %.1f walks/sec, %.1f varbinds/sec.\n",
+        record_count, host_table_size(host_table), (unsigned long long)varbind_count, replay_s,
+        record_count / replay_s, varbind_count / replay_s);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Sweeps the network and queues each found device in the pipeline as soon as it has been found.
+ *
+ * Responders of earlier runs are probed first, so their walks start right away. The addresses which never answered
+ * are only swept if the last full sweep is older than SWEEP_CACHE_FULL_INTERVAL, at a lower rate if known devices
+ * are being walked meanwhile.
+ *
+ * @param snmp_device_list returns the found devices.
+ */
+static void discovery_sweep(ipv4_vec_t* snmp_device_list)
+{
+    target_set_t sweep_set;
+    target_set_init(&sweep_set);
+
+    sweep_cache_get_responders(&sweep_set);
+    uint64_t responder_count = target_set_size(&sweep_set);
+    snmp_network_scan_run(&exec_path_str, &sweep_set, 0, SWEEP_CACHE_KNOWN_TAIL_MS, snmp_device_list);
+
+    if(responder_count > 0)
+        printf("%d of %llu cached SNMP devices answered.\n", snmp_device_list->size, (unsigned long long)responder_count);
+
+    for(int i = 0; i < snmp_device_list->size; i++)
+        snmp_pipeline_submit(snmp_device_list->data[i]);
+
+    int known_count = snmp_device_list->size;
+    int wait_ms = responder_count > 0 ? SWEEP_CACHE_EMPTY_WAIT_MS : 0;
+
+    if(!sweep_cache_enabled())
+    {
+        snmp_network_scan_run(&exec_path_str, &target_set, 0, 0, snmp_device_list);
+    }
+    else if(sweep_cache_full_sweep_due())
+    {
+        target_set_free(&sweep_set);
+        sweep_cache_get_unknown(&sweep_set);
+        snmp_network_scan_run(&exec_path_str, &sweep_set, wait_ms, 0, snmp_device_list);
+        sweep_cache_mark_full_sweep();
+    }
+    else
+    {
+        printf("Skipping the addresses that never answered, the last full sweep is less than %d s old.\n", SWEEP_CACHE_FULL_INTERVAL);
+    }
+
+    sweep_cache_mark_seen(snmp_device_list);
+
+    for(int i = known_count; i < snmp_device_list->size; i++)
+        snmp_pipeline_submit(snmp_device_list->data[i]);
+
+    target_set_free(&sweep_set);
+}
+
+static void usage(void)
+{
+    printf("[NOTICE] Usage: application [-w capture] [-C credentials] [-x exclusions] [-R seconds] [-W window] [-L rate] [-D seconds] [-P policy] <hosts> <community>\n");
+    printf("[NOTICE]        application -r capture\n");
+    printf("[NOTICE] hosts and exclusions are comma separated lists of addresses, networks (10.0.0.0/16) and ranges (10.0.0.1-10.0.0.9).\n");
+    printf("[NOTICE] -x excludes addresses from the sweep, they are never probed. It can be given several times.\n");
+    printf("[NOTICE] -R sets the seconds between background rescans for new and stale devices, 0 disables them (default %d).\n", SWEEPER_INTERVAL);
+    printf("[NOTICE] -W sets the max number of SNMP requests in flight to a single device, 0 walks with snmpwalk (default %d).\n", SNMP_WALKER_WINDOW);
+    printf("[NOTICE] -L sets the max number of SNMP requests per second to a single device, 0 disables the limit (default %d).\n", SNMP_WALKER_RATE);
+    printf("[NOTICE] -D sets the max seconds of the walk of a single device, the rest is marked as incomplete, 0 disables it (default %d).\n", SNMP_WALKER_DEADLINE_S);
+    printf("[NOTICE] -P overrides the window and the rate limit for the devices of some networks with the rules of a policy file.\n");
+    printf("[NOTICE] -C adds the communities and SNMPv3 users of a credentials file to the sweep.\n");
+    printf("[NOTICE] -w saves the walk results to a capture file, -r replays a capture into application.db without network access.\n");
+}
+
 int main(int argc, char* argv[])
-{    
-    if(geteuid() != 0)
+{
+    const char *capture_write_path = NULL;
+    const char *capture_replay_path = NULL;
+    const char *credentials_path = NULL;
+    int rescan_interval_s = SWEEPER_INTERVAL;
+    int walk_window = SNMP_WALKER_WINDOW;
+    int walk_rate = SNMP_WALKER_RATE;
+    int walk_deadline_s = SNMP_WALKER_DEADLINE_S;
+    const char *policy_path = NULL;
+
+    target_set_init(&target_set);
+
+    int option;
+    while((option = getopt(argc, argv, "w:r:C:x:R:W:L:D:P:h")) != -1)
+    {
+        switch(option)
+        {
+            case 'w': capture_write_path = optarg; break;
+            case 'r': capture_replay_path = optarg; break;
+            case 'C': credentials_path = optarg; break;
+            case 'R': rescan_interval_s = atoi(optarg); break;
+            case 'W': walk_window = atoi(optarg); break;
+            case 'L': walk_rate = atoi(optarg); break;
+            case 'D': walk_deadline_s = atoi(optarg); break;
+            case 'P': policy_path = optarg; break;
+            case 'x':
+                if(target_set_add_str(&target_set, optarg, true))
+                    return EXIT_FAILURE;
+                break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    /// A replay only needs the database
+    if(geteuid() != 0 && capture_replay_path == NULL)
     {
         printf(KRED"[ERROR] This application needs root privileges.\n"KNORMAL);
 
         return EXIT_FAILURE;
     }
 
-    if(argc < 3)
+    if(argc - optind < 2 && capture_replay_path == NULL)
     {
         printf(KRED"[ERROR] To few arguments.\n"KNORMAL);
-        printf("[NOTICE] Usage: application <host> <community>\n");
+        usage();
+
+        return EXIT_FAILURE;
+    }
+
+    if(capture_replay_path == NULL && target_set_add_str(&target_set, argv[optind], false))
+    {
+        usage();
 
         return EXIT_FAILURE;
     }
@@ -111,34 +333,48 @@ int main(int argc, char* argv[])
 
     snmp_oid_generate_oid_lists();
 
-    //TODO: Argument Checking
-    sds host_str = sdsnew(argv[1]);
-    sds community_str = sdsnew(argv[2]);
+    /// Has to run before any thread is created, SIGUSR1 prints the timing statistics.
+    if(stats_setup())
+        clean_exit(EXIT_FAILURE);
+
+    if(capture_replay_path != NULL)
+    {
+        if(database_open("application.db", &database) || database_drop(database) || database_generate(database))
+            clean_exit(EXIT_FAILURE);
 
-    /// Start SNMP network scan and put found devices into snmp_device_list;
-    gll_t* snmp_device_list = gll_init();
-    printf("Starting Network Scan\n");
-    snmp_network_scan_run(&exec_path_str, &host_str, &community_str, &snmp_device_list);
-    printf("Finished Network Scan, found %d SNMP devices with community \"%s\".\n", snmp_device_list->size , community_str);
+        clean_exit(replay_capture(capture_replay_path));
+    }
 
-    #ifdef DEBUG
-    PRINT_DEBUG("Found Devices:\n");
-    gll_each(snmp_device_list, &snmp_network_print_snmp_device_list_debug);
-    #endif
+    /// The discovery works without the metrics endpoint, e.g. if the port is in use
+    if(metrics_setup(METRICS_PORT))
+        printf(KYELLOW "[WARNING] Metrics endpoint is disabled.\n" KNORMAL);
+
+    if(capture_write_path != NULL && capture_setup(capture_write_path))
+        clean_exit(EXIT_FAILURE);
 
-    /// If no SNMP device have been found, free allocated memory and exit the programm
-    if(gll_first(snmp_device_list) == NULL)
+    if(snmp_policy_setup(policy_path) || snmp_walker_setup(walk_window, walk_rate, walk_deadline_s))
+        clean_exit(EXIT_FAILURE);
+
+    sds community_str = sdsnew(argv[optind + 1]);
+
+    if(snmp_credential_setup(&community_str, credentials_path))
     {
-        printf("No SNMP Device with community \"%s\" found.\n", community_str);
+        sdsfree(community_str);
+        clean_exit(EXIT_FAILURE);
+    }
 
-        gll_each(snmp_device_list, &free_ipv4_void);
-        gll_destroy(snmp_device_list);
+    if(target_set_size(&target_set) == 0)
+    {
+        printf(KRED "[ERROR] All hosts are excluded.\n" KNORMAL);
         sdsfree(community_str);
-        sdsfree(host_str);
+        clean_exit(EXIT_FAILURE);
+    }
 
-        clean_exit(EXIT_SUCCESS);
+    if(sweep_cache_setup(SWEEP_CACHE_PATH, &target_set))
+    {
+        sdsfree(community_str);
+        clean_exit(EXIT_FAILURE);
     }
-    sdsfree(host_str);
 
     /// Initialize Database
     if(database_open("application.db", &database))
@@ -151,48 +387,64 @@ int main(int argc, char* argv[])
         clean_exit(EXIT_FAILURE);
 
     /// Get List for OIDs for init run
-    gll_t *oid_init_list;
-    oid_init_list = *snmp_oid_get_oid_init_list();
-
-    gll_t* host_data_list;
-    host_data_list = gll_init();
+    oid_vec_t *oid_init_list;
+    oid_init_list = snmp_oid_get_oid_init_list();
 
-    /// Iterate over SNMP device list and get the init data from each device
-    gll_node_t* current = snmp_device_list->first;
-    while(current != NULL) {
-        sds return_data_str = sdsempty();
+    host_table = host_table_init();
 
-        ipv4_t *host_ip_ptr;
-        host_ip_ptr = (ipv4_t*)current->data;
-        snmp_network_walk_batch_run_str(&exec_path_str, &community_str, *host_ip_ptr, &oid_init_list, &return_data_str);
+    /// Start the discovery pipeline: network fetch -> parse -> database write.
+    /// It runs before the sweep, so devices are walked while the rest of the network is still being swept.
+    if(snmp_pipeline_setup(&exec_path_str, oid_init_list, database, &host_data_pair_written))
+        clean_exit(EXIT_FAILURE);
 
-        if(!snmp_parse_check_from_list(&return_data_str, &oid_init_list))
-        {
-            sds host_ip_str = str_from_ipv4(*host_ip_ptr);
-            printf(KYELLOW "[WARNING] Not all needed OIDs are implemented on Host \"%s\" with community \"%s\".\n" KNORMAL, host_ip_str, community_str);
-            sdsfree(host_ip_str);
-        }
+    /// Start SNMP network scan, the found devices are queued in the pipeline and put into snmp_device_list
+    ipv4_vec_t snmp_device_list;
+    vec_init(&snmp_device_list);
+    sds target_set_str = target_set_to_str(&target_set);
+    printf("Starting Network Scan of %llu addresses (%s)\n", (unsigned long long)target_set_size(&target_set), target_set_str);
+    sdsfree(target_set_str);
+    uint64_t sweep_start_us = stats_now_us();
+    discovery_sweep(&snmp_device_list);
+    stats_record(STATS_PHASE_SWEEP, stats_now_us() - sweep_start_us);
+    printf("Finished Network Scan, found %d SNMP devices with %d credentials.\n", snmp_device_list.size, snmp_credential_get_list()->size);
 
-        gll_t* oid_string_tuple_list;
-        oid_string_tuple_list = gll_init();
+    #ifdef DEBUG
+    PRINT_DEBUG("Found Devices:\n");
+    snmp_network_print_snmp_device_list_debug(&snmp_device_list);
+    #endif
 
-        snmp_parse_from_list(&return_data_str,*host_ip_ptr, &oid_init_list, &oid_string_tuple_list);
-        host_data_pair_t *host_data_pair;
-        host_data_pair = malloc(sizeof(host_data_pair_t));
-        host_data_pair->host = *host_ip_ptr;
-        host_data_pair->oid_string_tuple_list = oid_string_tuple_list;
+    if(snmp_device_list.size == 0)
+    {
+        printf("No SNMP Device found.\n");
 
-        snmp_host_data_pair_to_database(host_data_pair, database);
+        /// Without background rescans nothing would find the devices added later, free allocated memory and exit the programm
+        if(rescan_interval_s <= 0)
+        {
+            vec_free(&snmp_device_list);
+            sdsfree(community_str);
 
-        gll_push(host_data_list, host_data_pair);
+            clean_exit(EXIT_SUCCESS);
+        }
+    }
+    else
+    {
+        snmp_pipeline_wait_idle();
 
-        sdsfree(return_data_str);
+        /// Links to devices which have been written after their neighbours are resolved in one pass
+        int resolved_links_count = 0;
+        database_resolve_pending_links(database, &resolved_links_count);
+        PRINT_DEBUG("Resolved %d pending links after discovery.\n", resolved_links_count);
 
-        current = current->next;
-    } 
+        printf("Finished Discovery of %d SNMP devices.\n", snmp_device_list.size);
+        stats_print_summary();
+    }
 
     /// Setting up the SNMP Trap daemon
-    snmp_trap_daemon_setup(&exec_path_str, &community_str);
+    snmp_trap_daemon_setup(&exec_path_str);
+
+    /// Devices added later are found by the background rescan, also if they never send a trap
+    if(sweeper_setup(&exec_path_str, &target_set, &snmp_device_list, rescan_interval_s))
+        printf(KYELLOW "[WARNING] Background rescan is disabled.\n" KNORMAL);
 
     if (signal(SIGINT, signal_handler) == SIG_ERR) {
         printf("[ERROR] snmp_trap_daemon_setup couldn't setup signal handling for SIGINT\n");
@@ -212,68 +464,16 @@ int main(int argc, char* argv[])
         int ip_list_pos = 0;
         snmp_trap_read_data(&ip_list, &ip_list_pos);
 
-        /// Update saved data 
+        /// Renew saved data, the pipeline writes it to the database
         for(int i = 0; i < ip_list_pos; i++)
         {
             sds ip_str = str_from_ipv4(ip_list[i]);
             printf("[NOTICE] Received SNMP trap from %s\n", ip_str);
             sdsfree(ip_str);
 
-            sds return_data_str = sdsempty();
-
-            snmp_network_walk_batch_run_str(&exec_path_str, &community_str, ip_list[i], &oid_init_list, &return_data_str);
-
-            if(!snmp_parse_check_from_list(&return_data_str, &oid_init_list))
-            {
-                sds host_ip_str = str_from_ipv4(ip_list[i]);
-                printf(KYELLOW "[WARNING] Not all needed OIDs are implemented on Host \"%s\" with community \"%s\".\n" KNORMAL, host_ip_str, community_str);
-                sdsfree(host_ip_str);
-            }
-
-            gll_t* oid_string_tuple_list;
-            oid_string_tuple_list = gll_init();
-
-            snmp_parse_from_list(&return_data_str, ip_list[i], &oid_init_list, &oid_string_tuple_list);
-            host_data_pair_t *host_data_pair;
-            host_data_pair = malloc(sizeof(host_data_pair_t));
-            host_data_pair->host = ip_list[i];
-            host_data_pair->oid_string_tuple_list = oid_string_tuple_list;
-
-            /// Find node in list
-            int found_index = 0;
-            gll_node_t* found = NULL;
-            gll_node_t* current = snmp_device_list->first;
-            while(current != NULL) {
-                host_data_pair_t* data_pair = (host_data_pair_t*)current->data;
-
-                if(data_pair->host == ip_list[found_index])
-                {
-                    found = current;
-                    break;
-                }
-
-                current = current->next;
-                found_index++;
-            } 
-
-            if(found == NULL)
-            {
-                gll_push(host_data_list, host_data_pair);
-            }
-            else
-            {
-                gll_remove(host_data_list, found_index);
-
-                host_data_pair_t* data_pair = (host_data_pair_t*)found->data;
-                gll_each(data_pair->oid_string_tuple_list, snmp_parse_free_oid_string_tuple_t);
-                gll_destroy(data_pair->oid_string_tuple_list);
-                free(data_pair);
-
-                gll_push(host_data_list, host_data_pair);
-            }
-
-            sdsfree(return_data_str);
-
+            /// Excluded hosts are never probed, also not after a trap
+            if(!target_set_excludes(&target_set, ip_list[i]))
+                snmp_pipeline_submit_trap(ip_list[i]);
         }
         
         free(ip_list);
@@ -281,12 +481,9 @@ int main(int argc, char* argv[])
     }
     
     /// Cleanup
-    gll_each(host_data_list, &snmp_parse_free_host_data_pair_t);
-
     sdsfree(community_str);
 
-    gll_each(snmp_device_list, &free_ipv4_void);
-    gll_destroy(snmp_device_list);
+    vec_free(&snmp_device_list);
 
     clean_exit(EXIT_SUCCESS);
 }
\ No newline at end of file
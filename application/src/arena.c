@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "arena.h"
+
+/// Alignment of all allocations, chunk data starts behind three 8 byte header fields.
+#define ARENA_ALIGNMENT 8
+
+static arena_t *arena_pool[ARENA_POOL_SIZE];
+static int arena_pool_count = 0;
+static pthread_mutex_t arena_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static arena_chunk_t *arena_chunk_init(size_t size)
+{
+    arena_chunk_t *chunk = (arena_chunk_t *)malloc(sizeof(arena_chunk_t) + size);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+/**
+ * @brief Allocates an empty arena
+ *
+ * @param chunk_size size of the chunks the arena allocates from.
+ * @return the arena, needs to be freed with arena_destroy.
+ */
+arena_t *arena_init(size_t chunk_size)
+{
+    arena_t *arena = (arena_t *)malloc(sizeof(arena_t));
+    arena->chunk_size = chunk_size;
+    arena->first = arena_chunk_init(chunk_size);
+    arena->current = arena->first;
+
+    return arena;
+}
+
+/**
+ * @brief Allocates memory from the arena
+ *
+ * The memory can't be freed on its own, it stays valid until the arena gets reset or destroyed.
+ *
+ * @param arena the arena to allocate from.
+ * @param size number of bytes to allocate.
+ * @return pointer to the allocated memory.
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+
+    arena_chunk_t *chunk = arena->current;
+
+    while(chunk->used + size > chunk->size)
+    {
+        /// Chunks after the current one are left over from before the last reset
+        if(chunk->next != NULL && chunk->next->size >= size)
+        {
+            chunk = chunk->next;
+            continue;
+        }
+
+        arena_chunk_t *new_chunk = arena_chunk_init(size > arena->chunk_size ? size : arena->chunk_size);
+        new_chunk->next = chunk->next;
+        chunk->next = new_chunk;
+        chunk = new_chunk;
+    }
+
+    arena->current = chunk;
+
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+
+    return ptr;
+}
+
+/**
+ * @brief Creates a sds string inside the arena
+ *
+ * The string can be used like any other sds string, as long as it doesn't get freed or grown.
+ *
+ * @param arena the arena to allocate from.
+ * @param init the content of the string, can be NULL for a zeroed string.
+ * @param len length of the string.
+ * @return the sds string.
+ */
+sds arena_sdsnewlen(arena_t *arena, const void *init, size_t len)
+{
+    char *sh;
+    sds s;
+
+    if(len <= UINT8_MAX)
+    {
+        sh = arena_alloc(arena, sizeof(struct sdshdr8) + len + 1);
+        s = sh + sizeof(struct sdshdr8);
+        SDS_HDR(8, s)->len = len;
+        SDS_HDR(8, s)->alloc = len;
+        s[-1] = SDS_TYPE_8;
+    }
+    else if(len <= UINT16_MAX)
+    {
+        sh = arena_alloc(arena, sizeof(struct sdshdr16) + len + 1);
+        s = sh + sizeof(struct sdshdr16);
+        SDS_HDR(16, s)->len = len;
+        SDS_HDR(16, s)->alloc = len;
+        s[-1] = SDS_TYPE_16;
+    }
+    else
+    {
+        sh = arena_alloc(arena, sizeof(struct sdshdr32) + len + 1);
+        s = sh + sizeof(struct sdshdr32);
+        SDS_HDR(32, s)->len = len;
+        SDS_HDR(32, s)->alloc = len;
+        s[-1] = SDS_TYPE_32;
+    }
+
+    if(init != NULL)
+        memcpy(s, init, len);
+    else
+        memset(s, 0, len);
+
+    s[len] = '\0';
+
+    return s;
+}
+
+/**
+ * @brief Returns the number of bytes allocated since the last reset.
+ *
+ * @param arena the arena to check.
+ * @return number of allocated bytes.
+ */
+size_t arena_used(arena_t *arena)
+{
+    size_t used = 0;
+
+    for(arena_chunk_t *chunk = arena->first; chunk != NULL; chunk = chunk->next)
+        used += chunk->used;
+
+    return used;
+}
+
+/**
+ * @brief Releases all allocations of the arena at once, the chunks are kept for reuse.
+ *
+ * @param arena the arena to reset.
+ */
+void arena_reset(arena_t *arena)
+{
+    for(arena_chunk_t *chunk = arena->first; chunk != NULL; chunk = chunk->next)
+        chunk->used = 0;
+
+    arena->current = arena->first;
+}
+
+/**
+ * @brief Frees the arena and all of its allocations.
+ *
+ * @param arena the arena to free.
+ */
+void arena_destroy(arena_t *arena)
+{
+    arena_chunk_t *chunk = arena->first;
+
+    while(chunk != NULL)
+    {
+        arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    free(arena);
+}
+
+/**
+ * @brief Gets an empty arena, reuses a pooled one if available.
+ *
+ * @return the arena, should be given back with arena_pool_put.
+ */
+arena_t *arena_pool_get(void)
+{
+    arena_t *arena = NULL;
+
+    pthread_mutex_lock(&arena_pool_mutex);
+    if(arena_pool_count > 0)
+        arena = arena_pool[--arena_pool_count];
+    pthread_mutex_unlock(&arena_pool_mutex);
+
+    if(arena == NULL)
+        arena = arena_init(ARENA_CHUNK_SIZE);
+
+    return arena;
+}
+
+/**
+ * @brief Resets an arena and keeps it for reuse, the arena gets freed if the pool is full.
+ *
+ * @param arena the arena to give back.
+ */
+void arena_pool_put(arena_t *arena)
+{
+    arena_reset(arena);
+
+    pthread_mutex_lock(&arena_pool_mutex);
+    if(arena_pool_count < ARENA_POOL_SIZE)
+    {
+        arena_pool[arena_pool_count++] = arena;
+        arena = NULL;
+    }
+    pthread_mutex_unlock(&arena_pool_mutex);
+
+    if(arena != NULL)
+        arena_destroy(arena);
+}
+
+/**
+ * @brief Frees all pooled arenas.
+ */
+void arena_pool_clear(void)
+{
+    pthread_mutex_lock(&arena_pool_mutex);
+    while(arena_pool_count > 0)
+        arena_destroy(arena_pool[--arena_pool_count]);
+    pthread_mutex_unlock(&arena_pool_mutex);
+}
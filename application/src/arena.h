@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "lib/sds.h"
+
+/// Size of a single arena chunk, larger allocations get a chunk of their own.
+#ifndef ARENA_CHUNK_SIZE
+#define ARENA_CHUNK_SIZE 32768
+#endif
+
+/// Max number of reset arenas kept for reuse by arena_pool_get.
+#ifndef ARENA_POOL_SIZE
+#define ARENA_POOL_SIZE 64
+#endif
+
+typedef struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    char data[];
+} arena_chunk_t;
+
+/**
+ * Bump allocator, all allocations are released at once with arena_reset or arena_destroy.
+ */
+typedef struct
+{
+    arena_chunk_t *first;
+    arena_chunk_t *current;
+    size_t chunk_size;
+} arena_t;
+
+arena_t *arena_init(size_t chunk_size);
+void *arena_alloc(arena_t *arena, size_t size);
+sds arena_sdsnewlen(arena_t *arena, const void *init, size_t len);
+size_t arena_used(arena_t *arena);
+void arena_reset(arena_t *arena);
+void arena_destroy(arena_t *arena);
+
+arena_t *arena_pool_get(void);
+void arena_pool_put(arena_t *arena);
+void arena_pool_clear(void);
+
+#endif
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "capture.h"
+#include "kcolor.h"
+
+/**
+ * Capture file format, all integers are unsigned LEB128 varints:
+ *
+ *   magic "SNMPCAP1"
+ *   record*: timestamp_us, host, varbind_count, varbind_count * (shared_len, suffix_len, suffix)
+ *
+ * Each varbind line is stored without its newline and front coded against the line before, so the
+ * repeated OID prefixes of a walk cost a byte or two per line.
+ */
+
+static FILE *capture_file = NULL;
+static pthread_mutex_t capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static sds capture_put_varint(sds buffer_str, uint64_t value)
+{
+    uint8_t bytes[10];
+    int len = 0;
+
+    do
+    {
+        bytes[len] = value & 0x7F;
+        value >>= 7;
+        if(value > 0)
+            bytes[len] |= 0x80;
+        len++;
+    } while(value > 0);
+
+    return sdscatlen(buffer_str, bytes, len);
+}
+
+static int capture_get_varint(FILE *file, uint64_t *value)
+{
+    *value = 0;
+
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = fgetc(file);
+        if(byte == EOF)
+            return EXIT_FAILURE;
+
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+
+        if(!(byte & 0x80))
+            return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Opens a capture file, every walk result passed to capture_write is appended to it.
+ *
+ * @param path path of the file, an existing file is overwritten.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int capture_setup(const char *path)
+{
+    capture_file = fopen(path, "wb");
+    if(capture_file == NULL)
+    {
+        printf(KRED "[ERROR] capture_setup can't open %s for writing.\n" KNORMAL, path);
+        return EXIT_FAILURE;
+    }
+
+    fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, capture_file);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Appends the walk result of a host to the capture file, does nothing if no capture is open.
+ *
+ * Can be called from any thread, a record is written with a single fwrite.
+ *
+ * @param host the walked host.
+ * @param data_str output of the walks like "snmpwalk -One" prints it.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int capture_write(ipv4_t host, sds data_str)
+{
+    if(capture_file == NULL)
+        return EXIT_SUCCESS;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    /// Lines are encoded first, the count goes in front of them
+    sds lines_str = sdsempty();
+    uint32_t varbind_count = 0;
+
+    const char *previous = "";
+    size_t previous_len = 0;
+    const char *line = data_str;
+    const char *end = data_str + sdslen(data_str);
+
+    while(line < end)
+    {
+        const char *newline = memchr(line, '\n', end - line);
+        size_t line_len = newline != NULL ? (size_t)(newline - line) : (size_t)(end - line);
+
+        size_t shared_len = 0;
+        while(shared_len < line_len && shared_len < previous_len && line[shared_len] == previous[shared_len])
+            shared_len++;
+
+        lines_str = capture_put_varint(lines_str, shared_len);
+        lines_str = capture_put_varint(lines_str, line_len - shared_len);
+        lines_str = sdscatlen(lines_str, line + shared_len, line_len - shared_len);
+        varbind_count++;
+
+        previous = line;
+        previous_len = line_len;
+        line += line_len + 1;
+    }
+
+    sds record_str = sdsempty();
+    record_str = capture_put_varint(record_str, (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+    record_str = capture_put_varint(record_str, host);
+    record_str = capture_put_varint(record_str, varbind_count);
+    record_str = sdscatsds(record_str, lines_str);
+
+    pthread_mutex_lock(&capture_mutex);
+    size_t written = fwrite(record_str, 1, sdslen(record_str), capture_file);
+    pthread_mutex_unlock(&capture_mutex);
+
+    int status = written == sdslen(record_str) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    sdsfree(lines_str);
+    sdsfree(record_str);
+
+    return status;
+}
+
+/**
+ * @brief Flushes and closes the capture file.
+ */
+void capture_shutdown(void)
+{
+    pthread_mutex_lock(&capture_mutex);
+    if(capture_file != NULL)
+        fclose(capture_file);
+    capture_file = NULL;
+    pthread_mutex_unlock(&capture_mutex);
+}
+
+/**
+ * @brief Opens a capture file for reading.
+ *
+ * @param path path of the file.
+ * @return the reader or NULL if the file can't be read or isn't a capture, needs to be closed with capture_reader_close.
+ */
+capture_reader_t *capture_reader_open(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        printf(KRED "[ERROR] capture_reader_open can't open %s.\n" KNORMAL, path);
+        return NULL;
+    }
+
+    char magic[CAPTURE_MAGIC_LEN];
+    if(fread(magic, 1, CAPTURE_MAGIC_LEN, file) != CAPTURE_MAGIC_LEN || memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != 0)
+    {
+        printf(KRED "[ERROR] capture_reader_open %s isn't a capture file.\n" KNORMAL, path);
+        fclose(file);
+        return NULL;
+    }
+
+    capture_reader_t *reader = (capture_reader_t *)malloc(sizeof(capture_reader_t));
+    reader->file = file;
+    reader->line_str = sdsempty();
+
+    return reader;
+}
+
+/**
+ * @brief Reads the next walk result.
+ *
+ * @param reader an open reader.
+ * @param record filled with the walk result, record->data_str needs to be freed with sdsfree.
+ * @return 0 if a record has been read, 1 at the end of the file or on a truncated record.
+ */
+int capture_reader_next(capture_reader_t *reader, capture_record_t *record)
+{
+    uint64_t timestamp_us, host, varbind_count;
+
+    if(capture_get_varint(reader->file, &timestamp_us))
+        return EXIT_FAILURE;
+
+    if(capture_get_varint(reader->file, &host) || capture_get_varint(reader->file, &varbind_count))
+    {
+        printf(KYELLOW "[WARNING] capture_reader_next ignores a truncated record.\n" KNORMAL);
+        return EXIT_FAILURE;
+    }
+
+    record->timestamp_us = timestamp_us;
+    record->host = (ipv4_t)host;
+    record->varbind_count = (uint32_t)varbind_count;
+    record->data_str = sdsempty();
+
+    /// The line before is kept in line_str to undo the front coding
+    sdsclear(reader->line_str);
+
+    for(uint64_t i = 0; i < varbind_count; i++)
+    {
+        uint64_t shared_len, suffix_len;
+
+        if(capture_get_varint(reader->file, &shared_len) || capture_get_varint(reader->file, &suffix_len) || shared_len > sdslen(reader->line_str))
+        {
+            printf(KYELLOW "[WARNING] capture_reader_next ignores a truncated record.\n" KNORMAL);
+            sdsfree(record->data_str);
+            record->data_str = NULL;
+            return EXIT_FAILURE;
+        }
+
+        sdssetlen(reader->line_str, shared_len);
+        reader->line_str = sdsMakeRoomFor(reader->line_str, suffix_len);
+
+        if(fread(reader->line_str + shared_len, 1, suffix_len, reader->file) != suffix_len)
+        {
+            printf(KYELLOW "[WARNING] capture_reader_next ignores a truncated record.\n" KNORMAL);
+            sdsfree(record->data_str);
+            record->data_str = NULL;
+            return EXIT_FAILURE;
+        }
+
+        sdsIncrLen(reader->line_str, suffix_len);
+
+        record->data_str = sdscatsds(record->data_str, reader->line_str);
+        record->data_str = sdscatlen(record->data_str, "\n", 1);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Closes a reader opened with capture_reader_open.
+ */
+void capture_reader_close(capture_reader_t *reader)
+{
+    if(reader == NULL)
+        return;
+
+    fclose(reader->file);
+    sdsfree(reader->line_str);
+    free(reader);
+}
@@ -0,0 +1,43 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "lib/sds.h"
+
+#include "ip.h"
+
+/// First bytes of a capture file, the digit is the format version.
+#define CAPTURE_MAGIC "SNMPCAP1"
+#define CAPTURE_MAGIC_LEN 8
+
+/**
+ * The walk result of one host
+ */
+typedef struct
+{
+    /// Time the walk finished, microseconds since the epoch.
+    uint64_t timestamp_us;
+    ipv4_t host;
+    /// Number of lines (varbinds) of the walk.
+    uint32_t varbind_count;
+    /// Output of the walks like "snmpwalk -One" prints it.
+    sds data_str;
+} capture_record_t;
+
+typedef struct
+{
+    FILE *file;
+    sds line_str;
+} capture_reader_t;
+
+int capture_setup(const char *path);
+int capture_write(ipv4_t host, sds data_str);
+void capture_shutdown(void);
+
+capture_reader_t *capture_reader_open(const char *path);
+int capture_reader_next(capture_reader_t *reader, capture_record_t *record);
+void capture_reader_close(capture_reader_t *reader);
+
+#endif
@@ -27,10 +27,27 @@ int database_free_device(database_device_t *device)
  * @return 0 on success, 1 on failure.
  */
 int database_free_port(database_port_t *port)
+{
+    database_clear_port(port);
+    free(port);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Frees the strings of a port, but not the port itself
+ * 
+ * Used for ports stored by value, e.g. in a database_port_vec_t.
+ * 
+ * @param port the port to be cleared
+ * @return 0 on success, 1 on failure.
+ */
+int database_clear_port(database_port_t *port)
 {
     sdsfree(port->mac_address);
     sdsfree(port->name);
-    free(port);
+    port->mac_address = NULL;
+    port->name = NULL;
 
     return EXIT_SUCCESS;
 }
@@ -100,12 +117,17 @@ int database_close(sqlite3 *database)
  */
 int database_generate(sqlite3 *database)
 {
-    const char* sql_create_devices = "CREATE TABLE IF NOT EXISTS \"Devices\" (\"Id\" INTEGER,  \"ManagementAddress\" INTEGER,  \"CapabilitiesSupported\" INTEGER,  \"CapabilitiesEnabled\" INTEGER, \"SystemName\" TEXT, PRIMARY KEY(\"Id\" AUTOINCREMENT));";
+    const char* sql_create_devices = "CREATE TABLE IF NOT EXISTS \"Devices\" (\"Id\" INTEGER,  \"ManagementAddress\" INTEGER,  \"CapabilitiesSupported\" INTEGER,  \"CapabilitiesEnabled\" INTEGER, \"SystemName\" TEXT, \"Stale\" INTEGER DEFAULT 0, \"MissingOIDs\" TEXT DEFAULT '', PRIMARY KEY(\"Id\" AUTOINCREMENT));";
 
     const char* sql_create_ports = "CREATE TABLE IF NOT EXISTS \"Ports\" (\"Id\" INTEGER, \"DeviceId\" INTEGER, \"InterfaceId\" INTEGER, \"MACAddress\" TEXT, \"MaxSpeed\" INTEGER, \"OperatingStatus\" INTEGER, \"Name\" TEXT, PRIMARY KEY(\"Id\" AUTOINCREMENT), FOREIGN KEY(\"DeviceId\") REFERENCES \"Devices\"(\"Id\"));";
 
     const char* sql_create_links = "CREATE TABLE IF NOT EXISTS \"Links\" (\"Id\" INTEGER, \"PortAId\" INTEGER, \"PortBId\" INTEGER, \"LinkType\" INTEGER, \"Speed\" INTEGER, \"Length\" INTEGER, PRIMARY KEY(\"Id\" AUTOINCREMENT), FOREIGN KEY(\"PortAId\") REFERENCES \"Ports\"(\"Id\"), FOREIGN KEY(\"PortBId\") REFERENCES \"Ports\"(\"Id\"));";
 
+    const char* sql_create_pending_links = "CREATE TABLE IF NOT EXISTS \"PendingLinks\" (\"Id\" INTEGER, \"PortId\" INTEGER, \"RemoteMACAddress\" TEXT, PRIMARY KEY(\"Id\" AUTOINCREMENT), FOREIGN KEY(\"PortId\") REFERENCES \"Ports\"(\"Id\"));";
+
+    /// Pending links are resolved by joining the remote MAC address against all ports.
+    const char* sql_create_ports_index = "CREATE INDEX IF NOT EXISTS \"PortsMACAddress\" ON \"Ports\" (\"MACAddress\");";
+
     char *zErrMsg = 0;
 
     if( sqlite3_exec(database, sql_create_devices, NULL, 0, &zErrMsg) != SQLITE_OK )
@@ -132,6 +154,22 @@ int database_generate(sqlite3 *database)
         return EXIT_FAILURE;
     }
 
+    if( sqlite3_exec(database, sql_create_pending_links, NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_generate - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+
+        return EXIT_FAILURE;
+    }
+
+    if( sqlite3_exec(database, sql_create_ports_index, NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_generate - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
 
@@ -143,12 +181,21 @@ int database_generate(sqlite3 *database)
  */
 int database_drop(sqlite3 *database)
 {
+    const char *sql_drop_pending_links = "DROP TABLE IF EXISTS \"PendingLinks\";";
     const char *sql_drop_links = "DROP TABLE IF EXISTS \"Links\";";
     const char *sql_drop_ports = "DROP TABLE IF EXISTS \"Ports\";";
     const char *sql_drop_devices = "DROP TABLE IF EXISTS \"Devices\";";
 
     char *zErrMsg = 0;
 
+    if( sqlite3_exec(database, sql_drop_pending_links, NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_drop - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+
+        return EXIT_FAILURE;
+    }
+
     if( sqlite3_exec(database, sql_drop_links, NULL, 0, &zErrMsg) != SQLITE_OK )
     {
         printf(KRED"[ERROR] database_drop - SQL error: %s\n"KNORMAL, zErrMsg);
@@ -176,6 +223,48 @@ int database_drop(sqlite3 *database)
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief starts a transaction, all following statements are written with a single commit.
+ * 
+ * @param database open connection to a sqlite3 database.
+ * @return 0 on success, 1 on failure.
+ */
+int database_begin_transaction(sqlite3 *database)
+{
+    char *zErrMsg = 0;
+
+    if( sqlite3_exec(database, "BEGIN TRANSACTION;", NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_begin_transaction - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief commits the transaction started with database_begin_transaction.
+ * 
+ * @param database open connection to a sqlite3 database.
+ * @return 0 on success, 1 on failure.
+ */
+int database_commit_transaction(sqlite3 *database)
+{
+    char *zErrMsg = 0;
+
+    if( sqlite3_exec(database, "COMMIT TRANSACTION;", NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_commit_transaction - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 /* ------------ Device Section ------------ */
 static int database_get_id_from_device_callback(void *device_ptr,  int argc, char **argv, char **col_name)
 {
@@ -289,6 +378,60 @@ int database_update_device_by_management_address(sqlite3 *database, database_dev
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Marks a device as stale if it stopped answering the background rescans, or as active again.
+ * 
+ * @param database open connection to a sqlite3 database.
+ * @param management_address management address of the device.
+ * @param stale true if the device stopped answering.
+ * @return 0 on success, 1 on failure.
+ */
+int database_set_device_stale(sqlite3 *database, uint32_t management_address, bool stale)
+{
+    sds sql_update_device = sdscatfmt(sdsempty(), "UPDATE \"Devices\" SET Stale = %i WHERE ManagementAddress = %u;", stale ? 1 : 0, management_address);
+
+    char *zErrMsg = 0;
+
+    int rc = sqlite3_exec(database, sql_update_device, NULL, 0, &zErrMsg);
+    sdsfree(sql_update_device);
+
+    if( rc != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_set_device_stale - SQL error: %d - %s\n"KNORMAL, rc, zErrMsg);
+        sqlite3_free(zErrMsg);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Saves the OIDs whose walk was cut off by a timeout or a deadline, the rows of the device may be incomplete.
+ * 
+ * @param database open connection to a sqlite3 database.
+ * @param management_address management address of the device.
+ * @param missing_oids_str space separated OIDs, empty if the last walk was complete.
+ * @return 0 on success, 1 on failure.
+ */
+int database_set_device_missing_oids(sqlite3 *database, uint32_t management_address, const char *missing_oids_str)
+{
+    sds sql_update_device = sdscatfmt(sdsempty(), "UPDATE \"Devices\" SET MissingOIDs = '%s' WHERE ManagementAddress = %u;", missing_oids_str, management_address);
+
+    char *zErrMsg = 0;
+
+    int rc = sqlite3_exec(database, sql_update_device, NULL, 0, &zErrMsg);
+    sdsfree(sql_update_device);
+
+    if( rc != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_set_device_missing_oids - SQL error: %d - %s\n"KNORMAL, rc, zErrMsg);
+        sqlite3_free(zErrMsg);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 /**
  * @brief Deletes a device and all its ports and links.
  * 
@@ -299,22 +442,17 @@ int database_update_device_by_management_address(sqlite3 *database, database_dev
 int database_delete_device(sqlite3 *database, database_device_t *device)
 {
     /// Deletes all existing ports and their links
-    gll_t *ports_list = gll_init();
-    database_get_ports_by_device(database, device, ports_list);
+    database_port_vec_t ports_list;
+    vec_init(&ports_list);
+    database_get_ports_by_device(database, device, &ports_list);
 
-    if(ports_list->size > 0)
+    for(int i = 0; i < ports_list.size; i++)
     {
-        gll_node_t *node = ports_list->first;
-        for(int i = 0; i < ports_list->size; i++)
-        {
-            database_port_t *port = (database_port_t *)node;
-            database_delete_port(database, port);
-            database_free_port(port);
-
-            node = node->next;
-        }
-        gll_destroy(ports_list);
+        database_port_t *port = &ports_list.data[i];
+        database_delete_port(database, port);
+        database_clear_port(port);
     }
+    vec_free(&ports_list);
 
     /// Delete device
     sds sql_delete_device = sdscatfmt(sdsempty(), "DELETE FROM \"Devices\" WHERE id = %i;", device->id);
@@ -428,7 +566,7 @@ int database_insert_port(sqlite3 *database, database_port_t *port)
  */
 int database_update_port_by_mac_address(sqlite3 *database, database_port_t *port)
 {
-    sds sql_update_port = sdscatfmt(sdsempty(), "UPDATE \"Ports\" SET InterfaceId = %i, MaxSpeed = %u, OperatingStatus = %i, Name = \"%S\" WHERE MacAddress = %u;", port->interface_id, port->max_speed, port->operating_status, port->name, port->mac_address);
+    sds sql_update_port = sdscatfmt(sdsempty(), "UPDATE \"Ports\" SET InterfaceId = %i, MaxSpeed = %u, OperatingStatus = %i, Name = \"%S\" WHERE MACAddress = \"%S\";", port->interface_id, port->max_speed, port->operating_status, port->name, port->mac_address);
 
     char *zErrMsg = 0;
 
@@ -447,9 +585,9 @@ int database_update_port_by_mac_address(sqlite3 *database, database_port_t *port
 
 static int database_get_ports_by_device_callback(void *ports_list_ptr,  int argc, char **argv, char **col_name)
 {
-    gll_t *ports_list = (gll_t *)ports_list_ptr;
+    database_port_vec_t *ports_list = (database_port_vec_t *)ports_list_ptr;
 
-    database_port_t *port = (database_port_t *)malloc(sizeof(database_port_t));
+    database_port_t *port = vec_push_slot(ports_list);
 
     port->id = strtol(argv[0], NULL, 10);
     port->device_id = strtol(argv[1], NULL, 10);
@@ -459,22 +597,20 @@ static int database_get_ports_by_device_callback(void *ports_list_ptr,  int argc
     port->operating_status = strtol(argv[5], NULL, 10);
     port->name = sdsnew(argv[6]);
 
-    gll_pushBack(ports_list, port);
-
     return 0;
 }
 
 /**
- * @brief getting a list of ports of a device, device management address is used as search key
+ * @brief getting a list of ports of a device, device id is used as search key
  * 
  * @param database open connection to a sqlite3 database.
  * @param device the device used as look up.
- * @param ports_list gll list of found ports, need to be unallocated manually
+ * @param ports_list list of found ports, the ports need to be cleared with database_clear_port
  * @return 0 on success, 1 on failure.
  */
-int database_get_ports_by_device(sqlite3 *database, database_device_t *device, gll_t *ports_list)
+int database_get_ports_by_device(sqlite3 *database, database_device_t *device, database_port_vec_t *ports_list)
 {
-    sds sql_select_ports = sdscatfmt(sdsempty(), "SELECT * FROM \"Ports\" WHERE ManagementAddress = %u;", device->management_address);
+    sds sql_select_ports = sdscatfmt(sdsempty(), "SELECT * FROM \"Ports\" WHERE DeviceId = %i;", device->id);
 
     char *zErrMsg = 0;
 
@@ -512,6 +648,9 @@ int database_delete_port(sqlite3 *database, database_port_t *port)
     }
     database_free_link(link);
 
+    /// Delete a link that is still waiting for its remote port
+    database_delete_pending_link_by_port(database, port);
+
     /// Delete the port
     sds sql_delete_port = sdscatfmt(sdsempty(), "DELETE FROM \"Ports\" WHERE id = %i;", port->id);
     
@@ -706,5 +845,134 @@ int database_delete_link(sqlite3 *database, database_link_t *link)
         return EXIT_FAILURE;
     }
 
+    return EXIT_SUCCESS;
+}
+
+/* ------------ Pending Links Section ------------ */
+
+/**
+ * @brief Remembers a link whose remote port isn't in the database yet.
+ * 
+ * Replaces an already pending link of the same local port. The link gets created by database_resolve_pending_links,
+ * as soon as a port with the remote MAC address has been inserted.
+ * 
+ * @param database open connection to a sqlite3 database.
+ * @param port the local port of the link, needs a valid id.
+ * @param remote_mac_address the chassis MAC address announced by the remote device.
+ * @return 0 on success, 1 on failure.
+ */
+int database_insert_pending_link(sqlite3 *database, database_port_t *port, sds remote_mac_address)
+{
+    if(database_delete_pending_link_by_port(database, port))
+        return EXIT_FAILURE;
+
+    sds sql_insert_pending_link = sdscatfmt(sdsempty(), "INSERT INTO \"PendingLinks\" (PortId, RemoteMACAddress) VALUES ( %i, \"%S\" );", port->id, remote_mac_address);
+
+    char *zErrMsg = 0;
+
+    int rc = sqlite3_exec(database, sql_insert_pending_link, NULL, 0, &zErrMsg);
+    sdsfree(sql_insert_pending_link);
+
+    if( rc != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_insert_pending_link - SQL error: %d - %s\n"KNORMAL, rc, zErrMsg);
+        sqlite3_free(zErrMsg);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Deletes the pending link of a port.
+ * 
+ * @param database open connection to a sqlite3 database.
+ * @param port the local port of the pending link.
+ * @return 0 on success, 1 on failure.
+ */
+int database_delete_pending_link_by_port(sqlite3 *database, database_port_t *port)
+{
+    sds sql_delete_pending_link = sdscatfmt(sdsempty(), "DELETE FROM \"PendingLinks\" WHERE PortId = %i;", port->id);
+
+    char *zErrMsg = 0;
+
+    int rc = sqlite3_exec(database, sql_delete_pending_link, NULL, 0, &zErrMsg);
+    sdsfree(sql_delete_pending_link);
+
+    if( rc != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_delete_pending_link_by_port - SQL error: %d - %s\n"KNORMAL, rc, zErrMsg);
+        sqlite3_free(zErrMsg);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Creates links for all pending links whose remote port is known by now.
+ * 
+ * All pending (local port, remote MAC address) pairs are resolved with a single join, resolved pairs are removed afterwards.
+ * This is done after a discovery batch and whenever new ports have been inserted, so the order in which devices
+ * are written doesn't matter.
+ * 
+ * @param database open connection to a sqlite3 database.
+ * @param resolved_count returns the number of links that have been created, can be NULL.
+ * @return 0 on success, 1 on failure.
+ */
+int database_resolve_pending_links(sqlite3 *database, int *resolved_count)
+{
+    const char *sql_savepoint = "SAVEPOINT \"ResolvePendingLinks\";";
+
+    const char *sql_insert_links = "INSERT INTO \"Links\" (PortAId, PortBId, LinkType, Speed, Length) "
+        "SELECT Pending.PortId, Remote.Id, 0, MIN(Local.MaxSpeed, Remote.MaxSpeed), 0 "
+        "FROM \"PendingLinks\" AS Pending "
+        "JOIN \"Ports\" AS Local ON Local.Id = Pending.PortId "
+        "JOIN \"Ports\" AS Remote ON Remote.Id = (SELECT Id FROM \"Ports\" WHERE MACAddress = Pending.RemoteMACAddress LIMIT 1) "
+        "WHERE NOT EXISTS (SELECT 1 FROM \"Links\" WHERE PortAId = Pending.PortId AND PortBId = Remote.Id);";
+
+    const char *sql_delete_resolved = "DELETE FROM \"PendingLinks\" WHERE RemoteMACAddress IN (SELECT MACAddress FROM \"Ports\");";
+
+    const char *sql_release = "RELEASE \"ResolvePendingLinks\";";
+    const char *sql_rollback = "ROLLBACK TO \"ResolvePendingLinks\"; RELEASE \"ResolvePendingLinks\";";
+
+    char *zErrMsg = 0;
+
+    if(resolved_count != NULL)
+        *resolved_count = 0;
+
+    if( sqlite3_exec(database, sql_savepoint, NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_resolve_pending_links - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+        return EXIT_FAILURE;
+    }
+
+    if( sqlite3_exec(database, sql_insert_links, NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_resolve_pending_links - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+        sqlite3_exec(database, sql_rollback, NULL, 0, NULL);
+        return EXIT_FAILURE;
+    }
+
+    if(resolved_count != NULL)
+        *resolved_count = sqlite3_changes(database);
+
+    if( sqlite3_exec(database, sql_delete_resolved, NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_resolve_pending_links - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+        sqlite3_exec(database, sql_rollback, NULL, 0, NULL);
+        return EXIT_FAILURE;
+    }
+
+    if( sqlite3_exec(database, sql_release, NULL, 0, &zErrMsg) != SQLITE_OK )
+    {
+        printf(KRED"[ERROR] database_resolve_pending_links - SQL error: %s\n"KNORMAL, zErrMsg);
+        sqlite3_free(zErrMsg);
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
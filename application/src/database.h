@@ -6,7 +6,7 @@
 #include <sqlite3.h>
 
 #include "ip.h"
-#include "lib/gll.h"
+#include "vec.h"
 
 typedef struct
 {
@@ -28,6 +28,9 @@ typedef struct
     sds name;
 } database_port_t;
 
+/// List of ports stored by value
+typedef vec_t(database_port_t) database_port_vec_t;
+
 typedef struct
 {
     int id;
@@ -40,18 +43,23 @@ typedef struct
 
 int database_free_device(database_device_t *device);
 int database_free_port(database_port_t *port);
+int database_clear_port(database_port_t *port);
 int database_free_link(database_link_t *link);
 
 int database_open(const char *database_name, sqlite3 **database);
 int database_close(sqlite3 *database);
 int database_generate(sqlite3 *database);
 int database_drop(sqlite3 *database);
+int database_begin_transaction(sqlite3 *database);
+int database_commit_transaction(sqlite3 *database);
 
 /* ------------ Device Section ------------ */
 int database_get_id_from_device(sqlite3 *database, database_device_t *device);
 bool database_does_device_exist(sqlite3 *database, database_device_t *device);
 int database_insert_device(sqlite3 *database, database_device_t *device);
 int database_update_device_by_management_address(sqlite3 *database, database_device_t *device);
+int database_set_device_stale(sqlite3 *database, uint32_t management_address, bool stale);
+int database_set_device_missing_oids(sqlite3 *database, uint32_t management_address, const char *missing_oids_str);
 int database_delete_device(sqlite3 *database, database_device_t *device);
 
 /* ------------ Ports Section ------------ */
@@ -59,7 +67,7 @@ int database_get_id_from_port(sqlite3 *database, database_port_t *port);
 bool database_does_port_exist(sqlite3 *database, database_port_t *port);
 int database_insert_port(sqlite3 *database, database_port_t *port);
 int database_update_port_by_mac_address(sqlite3 *database, database_port_t *port);
-int database_get_ports_by_device(sqlite3 *database, database_device_t *device, gll_t *ports_list);
+int database_get_ports_by_device(sqlite3 *database, database_device_t *device, database_port_vec_t *ports_list);
 int database_delete_port(sqlite3 *database, database_port_t *port);
 
 /* ------------ Links Section ------------ */
@@ -70,4 +78,9 @@ int database_update_link_by_port_ids(sqlite3 *database, database_link_t *link);
 int database_get_link_by_port(sqlite3 *database, database_port_t *port, database_link_t *link);
 int database_delete_link(sqlite3 *database, database_link_t *link);
 
+/* ------------ Pending Links Section ------------ */
+int database_insert_pending_link(sqlite3 *database, database_port_t *port, sds remote_mac_address);
+int database_delete_pending_link_by_port(sqlite3 *database, database_port_t *port);
+int database_resolve_pending_links(sqlite3 *database, int *resolved_count);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include <stdlib.h>
+
+#include "host_table.h"
+
+/// Number of buckets of a new table, must be a power of two.
+#define HOST_TABLE_MIN_BUCKETS 64
+/// log2(HOST_TABLE_MIN_BUCKETS)
+#define HOST_TABLE_MIN_BUCKETS_LOG2 6
+
+/**
+ * Fibonacci hashing, the multiplication mixes every bit of the address into the high bits of the product.
+ * Using the top log2(bucket_count) bits spreads consecutive addresses of a subnet over the whole table, the low
+ * bits of the product only depend on the low bits of the address and would keep the layout of the subnet.
+ */
+static uint32_t host_table_hash(host_table_t *table, ipv4_t host)
+{
+    return (host * 2654435769u) >> table->shift;
+}
+
+/**
+ * @brief Returns the bucket which holds the host or the empty bucket where it belongs.
+ */
+static uint32_t host_table_bucket(host_table_t *table, ipv4_t host)
+{
+    uint32_t mask = table->bucket_count - 1;
+    uint32_t bucket = host_table_hash(table, host);
+
+    while(table->buckets[bucket] != 0)
+    {
+        if(host_table_slot(table, table->buckets[bucket] - 1)->host == host)
+            break;
+
+        bucket = (bucket + 1) & mask;
+    }
+
+    return bucket;
+}
+
+/**
+ * @brief Doubles the number of buckets and rehashes all entries, the entries themself don't move.
+ */
+static void host_table_grow(host_table_t *table)
+{
+    free(table->buckets);
+
+    table->bucket_count *= 2;
+    table->shift--;
+    table->buckets = (uint32_t *)calloc(table->bucket_count, sizeof(uint32_t));
+
+    for(int slot = 0; slot < table->size; slot++)
+    {
+        uint32_t bucket = host_table_bucket(table, host_table_slot(table, slot)->host);
+        table->buckets[bucket] = slot + 1;
+    }
+}
+
+/**
+ * @brief Allocates an empty host table
+ *
+ * @return the table, needs to be freed with host_table_destroy.
+ */
+host_table_t *host_table_init(void)
+{
+    host_table_t *table = (host_table_t *)malloc(sizeof(host_table_t));
+
+    table->pages = NULL;
+    table->page_count = 0;
+    table->size = 0;
+    table->bucket_count = HOST_TABLE_MIN_BUCKETS;
+    table->shift = 32 - HOST_TABLE_MIN_BUCKETS_LOG2;
+    table->buckets = (uint32_t *)calloc(table->bucket_count, sizeof(uint32_t));
+
+    return table;
+}
+
+/**
+ * @brief Looks up the entry of a host
+ *
+ * @param table the table to search.
+ * @param host IPv4 address of the host.
+ * @return the entry or NULL if the host is unknown.
+ */
+host_entry_t *host_table_find(host_table_t *table, ipv4_t host)
+{
+    uint32_t bucket = host_table_bucket(table, host);
+
+    if(table->buckets[bucket] == 0)
+        return NULL;
+
+    return host_table_slot(table, table->buckets[bucket] - 1);
+}
+
+/**
+ * @brief Looks up the slot of a host
+ *
+ * Slots are numbered in insertion order, so callers can keep their own per host data in arrays.
+ *
+ * @param table the table to search.
+ * @param host IPv4 address of the host.
+ * @return the slot or -1 if the host is unknown.
+ */
+int host_table_find_slot(host_table_t *table, ipv4_t host)
+{
+    return (int)table->buckets[host_table_bucket(table, host)] - 1;
+}
+
+/**
+ * @brief Returns the entry of a host, creates an empty entry if the host is unknown.
+ *
+ * @param table the table to insert into.
+ * @param host IPv4 address of the host.
+ * @return the entry of the host.
+ */
+host_entry_t *host_table_insert(host_table_t *table, ipv4_t host)
+{
+    uint32_t bucket = host_table_bucket(table, host);
+
+    if(table->buckets[bucket] != 0)
+        return host_table_slot(table, table->buckets[bucket] - 1);
+
+    if(table->size == table->page_count * HOST_TABLE_PAGE_SIZE)
+    {
+        table->pages = (host_entry_t **)realloc(table->pages, (table->page_count + 1) * sizeof(host_entry_t *));
+        table->pages[table->page_count++] = (host_entry_t *)malloc(HOST_TABLE_PAGE_SIZE * sizeof(host_entry_t));
+    }
+
+    int slot = table->size++;
+    host_entry_t *entry = host_table_slot(table, slot);
+    entry->host = host;
+    entry->host_data_pair = NULL;
+    entry->credential = -1;
+
+    table->buckets[bucket] = slot + 1;
+
+    /// Keep the load factor below 1/2 so probe sequences stay short
+    if((uint32_t)table->size * 2 > table->bucket_count)
+        host_table_grow(table);
+
+    return entry;
+}
+
+/**
+ * @brief Returns the entry stored in a slot
+ *
+ * @param table the table.
+ * @param slot number of the slot, must be less than host_table_size.
+ * @return the entry.
+ */
+host_entry_t *host_table_slot(host_table_t *table, int slot)
+{
+    return &table->pages[slot / HOST_TABLE_PAGE_SIZE][slot % HOST_TABLE_PAGE_SIZE];
+}
+
+/**
+ * @brief Returns the number of hosts in the table.
+ *
+ * @param table the table.
+ * @return number of hosts.
+ */
+int host_table_size(host_table_t *table)
+{
+    return table->size;
+}
+
+/**
+ * @brief Frees the table including the host data pairs of its entries.
+ *
+ * @param table the table to free.
+ */
+void host_table_destroy(host_table_t *table)
+{
+    for(int slot = 0; slot < table->size; slot++)
+    {
+        host_entry_t *entry = host_table_slot(table, slot);
+        if(entry->host_data_pair != NULL)
+            snmp_parse_free_host_data_pair_t(entry->host_data_pair);
+    }
+
+    for(int i = 0; i < table->page_count; i++)
+        free(table->pages[i]);
+
+    free(table->pages);
+    free(table->buckets);
+    free(table);
+}
@@ -0,0 +1,53 @@
+#ifndef HOST_TABLE_H
+#define HOST_TABLE_H
+
+#include <stdint.h>
+
+#include "ip.h"
+#include "snmp_parse.h"
+
+/// Number of entries per page, entries never move once they have been created.
+#ifndef HOST_TABLE_PAGE_SIZE
+#define HOST_TABLE_PAGE_SIZE 256
+#endif
+
+/**
+ * State kept for each known device.
+ */
+typedef struct
+{
+    ipv4_t host;
+    /// Latest data written to the database, NULL until the first walk of the host has finished.
+    host_data_pair_t *host_data_pair;
+    /// Index of the credential the host answered to, -1 if unknown.
+    int credential;
+} host_entry_t;
+
+/**
+ * Hash map from ipv4_t to host_entry_t.
+ *
+ * Each host gets a stable slot, slots are numbered 0..size-1 in insertion order and pointers to entries stay valid
+ * until the table gets destroyed. Lookups and inserts are O(1) on average, independent of the number of hosts.
+ * The table is not thread safe, it must only be used by one thread at a time.
+ */
+typedef struct
+{
+    host_entry_t **pages;
+    int page_count;
+    int size;
+    /// Open addressing index, holds slot + 1 of an entry, 0 marks an empty bucket.
+    uint32_t *buckets;
+    uint32_t bucket_count;
+    /// 32 - log2(bucket_count), the hash uses the top bits of the product.
+    int shift;
+} host_table_t;
+
+host_table_t *host_table_init(void);
+host_entry_t *host_table_find(host_table_t *table, ipv4_t host);
+int host_table_find_slot(host_table_t *table, ipv4_t host);
+host_entry_t *host_table_insert(host_table_t *table, ipv4_t host);
+host_entry_t *host_table_slot(host_table_t *table, int slot);
+int host_table_size(host_table_t *table);
+void host_table_destroy(host_table_t *table);
+
+#endif
@@ -3,8 +3,13 @@
 
 #include "lib/sds.h"
 
+#include "vec.h"
+
 typedef uint32_t ipv4_t;
 
+/// List of IPv4 addresses
+typedef vec_t(ipv4_t) ipv4_vec_t;
+
 void print_ipv4(void* ip);
 ipv4_t* malloc_ipv4(ipv4_t ip);
 ipv4_t free_ipv4(ipv4_t* ip_ptr);
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "lib/sds.h"
+
+#include "kcolor.h"
+#include "stats.h"
+#include "metrics.h"
+
+#define METRICS_PREFIX "snmp_discovery_"
+
+static int metrics_socket = -1;
+static pthread_t metrics_thread;
+static atomic_bool metrics_running = false;
+
+/**
+ * @brief Appends a histogram in the text exposition format, the buckets are cumulative.
+ */
+static sds metrics_append_histogram(sds body, const char *phase_name, const stats_histogram_t *histogram)
+{
+    uint64_t cumulative = 0;
+
+    /// Only every power of two is exported, the finer buckets are only used for the summary
+    for(int bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+    {
+        cumulative += histogram->buckets[bucket];
+
+        if(bucket % STATS_HISTOGRAM_SUB_BUCKETS != STATS_HISTOGRAM_SUB_BUCKETS - 1)
+            continue;
+
+        body = sdscatprintf(body, METRICS_PREFIX "phase_duration_seconds_bucket{phase=\"%s\",le=\"%g\"} %llu\n",
+            phase_name, stats_histogram_bucket_upper_us(bucket) / 1e6, (unsigned long long)cumulative);
+
+        if(cumulative == histogram->count)
+            break;
+    }
+
+    body = sdscatprintf(body, METRICS_PREFIX "phase_duration_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n", phase_name, (unsigned long long)histogram->count);
+    body = sdscatprintf(body, METRICS_PREFIX "phase_duration_seconds_sum{phase=\"%s\"} %g\n", phase_name, histogram->sum_us / 1e6);
+    body = sdscatprintf(body, METRICS_PREFIX "phase_duration_seconds_count{phase=\"%s\"} %llu\n", phase_name, (unsigned long long)histogram->count);
+
+    return body;
+}
+
+/**
+ * @brief Renders all statistics in the Prometheus text exposition format.
+ */
+static sds metrics_render(void)
+{
+    static stats_histogram_t phases[STATS_PHASE_COUNT];
+    uint64_t counters[STATS_COUNTER_COUNT];
+    int64_t gauges[STATS_GAUGE_COUNT];
+
+    stats_snapshot(phases, counters, gauges);
+
+    sds body = sdsempty();
+
+    for(int counter = 0; counter < STATS_COUNTER_COUNT; counter++)
+    {
+        const char *name = stats_counter_name(counter);
+        body = sdscatprintf(body, "# TYPE " METRICS_PREFIX "%s_total counter\n", name);
+        body = sdscatprintf(body, METRICS_PREFIX "%s_total %llu\n", name, (unsigned long long)counters[counter]);
+    }
+
+    for(int gauge = 0; gauge < STATS_GAUGE_COUNT; gauge++)
+    {
+        const char *name = stats_gauge_name(gauge);
+        body = sdscatprintf(body, "# TYPE " METRICS_PREFIX "%s gauge\n", name);
+        body = sdscatprintf(body, METRICS_PREFIX "%s %lld\n", name, (long long)gauges[gauge]);
+    }
+
+    body = sdscat(body, "# TYPE " METRICS_PREFIX "phase_duration_seconds histogram\n");
+    for(int phase = 0; phase < STATS_PHASE_COUNT; phase++)
+        body = metrics_append_histogram(body, stats_phase_name(phase), &phases[phase]);
+
+    return body;
+}
+
+static void metrics_send_all(int client, const char *data, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t sent = send(client, data, len, MSG_NOSIGNAL);
+        if(sent <= 0)
+            return;
+
+        data += sent;
+        len -= sent;
+    }
+}
+
+/**
+ * @brief Answers a single HTTP request, only GET /metrics is supported.
+ */
+static void metrics_handle_client(int client)
+{
+    /// A client which doesn't send its request must not block the endpoint
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char request[1024];
+    ssize_t len = recv(client, request, sizeof(request) - 1, 0);
+    if(len <= 0)
+        return;
+    request[len] = '\0';
+
+    sds response;
+
+    if(strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0)
+    {
+        sds body = metrics_render();
+        response = sdscatprintf(sdsempty(),
+            "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+            sdslen(body));
+        response = sdscatsds(response, body);
+        sdsfree(body);
+    }
+    else
+    {
+        response = sdsnew("HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+
+    metrics_send_all(client, response, sdslen(response));
+    sdsfree(response);
+}
+
+static void *metrics_server_thread(void *param)
+{
+    struct pollfd listen_poll = { .fd = metrics_socket, .events = POLLIN };
+
+    while(atomic_load(&metrics_running))
+    {
+        if(poll(&listen_poll, 1, METRICS_POLL_MS) <= 0)
+            continue;
+
+        int client = accept(metrics_socket, NULL, NULL);
+        if(client < 0)
+            continue;
+
+        metrics_handle_client(client);
+        close(client);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the HTTP metrics endpoint on the loopback interface
+ *
+ * Serves the counters, gauges and phase histograms of the stats module on http://127.0.0.1:port/metrics.
+ * Collecting them only reads the per-thread stats, the threads doing the work are never blocked.
+ *
+ * @param port TCP port to listen on.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int metrics_setup(int port)
+{
+    metrics_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(metrics_socket < 0)
+    {
+        printf(KRED "[ERROR] metrics_setup couldn't create socket.\n" KNORMAL);
+        return EXIT_FAILURE;
+    }
+
+    int reuse = 1;
+    setsockopt(metrics_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(metrics_socket, (struct sockaddr *)&address, sizeof(address)) || listen(metrics_socket, 8))
+    {
+        printf(KRED "[ERROR] metrics_setup couldn't listen on port %d.\n" KNORMAL, port);
+        close(metrics_socket);
+        metrics_socket = -1;
+        return EXIT_FAILURE;
+    }
+
+    atomic_store(&metrics_running, true);
+
+    if(pthread_create(&metrics_thread, NULL, metrics_server_thread, NULL))
+    {
+        printf(KRED "[ERROR] metrics_setup couldn't create thread.\n" KNORMAL);
+        atomic_store(&metrics_running, false);
+        close(metrics_socket);
+        metrics_socket = -1;
+        return EXIT_FAILURE;
+    }
+
+    printf("Serving metrics on http://127.0.0.1:%d/metrics\n", port);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Stops the metrics endpoint.
+ */
+void metrics_shutdown(void)
+{
+    if(!atomic_exchange(&metrics_running, false))
+        return;
+
+    pthread_join(metrics_thread, NULL);
+
+    close(metrics_socket);
+    metrics_socket = -1;
+}
@@ -0,0 +1,17 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/// TCP port of the metrics endpoint, only bound on the loopback interface.
+#ifndef METRICS_PORT
+#define METRICS_PORT 9161
+#endif
+
+/// Poll interval of the metrics thread, defines how long metrics_shutdown can take.
+#ifndef METRICS_POLL_MS
+#define METRICS_POLL_MS 200
+#endif
+
+int metrics_setup(int port);
+void metrics_shutdown(void);
+
+#endif
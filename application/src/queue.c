@@ -0,0 +1,188 @@
+#include <stdlib.h>
+
+#include "queue.h"
+
+/**
+ * @brief Allocates a bounded queue
+ *
+ * @param capacity max number of items the queue can hold before producers get blocked.
+ * @return the allocated queue, needs to be freed with queue_destroy.
+ */
+queue_t *queue_init(int capacity)
+{
+    queue_t *queue = (queue_t *)malloc(sizeof(queue_t));
+
+    queue->items = (void **)calloc(capacity, sizeof(void *));
+    queue->capacity = capacity;
+    queue->size = 0;
+    queue->head = 0;
+    queue->closed = false;
+
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    return queue;
+}
+
+static void queue_insert_locked(queue_t *queue, void *item)
+{
+    queue->items[(queue->head + queue->size) % queue->capacity] = item;
+    queue->size++;
+
+    pthread_cond_signal(&queue->not_empty);
+}
+
+static void *queue_remove_locked(queue_t *queue)
+{
+    void *item = queue->items[queue->head];
+
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->size--;
+
+    pthread_cond_signal(&queue->not_full);
+
+    return item;
+}
+
+/**
+ * @brief Appends an item, blocks while the queue is full.
+ *
+ * @param queue the queue to append to.
+ * @param item the item to append.
+ * @return 0 on success, 1 if the queue has been closed.
+ */
+int queue_push(queue_t *queue, void *item)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    while(queue->size == queue->capacity && !queue->closed)
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+
+    if(queue->closed)
+    {
+        pthread_mutex_unlock(&queue->mutex);
+        return EXIT_FAILURE;
+    }
+
+    queue_insert_locked(queue, item);
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Appends an item if there is space left, never blocks.
+ *
+ * @param queue the queue to append to.
+ * @param item the item to append.
+ * @return 0 on success, 1 if the queue is full or has been closed.
+ */
+int queue_try_push(queue_t *queue, void *item)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    if(queue->size == queue->capacity || queue->closed)
+    {
+        pthread_mutex_unlock(&queue->mutex);
+        return EXIT_FAILURE;
+    }
+
+    queue_insert_locked(queue, item);
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Removes the oldest item, blocks while the queue is empty.
+ *
+ * @param queue the queue to remove from.
+ * @return the removed item, NULL if the queue has been closed and is empty.
+ */
+void *queue_pop(queue_t *queue)
+{
+    void *item = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    while(queue->size == 0 && !queue->closed)
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+
+    if(queue->size > 0)
+        item = queue_remove_locked(queue);
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return item;
+}
+
+/**
+ * @brief Removes the oldest item if there is one, never blocks.
+ *
+ * @param queue the queue to remove from.
+ * @return the removed item, NULL if the queue is empty.
+ */
+void *queue_try_pop(queue_t *queue)
+{
+    void *item = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    if(queue->size > 0)
+        item = queue_remove_locked(queue);
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return item;
+}
+
+/**
+ * @brief Returns the number of queued items.
+ *
+ * @param queue the queue to check.
+ * @return number of queued items.
+ */
+int queue_size(queue_t *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    int size = queue->size;
+    pthread_mutex_unlock(&queue->mutex);
+
+    return size;
+}
+
+/**
+ * @brief Closes the queue
+ *
+ * Producers will fail from now on, consumers get the remaining items and NULL afterwards.
+ *
+ * @param queue the queue to close.
+ */
+void queue_close(queue_t *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+/**
+ * @brief Frees the queue, remaining items are not freed.
+ *
+ * @param queue the queue to free.
+ */
+void queue_destroy(queue_t *queue)
+{
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+
+    free(queue->items);
+    free(queue);
+}
@@ -0,0 +1,32 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+ * Bounded FIFO queue which can be shared between threads.
+ * Producers block while the queue is full, consumers block while it is empty.
+ */
+typedef struct
+{
+    void **items;
+    int capacity;
+    int size;
+    int head;
+    bool closed;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} queue_t;
+
+queue_t *queue_init(int capacity);
+int queue_push(queue_t *queue, void *item);
+int queue_try_push(queue_t *queue, void *item);
+void *queue_pop(queue_t *queue);
+void *queue_try_pop(queue_t *queue);
+int queue_size(queue_t *queue);
+void queue_close(queue_t *queue);
+void queue_destroy(queue_t *queue);
+
+#endif
@@ -0,0 +1,436 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "snmp_ber.h"
+
+/* -------------------------------------------------------------------------- */
+/* Decoding                                                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Reads the tag and the length of the next TLV, the reader is moved to its value.
+ *
+ * Same as parse_asn_length of onesixtyone, lengths in the short form and in the long form with up to 4 bytes.
+ *
+ * @return the length of the value, -1 if the packet is truncated or malformed.
+ */
+int snmp_ber_get_header(snmp_ber_reader_t *reader, uint8_t *tag)
+{
+    if(reader->pos + 2 > reader->len)
+        return -1;
+
+    *tag = reader->data[reader->pos++];
+    size_t len = reader->data[reader->pos++];
+
+    if(len & 0x80)
+    {
+        int count = len & 0x7F;
+        if(count == 0 || count > 4 || reader->pos + count > reader->len)
+            return -1;
+
+        len = 0;
+        for(int i = 0; i < count; i++)
+            len = (len << 8) | reader->data[reader->pos++];
+    }
+
+    if(len > reader->len - reader->pos)
+        return -1;
+
+    return (int)len;
+}
+
+/**
+ * @brief Reads an INTEGER of up to 4 bytes.
+ * @return false if the next TLV isn't such an INTEGER.
+ */
+bool snmp_ber_get_integer(snmp_ber_reader_t *reader, int32_t *value)
+{
+    uint8_t tag;
+    int len = snmp_ber_get_header(reader, &tag);
+    if(len < 1 || len > 4 || tag != SNMP_BER_INTEGER)
+        return false;
+
+    uint32_t result = reader->data[reader->pos] & 0x80 ? 0xFFFFFFFF : 0;
+    for(int i = 0; i < len; i++)
+        result = (result << 8) | reader->data[reader->pos++];
+
+    *value = (int32_t)result;
+    return true;
+}
+
+/**
+ * @brief Decodes the header of a SNMPv1/v2c message up to the varbind list, nothing is copied.
+ *
+ * @param data the received packet, must stay valid while the PDU and its varbinds are used.
+ * @param len length of the packet.
+ * @param pdu is filled with the header fields, pdu->community points into the packet.
+ * @return false if the packet isn't a SNMPv1/v2c message.
+ */
+bool snmp_ber_decode_pdu(const uint8_t *data, size_t len, snmp_ber_pdu_t *pdu)
+{
+    snmp_ber_reader_t reader = { data, len, 0 };
+    uint8_t tag;
+
+    if(snmp_ber_get_header(&reader, &tag) < 0 || tag != SNMP_BER_SEQUENCE || !snmp_ber_get_integer(&reader, &pdu->version))
+        return false;
+
+    pdu->community_len = snmp_ber_get_header(&reader, &tag);
+    if(pdu->community_len < 0 || tag != SNMP_BER_OCTET_STRING)
+        return false;
+    pdu->community = data + reader.pos;
+    reader.pos += pdu->community_len;
+
+    int pdu_len = snmp_ber_get_header(&reader, &tag);
+    if(pdu_len < 0 || (tag & 0xE0) != 0xA0)
+        return false;
+    pdu->pdu_type = tag;
+
+    /// For GETBULK requests these are non-repeaters and max-repetitions
+    if(!snmp_ber_get_integer(&reader, &pdu->request_id) || !snmp_ber_get_integer(&reader, &pdu->error_status)
+        || !snmp_ber_get_integer(&reader, &pdu->error_index))
+        return false;
+
+    int varbind_list_len = snmp_ber_get_header(&reader, &tag);
+    if(varbind_list_len < 0 || tag != SNMP_BER_SEQUENCE)
+        return false;
+
+    pdu->varbind_reader.data = data;
+    pdu->varbind_reader.pos = reader.pos;
+    pdu->varbind_reader.len = reader.pos + varbind_list_len;
+
+    return true;
+}
+
+/**
+ * @brief Reads the next varbind of a decoded PDU.
+ *
+ * @return 1 if a varbind has been read, 0 at the end of the varbind list, -1 if the varbind is malformed.
+ */
+int snmp_ber_next_varbind(snmp_ber_pdu_t *pdu, snmp_ber_varbind_t *varbind)
+{
+    snmp_ber_reader_t *reader = &pdu->varbind_reader;
+    uint8_t tag;
+
+    if(reader->pos >= reader->len)
+        return 0;
+
+    int varbind_len = snmp_ber_get_header(reader, &tag);
+    if(varbind_len < 0 || tag != SNMP_BER_SEQUENCE)
+        return -1;
+
+    size_t end = reader->pos + varbind_len;
+
+    varbind->oid_len = snmp_ber_get_header(reader, &tag);
+    if(varbind->oid_len < 1 || tag != SNMP_BER_OID)
+        return -1;
+    varbind->oid = reader->data + reader->pos;
+    reader->pos += varbind->oid_len;
+
+    varbind->value_len = snmp_ber_get_header(reader, &varbind->tag);
+    if(varbind->value_len < 0 || reader->pos + varbind->value_len != end)
+        return -1;
+    varbind->value = reader->data + reader->pos;
+    reader->pos = end;
+
+    return 1;
+}
+
+/**
+ * @brief Decodes the sub identifiers of an OID value.
+ *
+ * @param oid needs room for SNMP_BER_MAX_OID_LEN sub identifiers.
+ * @return the number of sub identifiers, -1 if the OID is malformed or too long.
+ */
+int snmp_ber_decode_oid(const uint8_t *data, int len, uint32_t *oid)
+{
+    int oid_len = 0;
+    uint32_t sub_id = 0;
+
+    for(int i = 0; i < len; i++)
+    {
+        sub_id = (sub_id << 7) | (data[i] & 0x7F);
+        if(data[i] & 0x80)
+            continue;
+
+        if(oid_len == 0)
+        {
+            oid[oid_len++] = sub_id < 80 ? sub_id / 40 : 2;
+            oid[oid_len++] = sub_id < 80 ? sub_id % 40 : sub_id - 80;
+        }
+        else if(oid_len < SNMP_BER_MAX_OID_LEN)
+        {
+            oid[oid_len++] = sub_id;
+        }
+        else
+        {
+            return -1;
+        }
+
+        sub_id = 0;
+    }
+
+    return len > 0 && !(data[len - 1] & 0x80) ? oid_len : -1;
+}
+
+/**
+ * @brief Decodes the value of a Counter32, Gauge32, Timeticks or Counter64.
+ */
+uint64_t snmp_ber_decode_unsigned(const uint8_t *data, int len)
+{
+    uint64_t value = 0;
+    for(int i = 0; i < len; i++)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Encoding                                                                   */
+/* -------------------------------------------------------------------------- */
+
+static size_t ber_header_len(size_t len)
+{
+    return len < 0x80 ? 2 : (len < 0x100 ? 3 : 4);
+}
+
+static uint8_t *ber_put_header(uint8_t *out, uint8_t tag, size_t len)
+{
+    *out++ = tag;
+
+    if(len >= 0x100)
+    {
+        *out++ = 0x82;
+        *out++ = (len >> 8) & 0xFF;
+    }
+    else if(len >= 0x80)
+    {
+        *out++ = 0x81;
+    }
+
+    *out++ = len & 0xFF;
+
+    return out;
+}
+
+/// Length in the long form with two bytes, so it can be patched in place
+static uint8_t *ber_put_fixed_header(uint8_t *out, uint8_t tag)
+{
+    *out++ = tag;
+    *out++ = 0x82;
+    *out++ = 0;
+    *out++ = 0;
+
+    return out;
+}
+
+static void ber_patch_len(uint8_t *data, size_t len_pos, size_t len)
+{
+    data[len_pos] = (len >> 8) & 0xFF;
+    data[len_pos + 1] = len & 0xFF;
+}
+
+/// Patches the lengths of the message, the PDU and the varbind list of a request built from a template
+static void ber_patch_lengths(const snmp_ber_template_t *template, uint8_t *data, size_t len)
+{
+    ber_patch_len(data, template->message_len_pos, len - template->message_len_pos - 2);
+    ber_patch_len(data, template->pdu_len_pos, len - template->pdu_len_pos - 2);
+    ber_patch_len(data, template->varbind_list_len_pos, len - template->varbind_list_len_pos - 2);
+}
+
+static void ber_patch_request_id(const snmp_ber_template_t *template, uint8_t *data, int32_t request_id)
+{
+    uint8_t *pos = data + template->request_id_pos;
+
+    pos[0] = ((uint32_t)request_id >> 24) & 0xFF;
+    pos[1] = ((uint32_t)request_id >> 16) & 0xFF;
+    pos[2] = ((uint32_t)request_id >> 8) & 0xFF;
+    pos[3] = (uint32_t)request_id & 0xFF;
+}
+
+static uint8_t *ber_put_integer(uint8_t *out, int32_t value)
+{
+    int len = 4;
+
+    while(len > 1)
+    {
+        int32_t top = value >> ((len - 1) * 8 - 1);
+        if(top != 0 && top != -1)
+            break;
+        len--;
+    }
+
+    out = ber_put_header(out, SNMP_BER_INTEGER, len);
+
+    for(int i = len - 1; i >= 0; i--)
+        *out++ = ((uint32_t)value >> (i * 8)) & 0xFF;
+
+    return out;
+}
+
+/**
+ * @brief Encodes the sub identifiers of an OID.
+ *
+ * @param out needs room for 5 bytes per sub identifier.
+ * @return the length of the encoded OID.
+ */
+int snmp_ber_encode_oid(const uint32_t *oid, int oid_len, uint8_t *out)
+{
+    int len = 0;
+
+    for(int i = 1; i < oid_len; i++)
+    {
+        uint32_t sub_id = i == 1 ? oid[0] * 40 + oid[1] : oid[i];
+        uint8_t bytes[5];
+        int count = 0;
+
+        do
+        {
+            bytes[count++] = sub_id & 0x7F;
+            sub_id >>= 7;
+        } while(sub_id != 0);
+
+        while(count > 0)
+        {
+            count--;
+            out[len++] = bytes[count] | (count > 0 ? 0x80 : 0);
+        }
+    }
+
+    return len;
+}
+
+/**
+ * @brief Maps a sequence number to a request-id which is encoded in exactly 4 bytes.
+ *
+ * The shortest encoding is the only valid BER encoding of an INTEGER, request-ids between 2^24 and 2^31 - 1 always
+ * take 4 bytes and fit into the field of a template.
+ */
+int32_t snmp_ber_request_id(uint32_t sequence)
+{
+    return (int32_t)((sequence & 0x3FFFFFFF) | 0x01000000);
+}
+
+/**
+ * @brief Pre-serializes the header of a request without varbinds.
+ *
+ * @param template is initialized.
+ * @param pdu_type SNMP_PDU_GET, SNMP_PDU_GETNEXT or SNMP_PDU_GETBULK.
+ * @param version 0 for SNMPv1, 1 for SNMPv2c.
+ * @param community the community, at most 255 bytes.
+ * @param community_len length of the community.
+ * @param non_repeaters only used for GETBULK, error-status of the other PDUs.
+ * @param max_repetitions only used for GETBULK, error-index of the other PDUs.
+ */
+void snmp_ber_template_init(snmp_ber_template_t *template, uint8_t pdu_type, int32_t version, const char *community, size_t community_len, int32_t non_repeaters, int32_t max_repetitions)
+{
+    uint8_t *pos = template->data;
+
+    if(pdu_type != SNMP_PDU_GETBULK)
+    {
+        non_repeaters = 0;
+        max_repetitions = 0;
+    }
+
+    pos = ber_put_fixed_header(pos, SNMP_BER_SEQUENCE);
+    template->message_len_pos = 2;
+    pos = ber_put_integer(pos, version);
+    pos = ber_put_header(pos, SNMP_BER_OCTET_STRING, community_len);
+    memcpy(pos, community, community_len);
+    pos += community_len;
+
+    template->pdu_len_pos = pos - template->data + 2;
+    pos = ber_put_fixed_header(pos, pdu_type);
+
+    *pos++ = SNMP_BER_INTEGER;
+    *pos++ = 4;
+    template->request_id_pos = pos - template->data;
+    pos += 4;
+    pos = ber_put_integer(pos, non_repeaters);
+    pos = ber_put_integer(pos, max_repetitions);
+
+    template->varbind_list_len_pos = pos - template->data + 2;
+    pos = ber_put_fixed_header(pos, SNMP_BER_SEQUENCE);
+
+    template->len = pos - template->data;
+    ber_patch_lengths(template, template->data, template->len);
+    ber_patch_request_id(template, template->data, snmp_ber_request_id(0));
+}
+
+/// Encodes the varbind "oid = NULL" of a request, returns the end of the varbind
+static uint8_t *ber_put_null_varbind(uint8_t *out, const uint8_t *oid_ber, int oid_ber_len)
+{
+    size_t varbind_len = ber_header_len(oid_ber_len) + oid_ber_len + 2;
+
+    out = ber_put_header(out, SNMP_BER_SEQUENCE, varbind_len);
+    out = ber_put_header(out, SNMP_BER_OID, oid_ber_len);
+    memcpy(out, oid_ber, oid_ber_len);
+    out += oid_ber_len;
+    out = ber_put_header(out, SNMP_BER_NULL, 0);
+
+    return out;
+}
+
+/**
+ * @brief Appends the varbind of an OID to a template, the lengths are patched in place.
+ *
+ * @return Status Code (0 = SUCESS, 1 = FAILURE if the request would be larger than SNMP_BER_MAX_REQUEST)
+ */
+int snmp_ber_template_add_oid(snmp_ber_template_t *template, const uint32_t *oid, int oid_len)
+{
+    uint8_t oid_ber[SNMP_BER_MAX_OID_LEN * 5];
+
+    if(oid_len > SNMP_BER_MAX_OID_LEN)
+        return EXIT_FAILURE;
+
+    int oid_ber_len = snmp_ber_encode_oid(oid, oid_len, oid_ber);
+    size_t varbind_len = ber_header_len(oid_ber_len) + oid_ber_len + 2;
+
+    if(template->len + ber_header_len(varbind_len) + varbind_len > SNMP_BER_MAX_REQUEST)
+        return EXIT_FAILURE;
+
+    template->len = ber_put_null_varbind(template->data + template->len, oid_ber, oid_ber_len) - template->data;
+    ber_patch_lengths(template, template->data, template->len);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Patches the request-id of a template in place, the template can be sent as it is afterwards.
+ *
+ * @param request_id from snmp_ber_request_id.
+ */
+void snmp_ber_template_set_request_id(snmp_ber_template_t *template, int32_t request_id)
+{
+    ber_patch_request_id(template, template->data, request_id);
+}
+
+/**
+ * @brief Copies a template and appends one more varbind, e.g. the next OID of a walk.
+ *
+ * @param template the header and the fixed varbinds of the request.
+ * @param request_id from snmp_ber_request_id.
+ * @param oid the OID of the varbind which is appended.
+ * @param oid_len number of sub identifiers of the OID.
+ * @param out needs room for SNMP_BER_MAX_REQUEST bytes.
+ * @return the length of the request, 0 if it would be larger than SNMP_BER_MAX_REQUEST.
+ */
+size_t snmp_ber_template_encode(const snmp_ber_template_t *template, int32_t request_id, const uint32_t *oid, int oid_len, uint8_t *out)
+{
+    uint8_t oid_ber[SNMP_BER_MAX_OID_LEN * 5];
+
+    if(oid_len > SNMP_BER_MAX_OID_LEN)
+        return 0;
+
+    int oid_ber_len = snmp_ber_encode_oid(oid, oid_len, oid_ber);
+    size_t varbind_len = ber_header_len(oid_ber_len) + oid_ber_len + 2;
+    size_t len = template->len + ber_header_len(varbind_len) + varbind_len;
+
+    if(len > SNMP_BER_MAX_REQUEST)
+        return 0;
+
+    memcpy(out, template->data, template->len);
+    ber_put_null_varbind(out + template->len, oid_ber, oid_ber_len);
+    ber_patch_lengths(template, out, len);
+    ber_patch_request_id(template, out, request_id);
+
+    return len;
+}
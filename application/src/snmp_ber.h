@@ -0,0 +1,106 @@
+#ifndef SNMP_BER_H
+#define SNMP_BER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SNMP_BER_INTEGER 0x02
+#define SNMP_BER_OCTET_STRING 0x04
+#define SNMP_BER_NULL 0x05
+#define SNMP_BER_OID 0x06
+#define SNMP_BER_SEQUENCE 0x30
+#define SNMP_BER_IP_ADDRESS 0x40
+#define SNMP_BER_COUNTER32 0x41
+#define SNMP_BER_GAUGE32 0x42
+#define SNMP_BER_TIMETICKS 0x43
+#define SNMP_BER_OPAQUE 0x44
+#define SNMP_BER_COUNTER64 0x46
+#define SNMP_BER_NO_SUCH_OBJECT 0x80
+#define SNMP_BER_NO_SUCH_INSTANCE 0x81
+#define SNMP_BER_END_OF_MIB_VIEW 0x82
+
+#define SNMP_PDU_GET 0xA0
+#define SNMP_PDU_GETNEXT 0xA1
+#define SNMP_PDU_RESPONSE 0xA2
+#define SNMP_PDU_GETBULK 0xA5
+
+/// error-status of a response which doesn't fit into a message of the agent
+#define SNMP_ERROR_TOO_BIG 1
+
+/// Largest number of sub identifiers of an OID.
+#define SNMP_BER_MAX_OID_LEN 128
+
+/// Largest request built from a template, a request must fit into a single Ethernet frame.
+#ifndef SNMP_BER_MAX_REQUEST
+#define SNMP_BER_MAX_REQUEST 1472
+#endif
+
+/**
+ * Read position in a received packet, values are returned as spans into the packet.
+ */
+typedef struct
+{
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} snmp_ber_reader_t;
+
+/**
+ * Decoded header of a SNMPv1/v2c message. The community and the varbinds point into the packet.
+ */
+typedef struct
+{
+    int32_t version;
+    const uint8_t *community;
+    int community_len;
+    uint8_t pdu_type;
+    int32_t request_id;
+    int32_t error_status;
+    int32_t error_index;
+    /// Rest of the varbind list, read with snmp_ber_next_varbind
+    snmp_ber_reader_t varbind_reader;
+} snmp_ber_pdu_t;
+
+/**
+ * A varbind as spans into the packet, the OID is still BER encoded (see snmp_ber_decode_oid).
+ */
+typedef struct
+{
+    const uint8_t *oid;
+    int oid_len;
+    uint8_t tag;
+    const uint8_t *value;
+    int value_len;
+} snmp_ber_varbind_t;
+
+/**
+ * Pre-serialized request. All lengths are encoded in the long form with two bytes and the request-id with four bytes,
+ * so the request-id is patched and varbinds are appended in place without moving the header.
+ */
+typedef struct
+{
+    uint8_t data[SNMP_BER_MAX_REQUEST];
+    size_t len;
+    /// Offsets of the lengths of the message, the PDU and the varbind list
+    size_t message_len_pos;
+    size_t pdu_len_pos;
+    size_t varbind_list_len_pos;
+    size_t request_id_pos;
+} snmp_ber_template_t;
+
+int snmp_ber_get_header(snmp_ber_reader_t *reader, uint8_t *tag);
+bool snmp_ber_get_integer(snmp_ber_reader_t *reader, int32_t *value);
+bool snmp_ber_decode_pdu(const uint8_t *data, size_t len, snmp_ber_pdu_t *pdu);
+int snmp_ber_next_varbind(snmp_ber_pdu_t *pdu, snmp_ber_varbind_t *varbind);
+int snmp_ber_decode_oid(const uint8_t *data, int len, uint32_t *oid);
+uint64_t snmp_ber_decode_unsigned(const uint8_t *data, int len);
+int snmp_ber_encode_oid(const uint32_t *oid, int oid_len, uint8_t *out);
+
+int32_t snmp_ber_request_id(uint32_t sequence);
+void snmp_ber_template_init(snmp_ber_template_t *template, uint8_t pdu_type, int32_t version, const char *community, size_t community_len, int32_t non_repeaters, int32_t max_repetitions);
+int snmp_ber_template_add_oid(snmp_ber_template_t *template, const uint32_t *oid, int oid_len);
+void snmp_ber_template_set_request_id(snmp_ber_template_t *template, int32_t request_id);
+size_t snmp_ber_template_encode(const snmp_ber_template_t *template, int32_t request_id, const uint32_t *oid, int oid_len, uint8_t *out);
+
+#endif
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "kcolor.h"
+#include "host_table.h"
+#include "snmp_credential.h"
+
+static snmp_credential_vec_t credential_list = { NULL, 0, 0 };
+
+/// Credential each host answered to during the sweep, the walks and traps of the host use it.
+static host_table_t *credential_hosts = NULL;
+static pthread_rwlock_t credential_hosts_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static snmp_credential_t *snmp_credential_add(snmp_version_t version)
+{
+    snmp_credential_t *credential = vec_push_slot(&credential_list);
+
+    credential->version = version;
+    credential->community_str = sdsempty();
+    credential->user_str = sdsempty();
+    credential->security_level_str = sdsnew("noAuthNoPriv");
+    credential->auth_protocol_str = sdsempty();
+    credential->auth_password_str = sdsempty();
+    credential->priv_protocol_str = sdsempty();
+    credential->priv_password_str = sdsempty();
+
+    return credential;
+}
+
+/**
+ * @brief Parses a line of a credentials file.
+ *
+ * Formats:
+ *   <community>                               v2c community, like the <community> argument
+ *   v1 <community>
+ *   v2c <community>
+ *   v3 <user> [<level> [<auth protocol> <auth password> [<priv protocol> <priv password>]]]
+ *
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+static int snmp_credential_parse_line(sds line_str)
+{
+    int count;
+    sds *tokens = sdssplitargs(line_str, &count);
+    int status = EXIT_SUCCESS;
+
+    if(tokens == NULL)
+        return EXIT_FAILURE;
+
+    if(count == 1)
+    {
+        if(snmp_credential_find_community(tokens[0]) < 0)
+        {
+            snmp_credential_t *credential = snmp_credential_add(SNMP_VERSION_2C);
+            credential->community_str = sdscpy(credential->community_str, tokens[0]);
+        }
+    }
+    else if(count == 2 && (strcmp(tokens[0], "v1") == 0 || strcmp(tokens[0], "v2c") == 0))
+    {
+        snmp_credential_t *credential = snmp_credential_add(strcmp(tokens[0], "v1") == 0 ? SNMP_VERSION_1 : SNMP_VERSION_2C);
+        credential->community_str = sdscpy(credential->community_str, tokens[1]);
+    }
+    else if(count >= 2 && count <= 7 && count != 4 && count != 6 && strcmp(tokens[0], "v3") == 0)
+    {
+        snmp_credential_t *credential = snmp_credential_add(SNMP_VERSION_3);
+        credential->user_str = sdscpy(credential->user_str, tokens[1]);
+
+        if(count >= 3)
+            credential->security_level_str = sdscpy(credential->security_level_str, tokens[2]);
+        if(count >= 5)
+        {
+            credential->auth_protocol_str = sdscpy(credential->auth_protocol_str, tokens[3]);
+            credential->auth_password_str = sdscpy(credential->auth_password_str, tokens[4]);
+        }
+        if(count >= 7)
+        {
+            credential->priv_protocol_str = sdscpy(credential->priv_protocol_str, tokens[5]);
+            credential->priv_password_str = sdscpy(credential->priv_password_str, tokens[6]);
+        }
+    }
+    else
+    {
+        status = EXIT_FAILURE;
+    }
+
+    sdsfreesplitres(tokens, count);
+
+    return status;
+}
+
+/**
+ * @brief Builds the credential list, the community argument is always the first credential.
+ *
+ * @param community_str the community argument of the application, used as v2c credential.
+ * @param path credentials file with one credential per line, may be NULL. Empty lines and lines starting with # are ignored.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_credential_setup(sds* community_str, const char* path)
+{
+    vec_init(&credential_list);
+
+    snmp_credential_t *credential = snmp_credential_add(SNMP_VERSION_2C);
+    credential->community_str = sdscpy(credential->community_str, *community_str);
+
+    credential_hosts = host_table_init();
+
+    if(path == NULL)
+        return EXIT_SUCCESS;
+
+    FILE *file = fopen(path, "r");
+    if(file == NULL)
+    {
+        printf(KRED "[ERROR] snmp_credential_setup can't open %s.\n" KNORMAL, path);
+        return EXIT_FAILURE;
+    }
+
+    char *line = NULL;
+    size_t len = 0;
+    ssize_t nread;
+    int line_number = 0;
+    int status = EXIT_SUCCESS;
+
+    while((nread = getline(&line, &len, file)) != -1)
+    {
+        line_number++;
+
+        sds line_str = sdsnewlen(line, nread);
+        line_str = sdstrim(line_str, " \t\r\n");
+
+        if(sdslen(line_str) > 0 && line_str[0] != '#' && snmp_credential_parse_line(line_str))
+        {
+            printf(KRED "[ERROR] snmp_credential_setup can't parse line %d of %s.\n" KNORMAL, line_number, path);
+            status = EXIT_FAILURE;
+        }
+
+        sdsfree(line_str);
+    }
+
+    free(line);
+    fclose(file);
+
+    return status;
+}
+
+/**
+ * @brief Frees the credential list and the credentials of the hosts.
+ */
+void snmp_credential_shutdown(void)
+{
+    snmp_credential_t *credential;
+
+    vec_each(&credential_list, credential)
+    {
+        sdsfree(credential->community_str);
+        sdsfree(credential->user_str);
+        sdsfree(credential->security_level_str);
+        sdsfree(credential->auth_protocol_str);
+        sdsfree(credential->auth_password_str);
+        sdsfree(credential->priv_protocol_str);
+        sdsfree(credential->priv_password_str);
+    }
+    vec_free(&credential_list);
+
+    pthread_rwlock_wrlock(&credential_hosts_lock);
+    if(credential_hosts != NULL)
+        host_table_destroy(credential_hosts);
+    credential_hosts = NULL;
+    pthread_rwlock_unlock(&credential_hosts_lock);
+}
+
+/**
+ * @brief Returns all credentials, the list must not be changed.
+ */
+snmp_credential_vec_t* snmp_credential_get_list(void)
+{
+    return &credential_list;
+}
+
+/**
+ * @brief Returns the index of the first v1/v2c credential with a community, -1 if there is none.
+ */
+int snmp_credential_find_community(const char* community)
+{
+    for(int i = 0; i < credential_list.size; i++)
+    {
+        if(credential_list.data[i].version != SNMP_VERSION_3 && strcmp(credential_list.data[i].community_str, community) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Returns the index of the first credential of a SNMP version, -1 if there is none.
+ */
+int snmp_credential_find_version(snmp_version_t version)
+{
+    for(int i = 0; i < credential_list.size; i++)
+    {
+        if(credential_list.data[i].version == version)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Returns the number of packets a sweep sends to each host, one per community and one for SNMPv3.
+ */
+int snmp_credential_probe_count(void)
+{
+    int count = snmp_credential_find_version(SNMP_VERSION_3) >= 0 ? 1 : 0;
+
+    for(int i = 0; i < credential_list.size; i++)
+    {
+        if(credential_list.data[i].version != SNMP_VERSION_3 && snmp_credential_find_community(credential_list.data[i].community_str) == i)
+            count++;
+    }
+
+    return count > 0 ? count : 1;
+}
+
+/**
+ * @brief Remembers the credential a host answered to, can be called from any thread.
+ *
+ * @param host the host.
+ * @param credential index in the credential list.
+ */
+void snmp_credential_set_host(ipv4_t host, int credential)
+{
+    if(credential < 0 || credential >= credential_list.size)
+        return;
+
+    pthread_rwlock_wrlock(&credential_hosts_lock);
+    host_table_insert(credential_hosts, host)->credential = credential;
+    pthread_rwlock_unlock(&credential_hosts_lock);
+}
+
+/**
+ * @brief Returns the credential of a host, can be called from any thread.
+ *
+ * @param host the host.
+ * @return the credential the host answered to, the first credential if the host is unknown (e.g. a trap from a new device).
+ */
+const snmp_credential_t* snmp_credential_for_host(ipv4_t host)
+{
+    int credential = 0;
+
+    pthread_rwlock_rdlock(&credential_hosts_lock);
+    host_entry_t *entry = credential_hosts != NULL ? host_table_find(credential_hosts, host) : NULL;
+    if(entry != NULL && entry->credential >= 0)
+        credential = entry->credential;
+    pthread_rwlock_unlock(&credential_hosts_lock);
+
+    return &credential_list.data[credential];
+}
+
+/**
+ * @brief Describes a credential without its passwords, e.g. "v2c public" or "v3 admin authPriv".
+ *
+ * @return the description, needs to be freed with sdsfree.
+ */
+sds snmp_credential_to_str(const snmp_credential_t* credential)
+{
+    switch(credential->version)
+    {
+        case SNMP_VERSION_1:
+            return sdscatprintf(sdsempty(), "v1 %s", credential->community_str);
+        case SNMP_VERSION_2C:
+            return sdscatprintf(sdsempty(), "v2c %s", credential->community_str);
+        default:
+            return sdscatprintf(sdsempty(), "v3 %s %s", credential->user_str, credential->security_level_str);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef SNMP_CREDENTIAL_H
+#define SNMP_CREDENTIAL_H
+
+#include "lib/sds.h"
+
+#include "ip.h"
+#include "vec.h"
+
+typedef enum
+{
+    SNMP_VERSION_1,
+    SNMP_VERSION_2C,
+    SNMP_VERSION_3
+} snmp_version_t;
+
+/**
+ * Credential to access an agent, v1/v2c use the community, v3 the USM user.
+ */
+typedef struct
+{
+    snmp_version_t version;
+    sds community_str;
+    sds user_str;
+    /// noAuthNoPriv, authNoPriv or authPriv
+    sds security_level_str;
+    sds auth_protocol_str;
+    sds auth_password_str;
+    sds priv_protocol_str;
+    sds priv_password_str;
+} snmp_credential_t;
+
+/// List of credentials, the index is used as credential id.
+typedef vec_t(snmp_credential_t) snmp_credential_vec_t;
+
+int snmp_credential_setup(sds* community_str, const char* path);
+void snmp_credential_shutdown(void);
+
+snmp_credential_vec_t* snmp_credential_get_list(void);
+int snmp_credential_find_community(const char* community);
+int snmp_credential_find_version(snmp_version_t version);
+int snmp_credential_probe_count(void);
+
+void snmp_credential_set_host(ipv4_t host, int credential);
+const snmp_credential_t* snmp_credential_for_host(ipv4_t host);
+sds snmp_credential_to_str(const snmp_credential_t* credential);
+
+#endif
@@ -1,48 +1,212 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 
 #include "debug.h"
 #include "kcolor.h"
+#include "stats.h"
+#include "host_table.h"
 #include "snmp_network.h"
+#include "snmp_credential.h"
+#include "snmp_walker.h"
+#include "target_set.h"
 #include "network_tree_nodes.h"
 
 #include "ip.h"
 
+/**
+ * @brief Finds the SNMPv3 user a host accepts
+ *
+ * The engine discovery probe of the sweep is answered before any user is checked, so it doesn't tell which user
+ * the host knows. The v3 users are tried in the order of the credentials file with a walk of sysObjectID, the first
+ * one that returns a value is used for the host.
+ *
+ * @param exec_path_str The path fom the main applicatio
+ * @param host IPv4 address of a host that answered the engine discovery probe.
+ * @return index of the credential, the first v3 user if none of them got an answer.
+ */
+static int snmp_network_find_v3_user(sds* exec_path_str, ipv4_t host)
+{
+    snmp_credential_vec_t *credential_list = snmp_credential_get_list();
+    sds oid_str = sdsnew("1.3.6.1.2.1.1.2");
+    sds output_str = sdsempty();
+    int found = -1;
+
+    for(int i = 0; i < credential_list->size && found < 0; i++)
+    {
+        if(credential_list->data[i].version != SNMP_VERSION_3)
+            continue;
+
+        sdsclear(output_str);
+        uint64_t deadline_us = stats_now_us() + SNMP_WALKER_REQUEST_DEADLINE_MS * 1000ULL;
+        snmp_network_walk_run_str(exec_path_str, &credential_list->data[i], host, &oid_str, deadline_us, &output_str);
+
+        /// "-One" lines start with the OID, errors like "Timeout: ..." or "snmpwalk: Unknown user name" don't
+        if(output_str[0] == '.' && strstr(output_str, " = ") != NULL)
+            found = i;
+    }
+
+    if(found < 0)
+    {
+        sds host_str = str_from_ipv4(host);
+        printf(KYELLOW "[WARNING] snmp_network_scan_run no SNMPv3 user is accepted by %s, using the first one\n" KNORMAL, host_str);
+        sdsfree(host_str);
+        found = snmp_credential_find_version(SNMP_VERSION_3);
+    }
+
+    sdsfree(output_str);
+    sdsfree(oid_str);
+
+    return found;
+}
+
 /**
  * @brief SNMP network scans
  * 
- * This functions scans the given network for SNMP devices on a specific community.
+ * This functions scans the given network for SNMP devices with all credentials of snmp_credential_get_list.
+ * All communities (and a SNMPv3 engine discovery probe if there are v3 credentials) are sent to a host back to back,
+ * so several credentials don't multiply the scan time. The credential each host answered to is saved with
+ * snmp_credential_set_host, if a host answers to several the first one in the list wins.
  * 
  * Limits of network scan
- * Max number of hosts :           65535
  * Max community length:           32
  * Max number of communities:      16384
  * 
  * @param exec_path_str The path fom the main applicatio
- * @param host_str The host or network IPv4 address with the subnet address as a sting (eg. 192.168.0.0/24)
- * @param community_str The SNMP community string to perform the scan on.
+ * @param target_path File with one target (address, network or first-last range) per line.
+ * @param wait_ms Milliseconds onesixtyone waits per host, 0 for its default.
+ * @param tail_ms Milliseconds onesixtyone waits for late responses after the last host, 0 for its default.
  * @param snmp_device_list This returns a list of IP4 devices that have been found.
- * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ * @return Status Code (0 = SUCESS, 1 = FAILURE if onesixtyone failed or has been killed, the found devices are returned anyway)
  */
-int snmp_network_scan_run(sds* exec_path_str, sds* host_str, sds* community_str, gll_t** snmp_device_list)
+static int snmp_network_scan_exec(sds* exec_path_str, const char* target_path, int wait_ms, int tail_ms, ipv4_vec_t* snmp_device_list)
 {
+    snmp_credential_vec_t *credential_list = snmp_credential_get_list();
+
+    /// Communities to probe, several are passed to onesixtyone in a file
+    const char *community_str = NULL;
+    char community_path[] = "/tmp/snmp_communities_XXXXXX";
+    int community_count = 0;
+    bool probe_v3 = false;
+
+    for(int i = 0; i < credential_list->size; i++)
+    {
+        snmp_credential_t *credential = &credential_list->data[i];
+
+        if(credential->version == SNMP_VERSION_3)
+            probe_v3 = true;
+        else if(snmp_credential_find_community(credential->community_str) == i)
+            community_count++;
+    }
+
+    if(community_count > 1)
+    {
+        int community_fd = mkstemp(community_path);
+        FILE *community_file = community_fd >= 0 ? fdopen(community_fd, "w") : NULL;
+
+        if(community_file == NULL)
+        {
+            printf(KRED "[ERROR] snmp_network_scan_run can't write the community file %s\n" KNORMAL, community_path);
+            return EXIT_FAILURE;
+        }
+
+        for(int i = 0; i < credential_list->size; i++)
+        {
+            if(credential_list->data[i].version != SNMP_VERSION_3 && snmp_credential_find_community(credential_list->data[i].community_str) == i)
+                fprintf(community_file, "%s\n", credential_list->data[i].community_str);
+        }
+
+        fclose(community_file);
+    }
+    else
+    {
+        int first = snmp_credential_find_version(SNMP_VERSION_2C);
+        if(first < 0)
+            first = snmp_credential_find_version(SNMP_VERSION_1);
+        community_str = first >= 0 ? credential_list->data[first].community_str : NULL;
+    }
+
+    /// The path and the arguments are built before the fork, the child must not allocate memory.
+    sds binary_path_str = sdsempty();
+    binary_path_str = sdscatsds(binary_path_str, *exec_path_str);
+    binary_path_str = sdscat(binary_path_str, "external/onesixtyone");
+
+    if(access(binary_path_str, X_OK) != 0)
+    {
+        printf(KRED "[ERROR] Can't run file: %s\n" KNORMAL, binary_path_str);
+        if(community_count > 1)
+            unlink(community_path);
+        sdsfree(binary_path_str);
+        return EXIT_FAILURE;
+    }
+
+    /// String "fix" is needed after -s parameter because onesixtyone needs an argument for it.
+    /// But the argument isn't used. -q is used to suppress sysDescr of device.
+    const char *argument_array[16];
+    char wait_str[16];
+    char tail_str[16];
+    int argument_count = 0;
+
+    argument_array[argument_count++] = binary_path_str;
+    argument_array[argument_count++] = "-s";
+    argument_array[argument_count++] = "fix";
+    argument_array[argument_count++] = "-q";
+    if(probe_v3)
+        argument_array[argument_count++] = "-3";
+    if(community_count > 1)
+    {
+        argument_array[argument_count++] = "-c";
+        argument_array[argument_count++] = community_path;
+    }
+    if(wait_ms > 0)
+    {
+        snprintf(wait_str, sizeof(wait_str), "%d", wait_ms);
+        argument_array[argument_count++] = "-w";
+        argument_array[argument_count++] = wait_str;
+    }
+    if(tail_ms > 0)
+    {
+        snprintf(tail_str, sizeof(tail_str), "%d", tail_ms);
+        argument_array[argument_count++] = "-t";
+        argument_array[argument_count++] = tail_str;
+    }
+    argument_array[argument_count++] = "-i";
+    argument_array[argument_count++] = target_path;
+    if(community_count <= 1)
+        argument_array[argument_count++] = community_str != NULL ? community_str : "public";
+    argument_array[argument_count] = NULL;
+
+    /// Walks started by the pipeline threads must not inherit the pipe, see snmp_network_walk_run_str
     int pipefd[2];
-    if(pipe(pipefd)== -1)
+    if(pipe2(pipefd, O_CLOEXEC)== -1)
     {
         printf(KRED "[ERROR] Pipe error\n" KNORMAL);
+        if(community_count > 1)
+            unlink(community_path);
+        sdsfree(binary_path_str);
+        return EXIT_FAILURE;
     }
 
     pid_t pid = fork();
-    
 
     if (pid == -1)
     {
         // error, failed to fork()
+        printf(KRED "[ERROR] snmp_network_scan_run can't fork\n" KNORMAL);
+        close(pipefd[PIPE_READ_END]);
+        close(pipefd[PIPE_WRITE_END]);
+        if(community_count > 1)
+            unlink(community_path);
+        sdsfree(binary_path_str);
         return EXIT_FAILURE;
     } 
     else if (pid > 0)
@@ -59,18 +223,44 @@ int snmp_network_scan_run(sds* exec_path_str, sds* host_str, sds* community_str,
 
         stream = fdopen(pipefd[PIPE_READ_END], "r");
 
+        /// A host shows up once for each credential it answers to
+        host_table_t *found_hosts = host_table_init();
+
         while ((nread = getline(&line, &len, stream)) != -1) 
         {
             sds line_str = sdsnewlen(line, nread);
 
-            line_str = sdstrim(line_str, " \t");
-
-            //parse ipv4 address:
-            ipv4_t ip = ipv4_from_str(&line_str);
-            ipv4_t *ip_ptr = malloc_ipv4(ip);
-            gll_push(*snmp_device_list, ip_ptr);
-            
-
+            line_str = sdstrim(line_str, " \t\n");
+
+            /// Line: <ip> [<community> | v3], without community if a single community has been probed
+            int count;
+            sds *tokens = sdssplitlen(line_str, sdslen(line_str), " ", 1, &count);
+
+            if(count >= 1 && sdslen(tokens[0]) > 0)
+            {
+                //parse ipv4 address:
+                ipv4_t ip = ipv4_from_str(&tokens[0]);
+
+                int credential = 0;
+                if(count >= 2 && strcmp(tokens[1], "v3") == 0)
+                    credential = snmp_credential_find_version(SNMP_VERSION_3);
+                else if(count >= 2)
+                    credential = snmp_credential_find_community(tokens[1]);
+                else if(community_str != NULL)
+                    credential = snmp_credential_find_community(community_str);
+
+                host_entry_t *entry = host_table_find(found_hosts, ip);
+                if(entry == NULL)
+                {
+                    entry = host_table_insert(found_hosts, ip);
+                    vec_push(snmp_device_list, ip);
+                }
+
+                if(credential >= 0 && (entry->credential < 0 || credential < entry->credential))
+                    entry->credential = credential;
+            }
+
+            sdsfreesplitres(tokens, count);
             sdsfree(line_str);
         }
 
@@ -78,72 +268,138 @@ int snmp_network_scan_run(sds* exec_path_str, sds* host_str, sds* community_str,
         {
             free(line);
         }
+        /// Closes the read end of the pipe
         fclose(stream);
 
-        close(pipefd[PIPE_READ_END]);
-
         waitpid(pid, &cstatus, 0);
 
-        return EXIT_SUCCESS;
+        /// Every v3 answer is bound to the first v3 user, with several users the one the host knows is looked up
+        int first_v3 = snmp_credential_find_version(SNMP_VERSION_3);
+        bool several_v3 = false;
+        for(int i = first_v3 + 1; first_v3 >= 0 && i < credential_list->size; i++)
+            several_v3 |= credential_list->data[i].version == SNMP_VERSION_3;
+
+        for(int i = 0; i < host_table_size(found_hosts); i++)
+        {
+            host_entry_t *entry = host_table_slot(found_hosts, i);
+
+            if(several_v3 && entry->credential == first_v3)
+                entry->credential = snmp_network_find_v3_user(exec_path_str, entry->host);
+
+            snmp_credential_set_host(entry->host, entry->credential);
+        }
+
+        host_table_destroy(found_hosts);
+
+        if(community_count > 1)
+            unlink(community_path);
+        sdsfree(binary_path_str);
+
+        /// A killed scan (e.g. SIGINT to the process group) found only part of the devices
+        return WIFEXITED(cstatus) && WEXITSTATUS(cstatus) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     }
     else 
     {
         // Child:
-        sds binary_path_str = sdsempty();
-        binary_path_str = sdscatsds(binary_path_str, *exec_path_str);
-        binary_path_str = sdscat(binary_path_str, "external/onesixtyone");
-        binary_path_str = sdsRemoveFreeSpace(binary_path_str);
-
         close(pipefd[PIPE_READ_END]);
 
         if (dup2(pipefd[PIPE_WRITE_END], STDOUT_FILENO) == -1)
         {
             perror("dup2");
-            return EXIT_FAILURE;
+            _exit(EXIT_FAILURE);
         }
 
         close(pipefd[PIPE_WRITE_END]);
 
-        if(access(binary_path_str, X_OK) != 0)
-        {
-            printf(KRED "[ERROR] Can't run file: %s" KNORMAL, binary_path_str);
-            return EXIT_FAILURE;
-        }
+        execv(binary_path_str, (char **)argument_array);
+        _exit(EXIT_FAILURE);
+    }
+}
 
-        /// String "fix" is needed after -s parameter because onesixtyone needs an argument for it.
-        /// But the argument isn't used. -q is used to suppress sysDescr of device.
-        execl(binary_path_str, binary_path_str, "-s", "fix", "-q", *host_str, *community_str, NULL);
+/**
+ * @brief SNMP network scan of a target set
+ *
+ * The ranges of the set are passed to onesixtyone, which streams the addresses, so the memory doesn't grow with
+ * the number of addresses.
+ *
+ * @param exec_path_str The path fom the main applicatio
+ * @param target_set The addresses to probe.
+ * @param wait_ms Milliseconds to wait per host, 0 for the default of onesixtyone. Higher values lower the probe rate.
+ * @param tail_ms Milliseconds to wait for late responses after the last host, 0 for the default of onesixtyone.
+ * @param snmp_device_list This returns a list of IP4 devices that have been found.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_network_scan_run(sds* exec_path_str, target_set_t* target_set, int wait_ms, int tail_ms, ipv4_vec_t* snmp_device_list)
+{
+    ipv4_range_vec_t *range_list = target_set_ranges(target_set);
+    if(range_list->size == 0)
+        return EXIT_SUCCESS;
+
+    char target_path[] = "/tmp/snmp_targets_XXXXXX";
+    int target_fd = mkstemp(target_path);
+    FILE *target_file = target_fd >= 0 ? fdopen(target_fd, "w") : NULL;
+
+    if(target_file == NULL)
+    {
+        printf(KRED "[ERROR] snmp_network_scan_run can't write the target file %s\n" KNORMAL, target_path);
         return EXIT_FAILURE;
     }
+
+    for(int i = 0; i < range_list->size; i++)
+    {
+        sds first_str = str_from_ipv4(range_list->data[i].first);
+        sds last_str = str_from_ipv4(range_list->data[i].last);
+        fprintf(target_file, "%s-%s\n", first_str, last_str);
+        sdsfree(first_str);
+        sdsfree(last_str);
+    }
+
+    fclose(target_file);
+
+    int status = snmp_network_scan_exec(exec_path_str, target_path, wait_ms, tail_ms, snmp_device_list);
+    unlink(target_path);
+
+    return status;
 }
 
 /**
  * @brief SNMP Walk for multiple OIDs on a single host
  * 
  * This function makes a snmp walk over multiple oids on a single host and returns the data as a string, which needs to be parsed.
+ * SNMPv1 and v2c hosts are walked in-process with several requests in flight (see snmp_walker_walk), SNMPv3 hosts
+ * and all hosts with a window of 0 with one snmpwalk process per OID.
+ * 
+ * The walk ends after the deadline of the host (snmp_walker_deadline), however the agent behaves. The rows read until
+ * then are returned, each OID which wasn't read completely gets a line "<OID> = Incomplete: <reason>".
  * 
  * @param exec_path_str The path fom the main application
- * @param community_str The SNMP community string used to make the SNMP walk.
+ * @param credential The credential used to make the SNMP walk.
  * @param host_ip The IPv4 address of the host, to make the SNMP walk on.
  * @param oid_list A string list which can contain multiple OIDs to perform the SNMP walk on.
  * @param return_str The output returned from multiple SNMP walks as a string.
- * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ * @return Status Code (0 = SUCESS, 1 = FAILURE if the walk was cut off)
  */
-int snmp_network_walk_batch_run_str(sds* exec_path_str, sds* community_str, ipv4_t host_ip,  gll_t** oid_list, sds* return_str)
+int snmp_network_walk_batch_run_str(sds* exec_path_str, const snmp_credential_t* credential, ipv4_t host_ip,  oid_vec_t* oid_list, sds* return_str)
 {
-    gll_t* oid_list_ptr = *oid_list;
-    gll_node_t* current = oid_list_ptr->first;
+    int status_code = EXIT_SUCCESS;
 
-    int status_code;
+    if(credential->version != SNMP_VERSION_3 && snmp_walker_window() > 0)
+        return snmp_walker_walk(credential, host_ip, oid_list, return_str);
 
-    while(current != NULL) {
-        sds oid_str = (sds) current->data;
-        
-        status_code = snmp_network_walk_run_str(exec_path_str, community_str, host_ip, &oid_str, return_str);
-        if(status_code != EXIT_SUCCESS)
-            break;
+    /// All OIDs share the deadline of the host
+    int deadline_s = snmp_walker_deadline(host_ip);
+    uint64_t deadline_us = deadline_s > 0 ? stats_now_us() + deadline_s * 1000000ULL : 0;
 
-        current = current->next;
+    for(int i = 0; i < oid_list->size; i++)
+    {
+        if(status_code == EXIT_SUCCESS)
+            status_code = snmp_network_walk_run_str(exec_path_str, credential, host_ip, &oid_list->data[i], deadline_us, return_str);
+
+        if(status_code != EXIT_SUCCESS)
+        {
+            bool deadline_exceeded = deadline_us > 0 && stats_now_us() >= deadline_us;
+            *return_str = sdscatprintf(*return_str, "%s = " SNMP_OID_INCOMPLETE ": %s\n", oid_list->data[i], deadline_exceeded ? "Deadline Exceeded" : "Walk Failed");
+        }
     }
 
     return status_code;
@@ -155,17 +411,22 @@ int snmp_network_walk_batch_run_str(sds* exec_path_str, sds* community_str, ipv4
  * This function makes a snmp walk over a single oid on a single host and returns the data as a string, which needs to be parsed.
  * 
  * @param exec_path_str The path from the main application
- * @param community_str The SNMP community string used to make the SNMP walk.
+ * @param credential The credential used to make the SNMP walk.
  * @param host_ip The IPv4 address of the host, to make the SNMP walk on.
  * @param oid_str The oid to start the walk on as a sds sting.
+ * @param deadline_us stats_now_us time at which snmpwalk is killed, 0 for no limit. The lines read until then are kept.
  * @param return_str The output returned from the SNMP walk as a string.
- * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ * @return Status Code (0 = SUCESS, 1 = FAILURE if snmpwalk couldn't be started or has been killed)
  */
 
-int snmp_network_walk_run_str(sds* exec_path_str, sds* community_str, ipv4_t host_ip,  sds* oid_str, sds* return_str)
+int snmp_network_walk_run_str(sds* exec_path_str, const snmp_credential_t* credential, ipv4_t host_ip,  sds* oid_str, uint64_t deadline_us, sds* return_str)
 {
+    /// The walks run in several pipeline threads, other children must not inherit the pipe.
+    /// Otherwise the read end only sees EOF after all of them have exited.
+    uint64_t start_us = stats_now_us();
+
     int pipefd[2];
-    if(pipe(pipefd)== -1)
+    if(pipe2(pipefd, O_CLOEXEC)== -1)
     {
         printf(KRED "[ERROR] Pipe error\n" KNORMAL);
         return EXIT_FAILURE;
@@ -184,34 +445,62 @@ int snmp_network_walk_run_str(sds* exec_path_str, sds* community_str, ipv4_t hos
         close(pipefd[PIPE_WRITE_END]);
 
         int cstatus;
+        int status = EXIT_SUCCESS;
+        size_t start_len = sdslen(*return_str);
+        char buffer[4096];
+        struct pollfd poll_fd = { pipefd[PIPE_READ_END], POLLIN, 0 };
 
-        FILE *stream;
-        char *line = NULL;
-        size_t len = 0;
-        ssize_t nread;
-
-        stream = fdopen(pipefd[PIPE_READ_END], "r");
-
-        while ((nread = getline(&line, &len, stream)) != -1) 
+        while(true)
         {
-            sds line_str = sdsnewlen(line, nread);
-            *return_str = sdscat(*return_str, line_str);       
-
-            sdsfree(line_str);
+            int timeout_ms = -1;
+            if(deadline_us > 0)
+            {
+                uint64_t now_us = stats_now_us();
+                if(now_us >= deadline_us)
+                {
+                    status = EXIT_FAILURE;
+                    break;
+                }
+                timeout_ms = (int)((deadline_us - now_us + 999) / 1000);
+            }
+
+            /// The deadline is checked again after a timeout
+            int ready = poll(&poll_fd, 1, timeout_ms);
+            if(ready == 0 || (ready < 0 && errno == EINTR))
+                continue;
+
+            ssize_t nread = ready > 0 ? read(pipefd[PIPE_READ_END], buffer, sizeof(buffer)) : -1;
+            if(nread < 0 && errno == EINTR)
+                continue;
+            if(nread < 0)
+                status = EXIT_FAILURE;
+            if(nread <= 0)
+                break;
+
+            *return_str = sdscatlen(*return_str, buffer, nread);
+            stats_count(STATS_COUNTER_BYTES_RECEIVED, nread);
         }
 
-        if(line != NULL)
+        close(pipefd[PIPE_READ_END]);
+
+        /// A hung snmpwalk doesn't block the thread, only its complete lines are kept
+        if(status != EXIT_SUCCESS)
         {
-            free(line);
+            kill(pid, SIGKILL);
+
+            const char *line_end = memrchr(*return_str + start_len, '\n', sdslen(*return_str) - start_len);
+            size_t keep_len = line_end != NULL ? (size_t)(line_end - *return_str) + 1 : start_len;
+            if(keep_len > 0)
+                sdsrange(*return_str, 0, (ssize_t)keep_len - 1);
+            else
+                sdsclear(*return_str);
         }
 
-        fclose(stream);
-
-        close(pipefd[PIPE_READ_END]);
-
         waitpid(pid, &cstatus, 0);
 
-        return EXIT_SUCCESS;
+        stats_record(STATS_PHASE_WALK_OID, stats_now_us() - start_us);
+
+        return status;
     }
     else 
     {
@@ -226,13 +515,13 @@ int snmp_network_walk_run_str(sds* exec_path_str, sds* community_str, ipv4_t hos
         if (dup2(pipefd[PIPE_WRITE_END], STDOUT_FILENO) == -1)
         {
             perror("dup2");
-            return EXIT_FAILURE;
+            _exit(EXIT_FAILURE);
         }
 
         if (dup2(pipefd[PIPE_WRITE_END], STDERR_FILENO) == -1)
         {
             perror("dup2");
-            return EXIT_FAILURE;
+            _exit(EXIT_FAILURE);
         }
 
         close(pipefd[PIPE_WRITE_END]);
@@ -240,29 +529,74 @@ int snmp_network_walk_run_str(sds* exec_path_str, sds* community_str, ipv4_t hos
         if(access(binary_path_str, X_OK) != 0)
         {
             printf("[ERROR] Can't run file: %s", binary_path_str);
-            return EXIT_FAILURE;
+            fflush(stdout);
+            _exit(EXIT_FAILURE);
         }
 
         sds host_ip_str = str_from_ipv4(host_ip);
-        execl(binary_path_str, binary_path_str, "-c", *community_str, "-v", "2c", "-One", host_ip_str, *oid_str, NULL);
-        return EXIT_FAILURE;
+        const char *argument_array[20];
+        int argument_count = 0;
+
+        argument_array[argument_count++] = binary_path_str;
+
+        if(credential->version == SNMP_VERSION_3)
+        {
+            argument_array[argument_count++] = "-v";
+            argument_array[argument_count++] = "3";
+            argument_array[argument_count++] = "-u";
+            argument_array[argument_count++] = credential->user_str;
+            argument_array[argument_count++] = "-l";
+            argument_array[argument_count++] = credential->security_level_str;
+
+            if(sdslen(credential->auth_protocol_str) > 0)
+            {
+                argument_array[argument_count++] = "-a";
+                argument_array[argument_count++] = credential->auth_protocol_str;
+                argument_array[argument_count++] = "-A";
+                argument_array[argument_count++] = credential->auth_password_str;
+            }
+
+            if(sdslen(credential->priv_protocol_str) > 0)
+            {
+                argument_array[argument_count++] = "-x";
+                argument_array[argument_count++] = credential->priv_protocol_str;
+                argument_array[argument_count++] = "-X";
+                argument_array[argument_count++] = credential->priv_password_str;
+            }
+        }
+        else
+        {
+            argument_array[argument_count++] = "-c";
+            argument_array[argument_count++] = credential->community_str;
+            argument_array[argument_count++] = "-v";
+            argument_array[argument_count++] = credential->version == SNMP_VERSION_1 ? "1" : "2c";
+        }
+
+        argument_array[argument_count++] = "-One";
+        argument_array[argument_count++] = host_ip_str;
+        argument_array[argument_count++] = *oid_str;
+        argument_array[argument_count] = NULL;
+
+        execv(binary_path_str, (char **)argument_array);
+        _exit(EXIT_FAILURE);
     }
 }
 
 #ifdef DEBUG
 /**
- * @brief prints snmp device ip from list
+ * @brief prints snmp device ips from list
  * 
- * This function only works in debug mode, prints the ip address of a snmp_device_list element, designed to be used with gll_each.
+ * This function only works in debug mode, prints the ip address of each snmp_device_list element.
  * 
- * @param element 
+ * @param snmp_device_list list of found devices.
  */
-void snmp_network_print_snmp_device_list_debug(void* element)
+void snmp_network_print_snmp_device_list_debug(ipv4_vec_t* snmp_device_list)
 {
-        ipv4_t *ip;
-        ip = (ipv4_t*) element;
-        sds ip_str = str_from_ipv4(*ip);
+    for(int i = 0; i < snmp_device_list->size; i++)
+    {
+        sds ip_str = str_from_ipv4(snmp_device_list->data[i]);
         PRINT_DEBUG("%s\n", ip_str);
         sdsfree(ip_str);
+    }
 }
 #endif
\ No newline at end of file
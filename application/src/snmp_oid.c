@@ -1,13 +1,12 @@
 #include <stdlib.h>
 
 #include "snmp_oid.h"
-#include "lib/sds.h"
 
 /// This List contains OID strings for the init and the periodic phase.
-static gll_t* oid_init_list;
+static oid_vec_t oid_init_list;
 
 /// This list contains OID strings for the peridoic phase.
-static gll_t* oid_periodic_list;
+static oid_vec_t oid_periodic_list;
 
 /**
  * @brief Generates OID lists
@@ -16,47 +15,49 @@ static gll_t* oid_periodic_list;
  */
 void snmp_oid_generate_oid_lists(void)
 {
-    oid_init_list = gll_init();
-    oid_periodic_list = gll_init();
+    vec_init(&oid_init_list);
+    vec_init(&oid_periodic_list);
 
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpLocSysName));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpLocSysCapSupported));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpLocSysCapEnabled));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpLocPortIdSubtype));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpLocPortId));
-    gll_push(oid_init_list, sdsnew(IFMIB_ifIndex));
-    gll_push(oid_init_list, sdsnew(IFMIB_ifType));
-    gll_push(oid_init_list, sdsnew(IFMIB_ifSpeed));
-    gll_push(oid_init_list, sdsnew(IFMIB_ifPhysAddress));
-    gll_push(oid_init_list, sdsnew(IFMIB_ifOperStatus));
-    gll_push(oid_init_list, sdsnew(IFMIB_ifName));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpRemChassisIdSubtype));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpRemChassisId));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpRemPortIdSubtype));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpRemPortId));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpRemSysName));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpRemSysCapSupported));
-    gll_push(oid_init_list, sdsnew(LLDPMIB_lldpRemSysCapEnabled));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpLocSysName));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpLocSysCapSupported));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpLocSysCapEnabled));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpLocPortIdSubtype));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpLocPortId));
+    vec_push(&oid_init_list, sdsnew(IFMIB_ifIndex));
+    vec_push(&oid_init_list, sdsnew(IFMIB_ifType));
+    vec_push(&oid_init_list, sdsnew(IFMIB_ifSpeed));
+    vec_push(&oid_init_list, sdsnew(IFMIB_ifPhysAddress));
+    vec_push(&oid_init_list, sdsnew(IFMIB_ifOperStatus));
+    vec_push(&oid_init_list, sdsnew(IFMIB_ifName));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpRemChassisIdSubtype));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpRemChassisId));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpRemPortIdSubtype));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpRemPortId));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpRemSysName));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpRemSysCapSupported));
+    vec_push(&oid_init_list, sdsnew(LLDPMIB_lldpRemSysCapEnabled));
 
-    gll_push(oid_periodic_list, sdsnew(IFMIB_ifIndex));
-    gll_push(oid_periodic_list, sdsnew(IFMIB_ifType));
-    gll_push(oid_periodic_list, sdsnew(IFMIB_ifSpeed));
-    gll_push(oid_periodic_list, sdsnew(IFMIB_ifPhysAddress));
-    gll_push(oid_periodic_list, sdsnew(IFMIB_ifOperStatus));
-    gll_push(oid_periodic_list, sdsnew(IFMIB_ifName));
-    gll_push(oid_periodic_list, sdsnew(LLDPMIB_lldpRemChassisIdSubtype));
-    gll_push(oid_periodic_list, sdsnew(LLDPMIB_lldpRemChassisId));
-    gll_push(oid_periodic_list, sdsnew(LLDPMIB_lldpRemPortIdSubtype));
-    gll_push(oid_periodic_list, sdsnew(LLDPMIB_lldpRemPortId));
-    gll_push(oid_periodic_list, sdsnew(LLDPMIB_lldpRemSysName));
-    gll_push(oid_periodic_list, sdsnew(LLDPMIB_lldpRemSysCapSupported));
-    gll_push(oid_periodic_list, sdsnew(LLDPMIB_lldpRemSysCapEnabled));
+    vec_push(&oid_periodic_list, sdsnew(IFMIB_ifIndex));
+    vec_push(&oid_periodic_list, sdsnew(IFMIB_ifType));
+    vec_push(&oid_periodic_list, sdsnew(IFMIB_ifSpeed));
+    vec_push(&oid_periodic_list, sdsnew(IFMIB_ifPhysAddress));
+    vec_push(&oid_periodic_list, sdsnew(IFMIB_ifOperStatus));
+    vec_push(&oid_periodic_list, sdsnew(IFMIB_ifName));
+    vec_push(&oid_periodic_list, sdsnew(LLDPMIB_lldpRemChassisIdSubtype));
+    vec_push(&oid_periodic_list, sdsnew(LLDPMIB_lldpRemChassisId));
+    vec_push(&oid_periodic_list, sdsnew(LLDPMIB_lldpRemPortIdSubtype));
+    vec_push(&oid_periodic_list, sdsnew(LLDPMIB_lldpRemPortId));
+    vec_push(&oid_periodic_list, sdsnew(LLDPMIB_lldpRemSysName));
+    vec_push(&oid_periodic_list, sdsnew(LLDPMIB_lldpRemSysCapSupported));
+    vec_push(&oid_periodic_list, sdsnew(LLDPMIB_lldpRemSysCapEnabled));
 }
 
-void free_sds_list_element(void* sds_ptr)
+static void free_oid_list(oid_vec_t *oid_list)
 {
-    sds string = (sds)sds_ptr;
-    sdsfree(string);
+    for(int i = 0; i < oid_list->size; i++)
+        sdsfree(oid_list->data[i]);
+
+    vec_free(oid_list);
 }
 
 /**
@@ -66,11 +67,8 @@ void free_sds_list_element(void* sds_ptr)
  */
 void snmp_oid_free_oid_lists(void)
 {
-    gll_each(oid_init_list, &free_sds_list_element);
-    gll_destroy(oid_init_list);
-
-    gll_each(oid_periodic_list, &free_sds_list_element);
-    gll_destroy(oid_periodic_list);
+    free_oid_list(&oid_init_list);
+    free_oid_list(&oid_periodic_list);
 }
 
 /**
@@ -78,7 +76,7 @@ void snmp_oid_free_oid_lists(void)
  * 
  * @return List with OIDs for init phase.
  */
-gll_t** snmp_oid_get_oid_init_list(void)
+oid_vec_t* snmp_oid_get_oid_init_list(void)
 {
     return &oid_init_list;
 }
@@ -88,7 +86,30 @@ gll_t** snmp_oid_get_oid_init_list(void)
  * 
  * @return List with OIDs for init phase.
  */
-gll_t** snmp_oid_get_oid_periodic_list(void)
+oid_vec_t* snmp_oid_get_oid_periodic_list(void)
 {
     return &oid_periodic_list;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Checks if an ifType (IANAifType-MIB) is an Ethernet-like interface, which can have a LLDP neighbour.
+ * 
+ * VLAN interfaces, loopbacks, tunnels, link aggregations and CPU ports aren't Ethernet-like.
+ * 
+ * @param if_type value of ifType.
+ * @return true, if the interface is Ethernet-like.
+ */
+bool snmp_oid_is_ethernet_if_type(int if_type)
+{
+    switch(if_type)
+    {
+        case 6:   /* ethernetCsmacd */
+        case 7:   /* iso88023Csmacd */
+        case 62:  /* fastEther */
+        case 69:  /* fastEtherFX */
+        case 117: /* gigabitEthernet */
+            return true;
+    }
+
+    return false;
+}
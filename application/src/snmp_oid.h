@@ -1,7 +1,15 @@
 #ifndef SNMP_OID_H
 #define SNMP_OID_H
 
-#include "lib/gll.h"
+#include <stdbool.h>
+
+#include "lib/sds.h"
+
+#include "vec.h"
+
+#define SNMPv2MIB_sysUpTime ".1.3.6.1.2.1.1.3"
+
+#define LLDPMIB_lldpStatsRemTablesLastChangeTime ".1.0.8802.1.1.2.1.2.1"
 
 #define LLDPMIB_lldpLoc ".1.0.8802.1.1.2.1.3"
 #define LLDPMIB_lldpLocSysName ".1.0.8802.1.1.2.1.3.3"
@@ -18,6 +26,7 @@
 #define IFMIB_ifPhysAddress ".1.3.6.1.2.1.2.2.1.6"
 #define IFMIB_ifOperStatus ".1.3.6.1.2.1.2.2.1.8"
 #define IFMIB_ifName ".1.3.6.1.2.1.31.1.1.1.1"
+#define IFMIB_ifTableLastChange ".1.3.6.1.2.1.31.1.5"
 
 #define LLDPMIB_lldpRem ".1.0.8802.1.1.2.1.4"
 //#define LLDPMIB_lldpRemLocalPortNum ".1.0.8802.1.1.2.1.4.1.1.2"
@@ -31,10 +40,19 @@
 #define LLDPMIB_lldpRemSysCapSupported ".1.0.8802.1.1.2.1.4.1.1.11"
 #define LLDPMIB_lldpRemSysCapEnabled ".1.0.8802.1.1.2.1.4.1.1.12"
 
+/// Type of the line "<OID> = Incomplete: <reason>" which follows the rows of an OID whose walk was cut off by a
+/// timeout or a deadline, the rows of the last walk which are missing may still exist.
+#define SNMP_OID_INCOMPLETE "Incomplete"
+
+/// List of OID strings
+typedef vec_t(sds) oid_vec_t;
+
 void snmp_oid_generate_oid_lists(void);
 void snmp_oid_free_oid_lists(void);
 
-gll_t** snmp_oid_get_oid_init_list(void);
-gll_t** snmp_oid_get_oid_periodic_list(void);
+oid_vec_t* snmp_oid_get_oid_init_list(void);
+oid_vec_t* snmp_oid_get_oid_periodic_list(void);
+
+bool snmp_oid_is_ethernet_if_type(int if_type);
 
 #endif
\ No newline at end of file
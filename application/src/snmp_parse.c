@@ -17,14 +17,11 @@
  * @param oid_list A list with OID strings to check.
  * @return Status (true = Success, false = Failure)
  */
-bool snmp_parse_check_from_list(sds *line_str, gll_t** oid_list)
+bool snmp_parse_check_from_list(sds *line_str, oid_vec_t* oid_list)
 {
-    gll_t* oid_list_ptr = *oid_list;
-    gll_node_t* current = oid_list_ptr->first;
-
-    while(current != NULL)
+    for(int i = 0; i < oid_list->size; i++)
     {
-        sds oid_str = (sds) current->data;
+        sds oid_str = oid_list->data[i];
         
         sds oid_search_dot_str = sdsdup(oid_str);
         oid_search_dot_str = sdscat(oid_search_dot_str, ".");
@@ -44,46 +41,42 @@ bool snmp_parse_check_from_list(sds *line_str, gll_t** oid_list)
 
         sdsfree(oid_search_space_str);
         sdsfree(oid_search_dot_str);
-
-        current = current->next;
     }
 
     return true;
 }
 
 /**
- * @brief Checks if a line contain a OID from the list
+ * @brief Checks if a line starts with a OID from the list
  * 
- * This function checks id a line contains a OID from a list with OID strings, if a OID has been found it will be returned via parameter.
+ * This function checks id a line starts with a OID from a list with OID strings, if a OID has been found it will be returned via parameter.
  * 
- * @param line_str A string which should be checked for a OID.
+ * @param line_ptr A line which should be checked for a OID, doesn't need to be null terminated.
+ * @param line_len The length of the line.
  * @param oid_list A list of OID strings to compare with.
- * @param found_oid_str The OID which has been found, returns NULL if non has been found.
+ * @param found_oid_str The OID which has been found, points into the OID list.
  * @return Status (true = Found a OID, false = Didn't found a OID)
  */
-bool str_contains_oid_from_list(sds *line_str, gll_t** oid_list, sds* found_oid_str)
+static bool str_contains_oid_from_list(const char *line_ptr, size_t line_len, oid_vec_t* oid_list, sds* found_oid_str)
 {
     int contains = 0;
 
-    gll_t* oid_list_ptr = *oid_list;
-    gll_node_t* current = oid_list_ptr->first;
-
-    while(current != NULL)
+    for(int i = 0; i < oid_list->size; i++)
     {
-        sds oid_str = (sds) current->data;
-        if (STR_CONTAINS(*line_str, oid_str))
+        sds oid_str = oid_list->data[i];
+        size_t oid_len = sdslen(oid_str);
+
+        if (line_len > oid_len && memcmp(line_ptr, oid_str, oid_len) == 0)
         {
-            sds tmp_line_str = *line_str;
-            if(tmp_line_str[strlen(oid_str)] == '.' || tmp_line_str[strlen(oid_str)] == ' ')
+            if(line_ptr[oid_len] == '.' || line_ptr[oid_len] == ' ')
             {
                 if(contains == 0)
                 {
-                    *found_oid_str = sdsdup(oid_str);
+                    *found_oid_str = oid_str;
                 }
                 contains++;
             }
         }
-        current = current->next;
     }
 
     if(contains > 1)
@@ -94,6 +87,18 @@ bool str_contains_oid_from_list(sds *line_str, gll_t** oid_list, sds* found_oid_
     return (contains > 0);
 }
 
+/**
+ * @brief Removes all characters contained in cset from both ends of the span [start, end).
+ */
+static void snmp_parse_trim_span(const char **start, const char **end, const char *cset)
+{
+    while(*start < *end && strchr(cset, **start) != NULL)
+        (*start)++;
+
+    while(*end > *start && strchr(cset, *(*end - 1)) != NULL)
+        (*end)--;
+}
+
 /**
  * @brief Parse OIDs to Tuples with a OID List
  * 
@@ -101,112 +106,71 @@ bool str_contains_oid_from_list(sds *line_str, gll_t** oid_list, sds* found_oid_
  * to a Tuple (oid_string_tuple_t) and adds it to a list. The tuple contains following data:
  * OID, OID Sub ID, Data Type, Type.
  * 
+ * The tuples and their strings are allocated from the given arena, they are released all at once with the arena.
+ * 
  * @param line_str The output of a SNMP walk.
  * @param host_ip The IPv4 of the host, that was the target of the SNMP walk.
  * @param oid_list The list of OIDs to find in the line_str.
- * @param oid_string_tuple_list Outputs a gll containing the found OID in a Tuple.
+ * @param arena The arena to allocate the tuples from.
+ * @param oid_string_tuple_list Outputs a list containing the found OID in a Tuple.
  */
-void snmp_parse_from_list(sds* line_str, ipv4_t host_ip, gll_t** oid_list, gll_t** oid_string_tuple_list)
+void snmp_parse_from_list(sds* line_str, ipv4_t host_ip, oid_vec_t* oid_list, arena_t *arena, oid_string_tuple_vec_t* oid_string_tuple_list)
 {
-    gll_t* string_tupel_list = *oid_string_tuple_list;
+    const char *data_ptr = *line_str;
+    const char *data_end_ptr = *line_str + sdslen(*line_str);
 
-    sds *lines;
-    int count, i;
-    lines = sdssplitlen(*line_str, sdslen(*line_str), "\n", 1, &count);
-
-    for (i = 0; i < count; i++)
+    while (data_ptr < data_end_ptr)
     {
-        sds line_str = lines[i];
-        sds found_oid_str = NULL;
-        if(str_contains_oid_from_list(&line_str, oid_list, &found_oid_str))
-        {
-            sds oid_str = sdsdup(found_oid_str);
-            sds oid_id_str;
-            sds data_type_str;
-            sds data_str;
+        const char *line_ptr = data_ptr;
+        const char *line_end_ptr = memchr(line_ptr, '\n', data_end_ptr - line_ptr);
+        if(line_end_ptr == NULL)
+            line_end_ptr = data_end_ptr;
 
-            char* type_start_ptr = strchr(line_str, '=');
-            char* data_start_ptr = strchr(type_start_ptr, ':');
-            char* oid_id_start_ptr = line_str + sdslen(found_oid_str);
+        data_ptr = line_end_ptr + 1;
 
-            char* oid_id_dot_ptr = strchr(oid_id_start_ptr, '.');
-            if(oid_id_dot_ptr != NULL)
-            {
-                oid_id_dot_ptr = strchr(oid_id_dot_ptr+1, '.');
-            }
+        sds found_oid_str = NULL;
+        if(str_contains_oid_from_list(line_ptr, line_end_ptr - line_ptr, oid_list, &found_oid_str))
+        {
+            const char* type_start_ptr = memchr(line_ptr, '=', line_end_ptr - line_ptr);
+            const char* data_start_ptr = NULL;
 
-            //TODO: remove this if unused
-            //char* oid_id_space_ptr = strchr(oid_id_start_ptr, ' ');
-            
+            if(type_start_ptr != NULL)
+                data_start_ptr = memchr(type_start_ptr, ':', line_end_ptr - type_start_ptr);
 
             if(data_start_ptr == NULL || type_start_ptr == NULL )
             {
                 sds host_ip_str = str_from_ipv4(host_ip);
-                printf(KYELLOW "[WARNING][%s] Line doesn't contain expected format: \"%s\".\n" KNORMAL, host_ip_str, line_str);
+                printf(KYELLOW "[WARNING][%s] Line doesn't contain expected format: \"%.*s\".\n" KNORMAL, host_ip_str, (int)(line_end_ptr - line_ptr), line_ptr);
 
                 sdsfree(host_ip_str);
-                sdsfree(oid_str);
-
-                if(found_oid_str != NULL)
-                    sdsfree(found_oid_str);
 
                 continue;
             }
 
-            size_t oid_len = sdslen(found_oid_str);
-            size_t data_len = strlen(data_start_ptr);
-            size_t type_len = strlen(type_start_ptr) - data_len;
-            size_t oid_id_len = strlen(line_str) - oid_len - data_len - type_len;
-
-            oid_id_str = sdsnewlen(oid_id_start_ptr, oid_id_len);
-            data_type_str = sdsnewlen(type_start_ptr, type_len);
-            data_str = sdsnewlen(data_start_ptr, data_len);
+            const char *oid_id_start_ptr = line_ptr + sdslen(found_oid_str);
+            const char *oid_id_end_ptr = type_start_ptr;
+            const char *type_end_ptr = data_start_ptr;
+            const char *data_end_ptr = line_end_ptr;
 
-            oid_id_str = sdstrim(oid_id_str, ". ");
-            data_type_str = sdstrim(data_type_str, "= ");
-            data_str = sdstrim(data_str, ": \"");
+            snmp_parse_trim_span(&oid_id_start_ptr, &oid_id_end_ptr, ". ");
+            snmp_parse_trim_span(&type_start_ptr, &type_end_ptr, "= ");
+            snmp_parse_trim_span(&data_start_ptr, &data_end_ptr, ": \"");
 
-            sdsfree(found_oid_str);
-
-            oid_string_tuple_t* oid_struct = malloc(sizeof(oid_string_tuple_t));
+            oid_string_tuple_t* oid_struct = vec_push_slot(oid_string_tuple_list);
             
-            oid_struct->oid_str_ptr = oid_str;
-            oid_struct->oid_id_str_ptr = oid_id_str;
-            oid_struct->data_type_str_ptr = data_type_str;
-            oid_struct->data_str_ptr = data_str;
-
-            gll_push(string_tupel_list, oid_struct);
+            oid_struct->oid_str_ptr = arena_sdsnewlen(arena, found_oid_str, sdslen(found_oid_str));
+            oid_struct->oid_id_str_ptr = arena_sdsnewlen(arena, oid_id_start_ptr, oid_id_end_ptr - oid_id_start_ptr);
+            oid_struct->data_type_str_ptr = arena_sdsnewlen(arena, type_start_ptr, type_end_ptr - type_start_ptr);
+            oid_struct->data_str_ptr = arena_sdsnewlen(arena, data_start_ptr, data_end_ptr - data_start_ptr);
         }
     }
-    
-    sdsfreesplitres(lines,count);
-}
-
-/**
- * @brief Cleanup oid_string_tuple_t
- * 
- * This function can be used to free a allocated oid_string_tuple_t, can be used with gll_each.
- * 
- * @param element a oid_string_tuple_t that has been allocated before.
- */
-void snmp_parse_free_oid_string_tuple_t(void *oid_string_tuple)
-{
-
-    oid_string_tuple_t *tuple;
-    tuple = (oid_string_tuple_t*)oid_string_tuple;
-    
-    sdsfree(tuple->data_str_ptr);
-    sdsfree(tuple->data_type_str_ptr);
-    sdsfree(tuple->oid_id_str_ptr);
-    sdsfree(tuple->oid_str_ptr);
-
-    free(oid_string_tuple);
 }
 
 /**
  * @brief Cleanup host_data_pair_t
  * 
  * This function can be used to free a allocated host_data_pair_t, can be used with gll_each.
+ * The arena of the pair is reset and kept for the next walk.
  * 
  * @param host_data_pair a host_data_pair_t that has been allocated before.
  */
@@ -215,8 +179,9 @@ void snmp_parse_free_host_data_pair_t(void *host_data_pair)
     host_data_pair_t *pair_ptr;
     pair_ptr = (host_data_pair_t*)host_data_pair;
 
-    gll_each(pair_ptr->oid_string_tuple_list, &snmp_parse_free_oid_string_tuple_t);
-    gll_destroy(pair_ptr->oid_string_tuple_list);
+    /// The strings of the tuples are released all at once with their arena
+    vec_free(&pair_ptr->oid_string_tuple_list);
+    arena_pool_put(pair_ptr->arena);
 
     free(host_data_pair);
 }
@@ -231,36 +196,57 @@ void snmp_parse_free_host_data_pair_t(void *host_data_pair)
  * @return true, if tuple found
  * @return false, if tuple not found
  */
-static bool snmp_get_oid_string_tuple(const char *oid, const char* oid_id, gll_t *oid_string_tuple_list, oid_string_tuple_t *tuple)
+static bool snmp_get_oid_string_tuple(const char *oid, const char* oid_id, oid_string_tuple_vec_t *oid_string_tuple_list, oid_string_tuple_t *tuple)
 {
     tuple->oid_str_ptr = sdsempty();
     tuple->oid_id_str_ptr = sdsempty();
     tuple->data_type_str_ptr = sdsempty();
     tuple->data_str_ptr = sdsempty();
 
-    gll_node_t *current = oid_string_tuple_list->first;
-
     for(int i = 0; i < oid_string_tuple_list->size; i++)
     {
-        oid_string_tuple_t* data = (oid_string_tuple_t*)current->data;
+        oid_string_tuple_t* data = &oid_string_tuple_list->data[i];
 
         if(STR_EQUAL(oid, data->oid_str_ptr) && STR_EQUAL(oid_id, data->oid_id_str_ptr))
         {
-            
-            tuple->oid_str_ptr = sdsdup(data->oid_str_ptr);
-            tuple->oid_id_str_ptr = sdsdup(data->oid_id_str_ptr);
-            tuple->data_type_str_ptr = sdsdup(data->data_type_str_ptr);
-            tuple->data_str_ptr = sdsdup(data->data_str_ptr);
+            tuple->oid_str_ptr = sdscpylen(tuple->oid_str_ptr, data->oid_str_ptr, sdslen(data->oid_str_ptr));
+            tuple->oid_id_str_ptr = sdscpylen(tuple->oid_id_str_ptr, data->oid_id_str_ptr, sdslen(data->oid_id_str_ptr));
+            tuple->data_type_str_ptr = sdscpylen(tuple->data_type_str_ptr, data->data_type_str_ptr, sdslen(data->data_type_str_ptr));
+            tuple->data_str_ptr = sdscpylen(tuple->data_str_ptr, data->data_str_ptr, sdslen(data->data_str_ptr));
 
             break;
         }
-
-        current = current->next;
     }
 
     return sdslen(tuple->oid_str_ptr) > 0;
 }
 
+/**
+ * @brief checks the ifType of an interface, only Ethernet-like interfaces become ports
+ * 
+ * @param if_index interface number
+ * @param oid_string_tuple_list list of tuples to search in
+ * @return true, if the interface is Ethernet-like or its ifType is unknown
+ * @return false, if the interface is e.g. a VLAN interface, loopback or tunnel
+ */
+static bool snmp_is_ethernet_interface(int if_index, oid_string_tuple_vec_t *oid_string_tuple_list)
+{
+    bool ethernet = true;
+    sds if_index_str = sdscatfmt(sdsempty(), "%i", if_index);
+
+    oid_string_tuple_t type_tuple;
+    if(snmp_get_oid_string_tuple(IFMIB_ifType, if_index_str, oid_string_tuple_list, &type_tuple) && STR_EQUAL(type_tuple.data_type_str_ptr, "INTEGER"))
+        ethernet = snmp_oid_is_ethernet_if_type(strtol(type_tuple.data_str_ptr, NULL, 10));
+
+    sdsfree(type_tuple.oid_str_ptr);
+    sdsfree(type_tuple.oid_id_str_ptr);
+    sdsfree(type_tuple.data_type_str_ptr);
+    sdsfree(type_tuple.data_str_ptr);
+    sdsfree(if_index_str);
+
+    return ethernet;
+}
+
 /**
  * @brief converts mac addresses from hex string to string
  * 
@@ -321,6 +307,21 @@ static sds parse_port_number_from_oid_id(sds oid_id_str)
     return oid_id_str;
 }
 
+/**
+ * @brief parses the local interface number from a lldpRem oid sub id, the sub id itself stays untouched
+ * 
+ * @param oid_id_str the oid sub id to parse from
+ * @return interface number
+ */
+static int snmp_parse_local_port_number(sds oid_id_str)
+{
+    sds port_number_str = parse_port_number_from_oid_id(sdsdup(oid_id_str));
+    int port_number = strtol(port_number_str, NULL, 10);
+    sdsfree(port_number_str);
+
+    return port_number;
+}
+
 /**
  * @brief returns a remote port by the local interface number
  * 
@@ -330,21 +331,17 @@ static sds parse_port_number_from_oid_id(sds oid_id_str)
  * @return true, if remote port was found
  * @return false, if remote port wasn't found
  */
-static bool snmp_get_remote_port_from_list(gll_t* remote_ports_list, int local_interface_id, database_port_t* remote_port)
+static bool snmp_get_remote_port_from_list(database_port_vec_t* remote_ports_list, int local_interface_id, database_port_t* remote_port)
 {
-
-    gll_node_t *current = remote_ports_list->first;
     for(int i = 0; i < remote_ports_list->size; i++)
     {
-        database_port_t *port = (database_port_t*)current->data;
+        database_port_t *port = &remote_ports_list->data[i];
 
         if(port->interface_id == local_interface_id)
         {
             remote_port->mac_address = sdscat(remote_port->mac_address, port->mac_address);
             return true;
         }
-
-        current = current->next;
     }
 
    return false; 
@@ -388,12 +385,22 @@ static sds snmp_fix_mac_address(sds mac_address)
 /**
  * @brief parses the given host data pair and saves it into database
  * 
+ * Links to remote ports which aren't in the database yet are saved as pending links,
+ * these need to be resolved with database_resolve_pending_links.
+ * 
+ * The rows of a walk which was cut off by a timeout or a deadline are saved as well. The OIDs marked as incomplete
+ * are saved in the MissingOIDs of the device, the values they would have updated and links they would have
+ * removed are kept from the last walk.
+ * 
  * @param host_data_pair the host data pair to parse
  * @param database the database were the data gets saved
+ * @param new_ports_count returns the number of ports that have been inserted, can be NULL.
  */
-void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *database)
+void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *database, int *new_ports_count)
 {
-    sds host_ip_str = sdsdup(str_from_ipv4(host_data_pair->host));
+    int new_ports = 0;
+
+    sds host_ip_str = str_from_ipv4(host_data_pair->host);
 
     database_device_t *device = malloc(sizeof(database_device_t));
     device->id = -1;
@@ -402,15 +409,46 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
     device->capabilities_enabled = -1;
     device->system_name = sdsnew("Unknown");
 
-    gll_t *ports_list = gll_init();
-    gll_t *remote_ports_list = gll_init();
+    database_port_vec_t ports_list;
+    database_port_vec_t remote_ports_list;
+    vec_init(&ports_list);
+    vec_init(&remote_ports_list);
+
+    oid_string_tuple_vec_t *oid_string_tuple_list = &host_data_pair->oid_string_tuple_list;
 
+    sds missing_oids_str = sdsempty();
+    bool device_incomplete = false;
+    bool ports_incomplete = false;
+    bool links_incomplete = false;
 
-    gll_t *oid_string_tuple_list = host_data_pair->oid_string_tuple_list;
-    gll_node_t *current = oid_string_tuple_list->first;
     for(int i = 0; i < oid_string_tuple_list->size; i++)
     {
-        oid_string_tuple_t *data = (oid_string_tuple_t*)current->data;
+        oid_string_tuple_t *data = &oid_string_tuple_list->data[i];
+        if(!STR_EQUAL(data->data_type_str_ptr, SNMP_OID_INCOMPLETE))
+            continue;
+
+        if(sdslen(missing_oids_str) > 0)
+            missing_oids_str = sdscat(missing_oids_str, " ");
+        missing_oids_str = sdscatsds(missing_oids_str, data->oid_str_ptr);
+
+        if(STR_EQUAL(data->oid_str_ptr, LLDPMIB_lldpLocSysName) || STR_EQUAL(data->oid_str_ptr, LLDPMIB_lldpLocSysCapSupported) || STR_EQUAL(data->oid_str_ptr, LLDPMIB_lldpLocSysCapEnabled))
+            device_incomplete = true;
+        else if(STR_EQUAL(data->oid_str_ptr, IFMIB_ifPhysAddress) || STR_EQUAL(data->oid_str_ptr, IFMIB_ifOperStatus) || STR_EQUAL(data->oid_str_ptr, IFMIB_ifSpeed) || STR_EQUAL(data->oid_str_ptr, IFMIB_ifName))
+            ports_incomplete = true;
+        else if(STR_EQUAL(data->oid_str_ptr, LLDPMIB_lldpRemChassisIdSubtype) || STR_EQUAL(data->oid_str_ptr, LLDPMIB_lldpRemChassisId))
+            links_incomplete = true;
+    }
+
+    if(sdslen(missing_oids_str) > 0)
+        printf(KYELLOW"[WARNING][%s] The walk was cut off, missing: %s\n"KNORMAL, host_ip_str, missing_oids_str);
+
+    for(int i = 0; i < oid_string_tuple_list->size; i++)
+    {
+        oid_string_tuple_t *data = &oid_string_tuple_list->data[i];
+
+        /// Marks the end of the rows of an OID whose walk was cut off
+        if(STR_EQUAL(data->data_type_str_ptr, SNMP_OID_INCOMPLETE))
+            continue;
 
         /// Parse LLDPMIB_lldpLocSysCapSupported
         if(STR_EQUAL(data->oid_str_ptr, LLDPMIB_lldpLocSysCapSupported))
@@ -466,7 +504,9 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
 
         if(STR_EQUAL(data->oid_str_ptr, IFMIB_ifIndex))
         {
-            database_port_t *port = (database_port_t*)malloc(sizeof(database_port_t));
+            database_port_t port_data;
+            database_port_t *port = &port_data;
+            port->id = -1;
             port->device_id = -1;
             port->interface_id = -1;
             port->mac_address = sdsempty();
@@ -484,7 +524,8 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                 printf(KYELLOW"[WARNING][%s] Couldn't parse %s of type %s - Not Implemented\n"KNORMAL, host_ip_str, IFMIB_ifIndex, data->data_type_str_ptr);
             }
 
-            if(if_index != -1)
+            /// The other columns are only fetched for Ethernet-like interfaces, the others don't become ports
+            if(if_index != -1 && snmp_is_ethernet_interface(if_index, oid_string_tuple_list))
             {
                 port->interface_id = if_index;
                 sds if_index_str = sdscatfmt(sdsempty(), "%i", if_index);
@@ -511,7 +552,7 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                         printf(KYELLOW"[WARNING][%s] Couldn't parse %s of type %s - Not Implemented\n"KNORMAL, host_ip_str, IFMIB_ifPhysAddress, address_tuple.data_type_str_ptr);
                     }
                 }
-                else
+                else if(!ports_incomplete)
                 {
                     printf(KYELLOW"[WARNING][%s] Couldn't find %s.%s - Not found\n"KNORMAL, host_ip_str, IFMIB_ifPhysAddress, if_index_str);
                 }
@@ -533,7 +574,7 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                         printf(KYELLOW"[WARNING][%s] Couldn't parse %s of type %s - Not Implemented\n"KNORMAL, host_ip_str, IFMIB_ifOperStatus, oper_tuple.data_type_str_ptr);
                     }
                 }
-                else
+                else if(!ports_incomplete)
                 {
                     printf(KYELLOW"[WARNING][%s] Couldn't find %s.%s - Not found\n"KNORMAL, host_ip_str, IFMIB_ifOperStatus, if_index_str);
                 }
@@ -555,7 +596,7 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                         printf(KYELLOW"[WARNING][%s] Couldn't parse %s of type %s - Not Implemented\n"KNORMAL, host_ip_str, IFMIB_ifSpeed, speed_tuple.data_type_str_ptr);
                     }
                 }
-                else
+                else if(!ports_incomplete)
                 {
                     printf(KYELLOW"[WARNING][%s] Couldn't find %s.%s - Not found\n"KNORMAL, host_ip_str, IFMIB_ifSpeed, if_index_str);
                 }
@@ -578,7 +619,7 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                         printf(KYELLOW"[WARNING][%s] Couldn't parse %s of type %s - Not Implemented\n"KNORMAL, host_ip_str, IFMIB_ifName, name_tuple.data_type_str_ptr);
                     }
                 }
-                else
+                else if(!ports_incomplete)
                 {
                     printf(KYELLOW"[WARNING][%s] Couldn't find %s.%s - Not found\n"KNORMAL, host_ip_str, IFMIB_ifName, if_index_str);
                 }
@@ -592,10 +633,9 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
             }
 
             if(sdslen(port->mac_address) > 0)
-            {
-                gll_pushBack(ports_list, port);
-                
-            }
+                vec_push(&ports_list, *port);
+            else
+                database_clear_port(port);
         }
 
         if(STR_EQUAL(data->oid_str_ptr, LLDPMIB_lldpRemChassisIdSubtype))
@@ -615,7 +655,9 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                 /// Parsing MAC-Address
                 if(STR_EQUAL(data->data_str_ptr, "4"))
                 {
-                    database_port_t *remote_port = (database_port_t*)malloc(sizeof(database_port_t));
+                    database_port_t remote_port_data;
+                    database_port_t *remote_port = &remote_port_data;
+                    remote_port->id = -1;
                     remote_port->device_id = -1;
                     remote_port->interface_id = -1;
                     remote_port->mac_address = sdsempty();
@@ -632,7 +674,7 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                             sdsfree(remote_port->mac_address);
                             remote_port->mac_address = snmp_fix_mac_address(mac_address);
                             /// save local interface id:
-                            remote_port->interface_id = strtol(parse_port_number_from_oid_id( data->oid_id_str_ptr), NULL, 10);
+                            remote_port->interface_id = snmp_parse_local_port_number(data->oid_id_str_ptr);
                         }
                         else if(STR_EQUAL(chassis_id_tuple.data_type_str_ptr, "Hex-STRING"))
                         {
@@ -640,20 +682,22 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                             sdsfree(remote_port->mac_address);
                             remote_port->mac_address = snmp_fix_hex_mac_address(mac_address);
                             /// save local interface id:
-                            remote_port->interface_id = strtol(parse_port_number_from_oid_id(data->oid_id_str_ptr), NULL, 10);
+                            remote_port->interface_id = snmp_parse_local_port_number(data->oid_id_str_ptr);
                         }
                         else
                         {
                             printf(KYELLOW"[WARNING][%s] Couldn't parse %s of type %s - Not Implemented\n"KNORMAL, host_ip_str, LLDPMIB_lldpRemChassisId, chassis_id_tuple.data_type_str_ptr);
                         }
                     }
-                    else
+                    else if(!links_incomplete)
                     {
                         printf(KYELLOW"[WARNING][%s] Couldn't find %s.%s - Not found\n"KNORMAL, host_ip_str, LLDPMIB_lldpRemChassisId, data->oid_id_str_ptr);
                     }
 
                     if(remote_port->interface_id != -1)
-                        gll_pushBack(remote_ports_list, remote_port);
+                        vec_push(&remote_ports_list, *remote_port);
+                    else
+                        database_clear_port(remote_port);
                     
                     sdsfree(chassis_id_tuple.oid_str_ptr);
                     sdsfree(chassis_id_tuple.oid_id_str_ptr);
@@ -670,21 +714,26 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
                 printf(KYELLOW"[WARNING][%s] Couldn't parse %s of type %s - Not Implemented\n"KNORMAL, host_ip_str, LLDPMIB_lldpRemChassisIdSubtype, data->data_type_str_ptr);
             }
         }
-            
-        current = current->next;
     }
 
     /// Saving parsed data to database
     if(database_does_device_exist(database, device))
-        database_update_device_by_management_address(database, device);
+    {
+        /// The name and capabilities may be missing, the device keeps those of the last walk
+        if(!device_incomplete)
+            database_update_device_by_management_address(database, device);
+    }
     else
+    {
         database_insert_device(database, device);
+    }
+
+    database_set_device_missing_oids(database, device->management_address, missing_oids_str);
 
     
-    current = ports_list->first;
-    for(int i = 0; i < ports_list->size; i++)
+    for(int i = 0; i < ports_list.size; i++)
     {
-        database_port_t *port = (database_port_t*)current->data;
+        database_port_t *port = &ports_list.data[i];
 
         database_port_t *real_remote_port = (database_port_t *)malloc(sizeof(database_port_t));
         real_remote_port->id = -1;
@@ -695,6 +744,20 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
         real_remote_port->name = sdsempty();
         real_remote_port->operating_status = -1;
 
+        port->device_id = device->id;
+
+        if(database_does_port_exist(database, port))
+        {
+            /// The values of the port may be missing, it keeps those of the last walk
+            if(!ports_incomplete)
+                database_update_port_by_mac_address(database, port);
+        }
+        else
+        {
+            database_insert_port(database, port);
+            new_ports++;
+        }
+
         database_link_t *link = (database_link_t*)malloc(sizeof(database_link_t));
         link->id = -1;
         link->length = 0;
@@ -703,18 +766,13 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
         link->port_b_id = -1;
         link->speed = 0;
 
-        port->device_id = device->id;
-
-        if(database_does_port_exist(database, port))
-            database_update_port_by_mac_address(database, port);
-        else
-            database_insert_port(database, port);
-
-        if(snmp_get_remote_port_from_list(remote_ports_list, port->interface_id, real_remote_port))
+        if(snmp_get_remote_port_from_list(&remote_ports_list, port->interface_id, real_remote_port))
         {
             // searches for remote port and updates it's data
             if(database_does_port_exist(database, real_remote_port))
             {
+                database_delete_pending_link_by_port(database, port);
+
                 if(real_remote_port->max_speed > port->max_speed)
                     link->speed = port->max_speed;
                 else
@@ -731,35 +789,37 @@ void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3 *
             }
             else
             {
+                /// The remote device hasn't been written yet, the link gets created by database_resolve_pending_links.
+                database_insert_pending_link(database, port, real_remote_port->mac_address);
+
                 if(database_does_link_exist(database, link))
                     database_delete_link(database, link);
             }
         }
-        else
+        else if(!links_incomplete)
         {
+            database_delete_pending_link_by_port(database, port);
+
             if(database_does_link_exist(database, link))
                 database_delete_link(database, link);
         }
 
         database_free_link(link);
-        database_free_port(port);
+        database_clear_port(port);
         database_free_port(real_remote_port);
-
-        current = current->next;
     }
 
-    current = remote_ports_list->first;
-    for(int i = 0; i < remote_ports_list->size; i++)
-    {
-        database_port_t *port = (database_port_t *)current->data;
-        database_free_port(port);
-        current = current->next;
-    }
+    for(int i = 0; i < remote_ports_list.size; i++)
+        database_clear_port(&remote_ports_list.data[i]);
 
-    gll_destroy(remote_ports_list);
-    gll_destroy(ports_list);
+    vec_free(&remote_ports_list);
+    vec_free(&ports_list);
 
     database_free_device(device);
 
+    sdsfree(missing_oids_str);
     sdsfree(host_ip_str);
+
+    if(new_ports_count != NULL)
+        *new_ports_count = new_ports;
 }
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include "lib/sds.h"
 
 #include "ip.h"
+#include "vec.h"
+#include "arena.h"
+#include "snmp_oid.h"
 #include "database.h"
 
 #define STR_CONTAINS(str_a, str_b) (strstr(str_a, str_b) != NULL)
@@ -20,17 +23,21 @@ typedef struct
     sds data_str_ptr;
 } oid_string_tuple_t;
 
+/// List of tuples stored by value
+typedef vec_t(oid_string_tuple_t) oid_string_tuple_vec_t;
+
 typedef struct
 {
     ipv4_t host;
-    gll_t* oid_string_tuple_list;
+    /// Owns the strings of the tuples in oid_string_tuple_list.
+    arena_t* arena;
+    oid_string_tuple_vec_t oid_string_tuple_list;
 } host_data_pair_t;
 
 
-bool snmp_parse_check_from_list(sds* snmp_data_str, gll_t** oid_list);
-void snmp_parse_from_list(sds* snmp_data_str, ipv4_t host_ip, gll_t** oid_list, gll_t** oid_string_tuple_list);
-void snmp_parse_free_oid_string_tuple_t(void* oid_string_tuple);
+bool snmp_parse_check_from_list(sds* snmp_data_str, oid_vec_t* oid_list);
+void snmp_parse_from_list(sds* snmp_data_str, ipv4_t host_ip, oid_vec_t* oid_list, arena_t *arena, oid_string_tuple_vec_t* oid_string_tuple_list);
 void snmp_parse_free_host_data_pair_t(void* host_data_pair);
-void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3  *database);
+void snmp_host_data_pair_to_database(host_data_pair_t *host_data_pair, sqlite3  *database, int *new_ports_count);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,465 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "debug.h"
+#include "kcolor.h"
+#include "queue.h"
+#include "arena.h"
+#include "stats.h"
+#include "capture.h"
+#include "database.h"
+#include "snmp_network.h"
+#include "snmp_walker.h"
+#include "snmp_credential.h"
+#include "snmp_pipeline.h"
+
+/**
+ * A host on its way through the pipeline: network fetch -> parse -> database write.
+ */
+typedef struct
+{
+    ipv4_t host;
+    /// Time of snmp_pipeline_submit, used for the latency of the whole host
+    uint64_t submit_us;
+    /// Start of the walk, for the duration of the fetch stage
+    uint64_t fetch_start_us;
+    sds return_data_str;
+    host_data_pair_t *host_data_pair;
+    /// -1 for a walk, 0 or 1 to only set the stale flag of the device
+    int stale;
+    /// The walk has been caused by a trap of the host, it is never skipped as unchanged
+    bool trap;
+} pipeline_job_t;
+
+static sds pipeline_exec_path_str;
+static oid_vec_t *pipeline_oid_list;
+static sqlite3 *pipeline_database;
+static snmp_pipeline_done_fn pipeline_done_fn;
+
+static queue_t *fetch_queue;
+static queue_t *parse_queue;
+static queue_t *db_queue;
+
+static pthread_t fetch_threads[PIPELINE_FETCH_THREADS];
+static pthread_t parse_threads[PIPELINE_PARSE_THREADS];
+static pthread_t db_thread;
+static bool threads_used = false;
+
+/// Number of submitted jobs which haven't been written to the database yet.
+static int jobs_pending = 0;
+static pthread_mutex_t jobs_pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_idle = PTHREAD_COND_INITIALIZER;
+
+static void pipeline_job_finished(void)
+{
+    pthread_mutex_lock(&jobs_pending_mutex);
+    jobs_pending--;
+    stats_gauge_set(STATS_GAUGE_PIPELINE_PENDING, jobs_pending);
+    if(jobs_pending == 0)
+        pthread_cond_broadcast(&jobs_idle);
+    pthread_mutex_unlock(&jobs_pending_mutex);
+}
+
+/**
+ * @brief Passes a finished walk on to the parse stage, called by the fetch threads or the walker.
+ */
+static void pipeline_walk_done(ipv4_t host_ip, int status, sds return_str, void *param)
+{
+    pipeline_job_t *job = param;
+
+    job->return_data_str = sdscatsds(job->return_data_str, return_str);
+    sdsfree(return_str);
+
+    stats_record(STATS_PHASE_FETCH, stats_now_us() - job->fetch_start_us);
+
+    /// The device hasn't changed since its last walk, its rows in the database are still up to date
+    if(status == SNMP_WALKER_UNCHANGED)
+    {
+        sdsfree(job->return_data_str);
+        free(job);
+        pipeline_job_finished();
+        return;
+    }
+
+    capture_write(job->host, job->return_data_str);
+
+    /// Blocks if the parse stage falls behind
+    queue_push(parse_queue, job);
+}
+
+/**
+ * @brief Fetch stage
+ *
+ * Hands the SNMPv1 and v2c walks to the event-driven walker, which runs up to SNMP_WALKER_MAX_WALKS of them at the
+ * same time and skips devices which report no change since their last walk, unless a trap caused the walk. Other
+ * hosts are walked with snmpwalk, slow agents only block this thread.
+ */
+static void *pipeline_fetch_thread(void *param)
+{
+    pipeline_job_t *job;
+
+    while((job = (pipeline_job_t *)queue_pop(fetch_queue)) != NULL)
+    {
+        const snmp_credential_t *credential = snmp_credential_for_host(job->host);
+
+        job->fetch_start_us = stats_now_us();
+        job->return_data_str = sdsempty();
+
+        if(!snmp_walker_refresh(credential, job->host, pipeline_oid_list, job->trap, pipeline_walk_done, job))
+            continue;
+
+        sds return_str = sdsempty();
+        int status = snmp_network_walk_batch_run_str(&pipeline_exec_path_str, credential, job->host, pipeline_oid_list, &return_str);
+        pipeline_walk_done(job->host, status, return_str, job);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Parse stage
+ *
+ * Converts the output of the SNMP walks to a host data pair.
+ */
+static void *pipeline_parse_thread(void *param)
+{
+    pipeline_job_t *job;
+
+    while((job = (pipeline_job_t *)queue_pop(parse_queue)) != NULL)
+    {
+        uint64_t start_us = stats_now_us();
+
+        if(!snmp_parse_check_from_list(&job->return_data_str, pipeline_oid_list))
+        {
+            sds host_ip_str = str_from_ipv4(job->host);
+            sds credential_str = snmp_credential_to_str(snmp_credential_for_host(job->host));
+            printf(KYELLOW "[WARNING] Not all needed OIDs are implemented on Host \"%s\" with credential \"%s\".\n" KNORMAL, host_ip_str, credential_str);
+            sdsfree(credential_str);
+            sdsfree(host_ip_str);
+        }
+
+        job->host_data_pair = malloc(sizeof(host_data_pair_t));
+        job->host_data_pair->host = job->host;
+        vec_init(&job->host_data_pair->oid_string_tuple_list);
+
+        /// All parse results of this walk share one arena
+        job->host_data_pair->arena = arena_pool_get();
+
+        snmp_parse_from_list(&job->return_data_str, job->host, pipeline_oid_list, job->host_data_pair->arena, &job->host_data_pair->oid_string_tuple_list);
+
+        stats_record(STATS_PHASE_PARSE, stats_now_us() - start_us);
+        stats_count(STATS_COUNTER_VARBINDS, job->host_data_pair->oid_string_tuple_list.size);
+
+        sdsfree(job->return_data_str);
+        job->return_data_str = NULL;
+
+        /// Blocks if the database stage falls behind
+        queue_push(db_queue, job);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Database stage
+ *
+ * Writes the host data pairs into the database. If SQLite falls behind, all queued hosts are written with a single commit.
+ */
+static void *pipeline_db_thread(void *param)
+{
+    pipeline_job_t *batch[PIPELINE_DB_BATCH_SIZE];
+    pipeline_job_t *job;
+
+    while((job = (pipeline_job_t *)queue_pop(db_queue)) != NULL)
+    {
+        int batch_size = 0;
+        batch[batch_size++] = job;
+
+        while(batch_size < PIPELINE_DB_BATCH_SIZE && (job = (pipeline_job_t *)queue_try_pop(db_queue)) != NULL)
+            batch[batch_size++] = job;
+
+        database_begin_transaction(pipeline_database);
+
+        int new_ports_total = 0;
+        for(int i = 0; i < batch_size; i++)
+        {
+            if(batch[i]->stale >= 0)
+            {
+                database_set_device_stale(pipeline_database, batch[i]->host, batch[i]->stale);
+                continue;
+            }
+
+            uint64_t start_us = stats_now_us();
+
+            int new_ports_count = 0;
+            snmp_host_data_pair_to_database(batch[i]->host_data_pair, pipeline_database, &new_ports_count);
+            new_ports_total += new_ports_count;
+
+            stats_record(STATS_PHASE_DB_MAP, stats_now_us() - start_us);
+        }
+
+        uint64_t commit_start_us = stats_now_us();
+
+        /// New ports can complete links that other devices announced before
+        if(new_ports_total > 0)
+            database_resolve_pending_links(pipeline_database, NULL);
+
+        database_commit_transaction(pipeline_database);
+
+        stats_record(STATS_PHASE_DB_COMMIT, stats_now_us() - commit_start_us);
+
+        PRINT_DEBUG("Wrote %d hosts with a single commit.\n", batch_size);
+
+        for(int i = 0; i < batch_size; i++)
+        {
+            if(batch[i]->stale < 0)
+            {
+                stats_record(STATS_PHASE_HOST, stats_now_us() - batch[i]->submit_us);
+                stats_count(STATS_COUNTER_HOSTS, 1);
+
+                pipeline_done_fn(batch[i]->host_data_pair);
+            }
+
+            free(batch[i]);
+
+            pipeline_job_finished();
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the discovery pipeline
+ *
+ * Each stage (network fetch, parse, database write) runs in its own threads, the stages are connected by bounded queues.
+ * If a stage falls behind the stages before are blocked. The walks of each host use the credential from snmp_credential_for_host.
+ *
+ * @param exec_path_str The path from the main application
+ * @param oid_list A string list with the OIDs to walk and parse.
+ * @param database open connection to a sqlite3 database, only used by the database stage while the pipeline runs.
+ * @param done_fn called after a host has been written to the database.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_pipeline_setup(sds* exec_path_str, oid_vec_t* oid_list, sqlite3 *database, snmp_pipeline_done_fn done_fn)
+{
+    pipeline_exec_path_str = sdsdup(*exec_path_str);
+    pipeline_oid_list = oid_list;
+    pipeline_database = database;
+    pipeline_done_fn = done_fn;
+
+    fetch_queue = queue_init(PIPELINE_QUEUE_SIZE);
+    parse_queue = queue_init(PIPELINE_QUEUE_SIZE);
+    db_queue = queue_init(PIPELINE_QUEUE_SIZE);
+
+    for(int i = 0; i < PIPELINE_FETCH_THREADS; i++)
+    {
+        if(pthread_create(&fetch_threads[i], NULL, pipeline_fetch_thread, NULL))
+        {
+            printf(KRED "[ERROR] snmp_pipeline_setup couldn't create fetch thread.\n" KNORMAL);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for(int i = 0; i < PIPELINE_PARSE_THREADS; i++)
+    {
+        if(pthread_create(&parse_threads[i], NULL, pipeline_parse_thread, NULL))
+        {
+            printf(KRED "[ERROR] snmp_pipeline_setup couldn't create parse thread.\n" KNORMAL);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(pthread_create(&db_thread, NULL, pipeline_db_thread, NULL))
+    {
+        printf(KRED "[ERROR] snmp_pipeline_setup couldn't create database thread.\n" KNORMAL);
+        return EXIT_FAILURE;
+    }
+
+    threads_used = true;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Queues a walk of a host, see snmp_pipeline_submit and snmp_pipeline_submit_trap.
+ */
+static int pipeline_submit(ipv4_t host_ip, bool trap)
+{
+    pipeline_job_t *job = (pipeline_job_t *)malloc(sizeof(pipeline_job_t));
+    job->host = host_ip;
+    job->submit_us = stats_now_us();
+    job->return_data_str = NULL;
+    job->host_data_pair = NULL;
+    job->stale = -1;
+    job->trap = trap;
+
+    pthread_mutex_lock(&jobs_pending_mutex);
+    jobs_pending++;
+    stats_gauge_set(STATS_GAUGE_PIPELINE_PENDING, jobs_pending);
+    pthread_mutex_unlock(&jobs_pending_mutex);
+
+    if(queue_push(fetch_queue, job))
+    {
+        free(job);
+        pipeline_job_finished();
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Queues a host for a SNMP walk, blocks while the fetch stage is full.
+ *
+ * The walk is skipped if the host reports no change since its last walk, see snmp_walker_refresh.
+ *
+ * @param host_ip The IPv4 address of the host.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_pipeline_submit(ipv4_t host_ip)
+{
+    return pipeline_submit(host_ip, false);
+}
+
+/**
+ * @brief Queues a host which sent a trap for a SNMP walk, blocks while the fetch stage is full.
+ *
+ * Unlike snmp_pipeline_submit the walk is never skipped, agents don't report a change of ifOperStatus in
+ * ifTableLastChange. An unchanged host is read with the GETs of its last walk instead.
+ *
+ * @param host_ip The IPv4 address of the host.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_pipeline_submit_trap(ipv4_t host_ip)
+{
+    return pipeline_submit(host_ip, true);
+}
+
+/**
+ * @brief Queues an already fetched walk result, skips the fetch stage. Blocks while the parse stage is full.
+ *
+ * Used to replay captures without network access.
+ *
+ * @param host_ip The IPv4 address of the host.
+ * @param data_str output of the walks like "snmpwalk -One" prints it, the pipeline takes the ownership.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_pipeline_submit_data(ipv4_t host_ip, sds data_str)
+{
+    pipeline_job_t *job = (pipeline_job_t *)malloc(sizeof(pipeline_job_t));
+    job->host = host_ip;
+    job->submit_us = stats_now_us();
+    job->return_data_str = data_str;
+    job->host_data_pair = NULL;
+    job->stale = -1;
+    job->trap = false;
+
+    pthread_mutex_lock(&jobs_pending_mutex);
+    jobs_pending++;
+    stats_gauge_set(STATS_GAUGE_PIPELINE_PENDING, jobs_pending);
+    pthread_mutex_unlock(&jobs_pending_mutex);
+
+    if(queue_push(parse_queue, job))
+    {
+        sdsfree(data_str);
+        free(job);
+        pipeline_job_finished();
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Sets the stale flag of a device in the database, in order with the walks written before.
+ *
+ * The database stage owns the database connection, so the flag is written there.
+ *
+ * @param host_ip The IPv4 address of the device.
+ * @param stale true if the device stopped answering.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_pipeline_submit_stale(ipv4_t host_ip, bool stale)
+{
+    pipeline_job_t *job = (pipeline_job_t *)malloc(sizeof(pipeline_job_t));
+    job->host = host_ip;
+    job->submit_us = stats_now_us();
+    job->return_data_str = NULL;
+    job->host_data_pair = NULL;
+    job->stale = stale ? 1 : 0;
+    job->trap = false;
+
+    pthread_mutex_lock(&jobs_pending_mutex);
+    jobs_pending++;
+    stats_gauge_set(STATS_GAUGE_PIPELINE_PENDING, jobs_pending);
+    pthread_mutex_unlock(&jobs_pending_mutex);
+
+    if(queue_push(db_queue, job))
+    {
+        free(job);
+        pipeline_job_finished();
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Returns the number of submitted jobs which haven't been written to the database yet.
+ */
+int snmp_pipeline_pending(void)
+{
+    pthread_mutex_lock(&jobs_pending_mutex);
+    int pending = jobs_pending;
+    pthread_mutex_unlock(&jobs_pending_mutex);
+
+    return pending;
+}
+
+/**
+ * @brief Blocks until all submitted hosts have been written to the database.
+ */
+void snmp_pipeline_wait_idle(void)
+{
+    pthread_mutex_lock(&jobs_pending_mutex);
+    while(jobs_pending > 0)
+        pthread_cond_wait(&jobs_idle, &jobs_pending_mutex);
+    pthread_mutex_unlock(&jobs_pending_mutex);
+}
+
+/**
+ * @brief Finishes all queued jobs and stops the pipeline threads.
+ */
+void snmp_pipeline_shutdown(void)
+{
+    if(!threads_used)
+        return;
+
+    queue_close(fetch_queue);
+    for(int i = 0; i < PIPELINE_FETCH_THREADS; i++)
+        pthread_join(fetch_threads[i], NULL);
+
+    /// The walks handed to the walker are still in progress
+    snmp_walker_wait_idle();
+
+    queue_close(parse_queue);
+    for(int i = 0; i < PIPELINE_PARSE_THREADS; i++)
+        pthread_join(parse_threads[i], NULL);
+
+    queue_close(db_queue);
+    pthread_join(db_thread, NULL);
+
+    queue_destroy(fetch_queue);
+    queue_destroy(parse_queue);
+    queue_destroy(db_queue);
+
+    sdsfree(pipeline_exec_path_str);
+
+    threads_used = false;
+}
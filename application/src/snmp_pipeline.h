@@ -0,0 +1,47 @@
+#ifndef SNMP_PIPELINE_H
+#define SNMP_PIPELINE_H
+
+#include <stdbool.h>
+#include <sqlite3.h>
+
+#include "lib/sds.h"
+#include "lib/gll.h"
+
+#include "ip.h"
+#include "snmp_parse.h"
+
+/// Number of threads waiting for SNMP walks.
+#ifndef PIPELINE_FETCH_THREADS
+#define PIPELINE_FETCH_THREADS 8
+#endif
+
+/// Number of threads parsing the output of SNMP walks.
+#ifndef PIPELINE_PARSE_THREADS
+#define PIPELINE_PARSE_THREADS 2
+#endif
+
+/// Max number of jobs waiting in front of a stage, a full queue blocks the stage before.
+#ifndef PIPELINE_QUEUE_SIZE
+#define PIPELINE_QUEUE_SIZE 32
+#endif
+
+/// Max number of hosts written to the database with a single commit.
+#ifndef PIPELINE_DB_BATCH_SIZE
+#define PIPELINE_DB_BATCH_SIZE 32
+#endif
+
+/**
+ * Called by the database stage after a host has been written, the ownership of host_data_pair is passed on.
+ */
+typedef void (*snmp_pipeline_done_fn)(host_data_pair_t *host_data_pair);
+
+int snmp_pipeline_setup(sds* exec_path_str, oid_vec_t* oid_list, sqlite3 *database, snmp_pipeline_done_fn done_fn);
+int snmp_pipeline_submit(ipv4_t host_ip);
+int snmp_pipeline_submit_trap(ipv4_t host_ip);
+int snmp_pipeline_submit_data(ipv4_t host_ip, sds data_str);
+int snmp_pipeline_submit_stale(ipv4_t host_ip, bool stale);
+int snmp_pipeline_pending(void);
+void snmp_pipeline_wait_idle(void);
+void snmp_pipeline_shutdown(void);
+
+#endif
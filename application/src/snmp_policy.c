@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kcolor.h"
+#include "vec.h"
+#include "target_set.h"
+#include "snmp_walker.h"
+#include "snmp_policy.h"
+
+/**
+ * Overrides of the limits for the agents of a target set.
+ */
+typedef struct
+{
+    target_set_t target_set;
+    snmp_policy_t policy;
+} snmp_policy_rule_t;
+
+/// Rules in the order of the file, only read after snmp_policy_setup
+static vec_t(snmp_policy_rule_t) policy_rule_list = { NULL, 0, 0 };
+
+/**
+ * @brief Parses the value of a limit.
+ * @return the value, -1 if it isn't a number between min and max.
+ */
+static int snmp_policy_parse_value(const char *value_str, int min, int max)
+{
+    char *end;
+    long value = strtol(value_str, &end, 10);
+
+    if(end == value_str || *end != '\0' || value < min || value > max)
+        return -1;
+
+    return (int)value;
+}
+
+/**
+ * @brief Parses a line of a policy file.
+ *
+ * Format:
+ *   <targets> [window <requests>] [rate <requests per second>] [burst <requests>] [gate 0|1] [repetitions <max-repetitions>] [deadline <seconds>]
+ *
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+static int snmp_policy_parse_line(sds line_str)
+{
+    int count;
+    sds *tokens = sdssplitargs(line_str, &count);
+    int status = EXIT_SUCCESS;
+
+    if(tokens == NULL)
+        return EXIT_FAILURE;
+
+    snmp_policy_rule_t rule = { .policy = { -1, -1, -1, -1, -1, -1 } };
+    target_set_init(&rule.target_set);
+
+    if(count < 3 || count % 2 == 0 || target_set_add_str(&rule.target_set, tokens[0], false))
+        status = EXIT_FAILURE;
+
+    for(int i = 1; status == EXIT_SUCCESS && i < count; i += 2)
+    {
+        if(strcmp(tokens[i], "window") == 0)
+            status = (rule.policy.window = snmp_policy_parse_value(tokens[i + 1], 1, SNMP_WALKER_MAX_WINDOW)) < 0;
+        else if(strcmp(tokens[i], "rate") == 0)
+            status = (rule.policy.rate = snmp_policy_parse_value(tokens[i + 1], 0, 1000000)) < 0;
+        else if(strcmp(tokens[i], "burst") == 0)
+            status = (rule.policy.burst = snmp_policy_parse_value(tokens[i + 1], 1, 1000000)) < 0;
+        else if(strcmp(tokens[i], "gate") == 0)
+            status = (rule.policy.gate = snmp_policy_parse_value(tokens[i + 1], 0, 1)) < 0;
+        else if(strcmp(tokens[i], "repetitions") == 0)
+            status = (rule.policy.repetitions = snmp_policy_parse_value(tokens[i + 1], 0, SNMP_WALKER_MAX_REPETITIONS)) < 0;
+        else if(strcmp(tokens[i], "deadline") == 0)
+            status = (rule.policy.deadline = snmp_policy_parse_value(tokens[i + 1], 0, 86400)) < 0;
+        else
+            status = EXIT_FAILURE;
+    }
+
+    sdsfreesplitres(tokens, count);
+
+    if(status)
+    {
+        target_set_free(&rule.target_set);
+        return EXIT_FAILURE;
+    }
+
+    /// Merges the ranges, the set is only read afterwards
+    target_set_size(&rule.target_set);
+    vec_push(&policy_rule_list, rule);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Reads the limits of the requests to groups of agents, e.g. switches with weak CPUs.
+ *
+ * @param path policy file with one rule per line, may be NULL. Empty lines and lines starting with # are ignored.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_policy_setup(const char* path)
+{
+    vec_init(&policy_rule_list);
+
+    if(path == NULL)
+        return EXIT_SUCCESS;
+
+    FILE *file = fopen(path, "r");
+    if(file == NULL)
+    {
+        printf(KRED "[ERROR] snmp_policy_setup can't open %s.\n" KNORMAL, path);
+        return EXIT_FAILURE;
+    }
+
+    char *line = NULL;
+    size_t len = 0;
+    ssize_t nread;
+    int line_number = 0;
+    int status = EXIT_SUCCESS;
+
+    while((nread = getline(&line, &len, file)) != -1)
+    {
+        line_number++;
+
+        sds line_str = sdsnewlen(line, nread);
+        line_str = sdstrim(line_str, " \t\r\n");
+
+        if(sdslen(line_str) > 0 && line_str[0] != '#' && snmp_policy_parse_line(line_str))
+        {
+            printf(KRED "[ERROR] snmp_policy_setup can't parse line %d of %s.\n" KNORMAL, line_number, path);
+            status = EXIT_FAILURE;
+        }
+
+        sdsfree(line_str);
+    }
+
+    free(line);
+    fclose(file);
+
+    return status;
+}
+
+void snmp_policy_shutdown(void)
+{
+    snmp_policy_rule_t *rule;
+
+    vec_each(&policy_rule_list, rule)
+        target_set_free(&rule->target_set);
+    vec_free(&policy_rule_list);
+}
+
+/**
+ * @brief Applies the first rule which contains the host, can be called from any thread.
+ *
+ * @param host the agent.
+ * @param policy holds the global defaults, the fields set by the rule are overwritten.
+ */
+void snmp_policy_for_host(ipv4_t host, snmp_policy_t* policy)
+{
+    snmp_policy_rule_t *rule;
+
+    vec_each(&policy_rule_list, rule)
+    {
+        if(!target_set_contains(&rule->target_set, host))
+            continue;
+
+        if(rule->policy.window >= 0)
+            policy->window = rule->policy.window;
+        if(rule->policy.rate >= 0)
+            policy->rate = rule->policy.rate;
+        if(rule->policy.burst >= 0)
+            policy->burst = rule->policy.burst;
+        if(rule->policy.gate >= 0)
+            policy->gate = rule->policy.gate;
+        if(rule->policy.repetitions >= 0)
+            policy->repetitions = rule->policy.repetitions;
+        if(rule->policy.deadline >= 0)
+            policy->deadline = rule->policy.deadline;
+
+        return;
+    }
+}
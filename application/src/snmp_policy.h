@@ -0,0 +1,29 @@
+#ifndef SNMP_POLICY_H
+#define SNMP_POLICY_H
+
+#include "ip.h"
+
+/**
+ * Limits of the requests to an agent. A field of a rule which is -1 keeps the global default.
+ */
+typedef struct
+{
+    /// Max number of requests in flight
+    int window;
+    /// Max number of requests per second, 0 for no limit
+    int rate;
+    /// Number of requests an idle agent gets back to back before the rate applies
+    int burst;
+    /// 1 if walks are skipped while the agent reports no change, 0 reads them with the plan of the last walk instead
+    int gate;
+    /// Largest max-repetitions of the GETBULKs, 0 walks with GETNEXT
+    int repetitions;
+    /// Seconds a walk of the agent may take, 0 for no limit
+    int deadline;
+} snmp_policy_t;
+
+int snmp_policy_setup(const char* path);
+void snmp_policy_shutdown(void);
+void snmp_policy_for_host(ipv4_t host, snmp_policy_t* policy);
+
+#endif
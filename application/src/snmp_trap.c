@@ -1,5 +1,7 @@
 #include "snmp_trap.h"
 #include "kcolor.h"
+#include "stats.h"
+#include "snmp_credential.h"
 #include "lib/gll.h"
 
 #include <signal.h>
@@ -42,11 +44,12 @@ int snmp_trap_read_data(ipv4_t **ip_buffer_out, int* ip_buffer_pos_out)
         return EXIT_FAILURE;
     }
 
-    **ip_buffer_out = *ip_buffer;
+    memcpy(*ip_buffer_out, ip_buffer, ip_buffer_pos * sizeof(ipv4_t));
     *ip_buffer_pos_out = ip_buffer_pos;
 
     ip_buffer_pos = 0;
     memset(ip_buffer, 0, IP_BUFFER_SIZE * sizeof(ipv4_t));
+    stats_gauge_set(STATS_GAUGE_TRAP_BUFFER_USED, 0);
 
     pthread_mutex_unlock(&ip_buffer_mutex);
 
@@ -109,17 +112,21 @@ void *snmp_trap_daemon_thread(void* param)
                     sdsfree(timestamp_str);
                     sdsfree(ip_str);
 
+                    stats_count(STATS_COUNTER_TRAPS_RECEIVED, 1);
+
                     pthread_mutex_lock(&ip_buffer_mutex);
 
-                    if(ip_buffer_pos >= TRAP_SLEEP_US)
+                    if(ip_buffer_pos >= IP_BUFFER_SIZE)
                     {
-                        printf(KRED "[ERROR] SNMP Trap buffer is full, dropping packages." KNORMAL);
-                        printf(KNORMAL "[NOTE] Current buffer size: %u" KNORMAL, TRAP_SLEEP_US);
+                        stats_count(STATS_COUNTER_TRAPS_DROPPED, 1);
+                        printf(KRED "[ERROR] SNMP Trap buffer is full, dropping packages.\n" KNORMAL);
+                        printf(KNORMAL "[NOTE] Current buffer size: %u\n" KNORMAL, IP_BUFFER_SIZE);
                     }
                     else
                     {
                         ip_buffer[ip_buffer_pos] = ip;
                         ip_buffer_pos++;
+                        stats_gauge_set(STATS_GAUGE_TRAP_BUFFER_USED, ip_buffer_pos);
                     }
                     pthread_mutex_unlock(&ip_buffer_mutex);
                 }
@@ -171,7 +178,7 @@ void *snmp_trap_daemon_thread(void* param)
     {
         FILE *fp = fopen("snmptrapd.conf", "w");
 
-        fprintf(fp, "authCommunity log,execute,net %s", argument_str_array[1]);
+        fprintf(fp, "%s", argument_str_array[1]);
         fclose(fp);
 
         sds binary_path_str = sdsnew("/usr/bin/snmptrapd");
@@ -219,7 +226,41 @@ void snmp_trap_wait_for_thread(void)
         
 }
 
-int snmp_trap_daemon_setup(sds* exec_path_str, sds* community_str)
+/**
+ * @brief Builds the snmptrapd configuration which accepts traps with each credential.
+ *
+ * SNMPv3 users are created without engine id, snmptrapd accepts informs from them. Traps need the engine id of the sender.
+ */
+static sds snmp_trap_config_from_credentials(void)
+{
+    sds config_str = sdsempty();
+    snmp_credential_vec_t *credential_list = snmp_credential_get_list();
+
+    for(int i = 0; i < credential_list->size; i++)
+    {
+        snmp_credential_t *credential = &credential_list->data[i];
+
+        if(credential->version != SNMP_VERSION_3)
+        {
+            if(snmp_credential_find_community(credential->community_str) == i)
+                config_str = sdscatprintf(config_str, "authCommunity log,execute,net %s\n", credential->community_str);
+            continue;
+        }
+
+        config_str = sdscatprintf(config_str, "createUser %s", credential->user_str);
+        if(sdslen(credential->auth_protocol_str) > 0)
+            config_str = sdscatprintf(config_str, " %s %s", credential->auth_protocol_str, credential->auth_password_str);
+        if(sdslen(credential->priv_protocol_str) > 0)
+            config_str = sdscatprintf(config_str, " %s %s", credential->priv_protocol_str, credential->priv_password_str);
+
+        const char *level = strcmp(credential->security_level_str, "authPriv") == 0 ? "priv" : (strcmp(credential->security_level_str, "authNoPriv") == 0 ? "auth" : "noauth");
+        config_str = sdscatprintf(config_str, "\nauthUser log,execute,net %s %s\n", credential->user_str, level);
+    }
+
+    return config_str;
+}
+
+int snmp_trap_daemon_setup(sds* exec_path_str)
 {
     printf("Setting up SNMP Trap Daemon.\n");
 
@@ -236,7 +277,7 @@ int snmp_trap_daemon_setup(sds* exec_path_str, sds* community_str)
     ip_buffer = (ipv4_t *)calloc(IP_BUFFER_SIZE, sizeof(ipv4_t));
 
     argument_str_array[0] = sdsnew(*exec_path_str);
-    argument_str_array[1] = sdsnew(*community_str);
+    argument_str_array[1] = snmp_trap_config_from_credentials();
 
     pthread_create(&thread, NULL, snmp_trap_daemon_thread, NULL);
     thread_used = true;
@@ -18,6 +18,6 @@
 
 int snmp_trap_read_data(ipv4_t **ip_buffer_out, int* ip_buffer_pos_out);
 void snmp_trap_wait_for_thread(void);
-int snmp_trap_daemon_setup(sds* exec_path_str, sds* community_str);
+int snmp_trap_daemon_setup(sds* exec_path_str);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,2401 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include "kcolor.h"
+#include "stats.h"
+#include "host_table.h"
+#include "snmp_ber.h"
+#include "snmp_policy.h"
+#include "snmp_walker.h"
+
+#define WALKER_MAX_PACKET 65535
+/// Number of OIDs of the change-detection GET
+#define WALKER_GATE_OIDS 3
+/// Responses read from a socket before the timers are checked again
+#define WALKER_RECEIVE_BATCH 256
+/// Time an answer may take longer than twice the smoothed round trip time before it counts as slow. On a LAN the time
+/// the agent needs for a large answer is larger than the round trip time of a small one.
+#define WALKER_SLOW_SLACK_US 1000
+
+typedef enum
+{
+    WALKER_COLUMN_READY,
+    WALKER_COLUMN_IN_FLIGHT,
+    /// Waits for a token of the agent's rate limit, the timer releases it
+    WALKER_COLUMN_PACED,
+    /// Waits for the interface types, see walker_column_finish
+    WALKER_COLUMN_WAITING,
+    WALKER_COLUMN_DONE
+} walker_column_state_t;
+
+struct walker_walk;
+
+/**
+ * Walk of a single OID of the list. Each column has at most one request in flight, the window limits the columns
+ * of an agent in flight at the same time.
+ *
+ * Selective columns of the ifTable aren't walked, they are read with GETs of the Ethernet-like interfaces only. Plan
+ * columns read a range of the OIDs of a plan with GETs, see walker_plan_load.
+ */
+typedef struct walker_column
+{
+    struct walker_walk *walk;
+    const uint32_t *root;
+    int root_len;
+    /// Last OID returned by the agent, the next GETNEXT starts there
+    uint32_t oid[SNMP_WALKER_MAX_OID_LEN];
+    int oid_len;
+    walker_column_state_t state;
+    int32_t request_id;
+    uint64_t start_us;
+    /// First send of the request in flight, its retries end SNMP_WALKER_REQUEST_DEADLINE_MS later
+    uint64_t request_us;
+    uint64_t sent_us;
+    /// Timeout of the request in flight, the agent's timeout when it was sent
+    uint64_t timeout_us;
+    /// Position in the timer heap while a request is in flight
+    int heap_index;
+    int retries;
+    int count;
+    /// Read with GETs of the interfaces in if_index_list of the walk instead of GETNEXTs
+    bool selective;
+    /// Interfaces of the request in flight: position in if_index_list and number. The batch size is 0 for the learned
+    /// size of the agent, 1 after an error.
+    int instance_pos;
+    int instance_count;
+    int batch_size;
+    /// max-repetitions of the GETBULK in flight, 0 for a GETNEXT
+    int repetitions;
+    /// Reads the entries instance_pos to instance_end of the plan of the walk
+    bool planned;
+    int instance_end;
+    /// Instances returned, each as its length followed by the sub identifiers after the root
+    vec_t(uint32_t) instance_data;
+    /// Lines like snmpwalk -One prints them
+    sds output_str;
+} walker_column_t;
+
+/**
+ * Round trip time estimate of an agent, kept like the retransmission timer of TCP (RFC 6298).
+ */
+typedef struct
+{
+    /// Smoothed round trip time and its mean deviation in microseconds, srtt_us is 0 until the first sample
+    uint64_t srtt_us;
+    uint64_t rttvar_us;
+    /// Timeout of new requests, doubled after a timeout until the next sample
+    uint64_t rto_us;
+} walker_rtt_t;
+
+/**
+ * Largest requests an agent handles, learned like the congestion window of TCP. A size doubles up to its threshold and
+ * grows by one above it after answers within the round trip time budget. tooBig, truncated or slow answers and
+ * timeouts lower the size and the threshold.
+ */
+typedef struct
+{
+    /// max-repetitions of the GETBULKs of the columns
+    int repetitions;
+    int repetitions_threshold;
+    /// OIDs per GET of the selective and plan columns
+    int get_varbinds;
+    int get_threshold;
+} walker_sizing_t;
+
+#define WALKER_SIZING_INIT { SNMP_WALKER_REPETITIONS, SNMP_WALKER_MAX_REPETITIONS, SNMP_WALKER_GET_VARBINDS, SNMP_WALKER_MAX_GET_VARBINDS }
+
+/**
+ * Values of the change-detection GET: sysUpTime, ifTableLastChange and lldpStatsRemTablesLastChangeTime.
+ */
+typedef struct
+{
+    bool valid;
+    uint32_t ticks[WALKER_GATE_OIDS];
+    /// Time of the GET
+    uint64_t read_us;
+} walker_gate_t;
+
+/**
+ * Instances returned by the columns of the last complete walk of an agent:
+ *   <column count> <hash of the roots> and for each column <instance count> followed by the instances,
+ *   each as its length and the sub identifiers after the root of the column.
+ */
+typedef struct
+{
+    uint32_t *data;
+    int len;
+} walker_plan_t;
+
+/**
+ * OID of a plan, instance_pos is the position of the instance in the plan data, -1 for a column without instances.
+ */
+typedef struct
+{
+    int column_index;
+    int instance_pos;
+} walker_plan_entry_t;
+
+/**
+ * What the walker keeps of an agent across walks.
+ */
+typedef struct
+{
+    walker_rtt_t rtt;
+    walker_sizing_t sizing;
+    /// Values read before the last complete walk
+    walker_gate_t gate;
+    /// Instances of that walk, only read under walker_agent_mutex
+    walker_plan_t plan;
+} walker_agent_t;
+
+/**
+ * Walk of the OID list on one agent. A small state machine driven by the event thread: each response or timeout
+ * advances one column, the walk is finished when all columns are done.
+ */
+typedef struct walker_walk
+{
+    struct walker_walk *next;
+    ipv4_t host;
+    const snmp_credential_t *credential;
+    int socket_fd;
+    walker_rtt_t rtt;
+    /// Round trip time of the response being handled, 0 if it can't be timed
+    uint64_t sample_us;
+    walker_sizing_t sizing;
+    /// Window, rate limit and largest max-repetitions of the agent
+    snmp_policy_t policy;
+    /// Slot of the agent in walker_bucket_table
+    int bucket_slot;
+    /// Column waiting for a token, no other column of the walk is sent before it
+    struct walker_column *paced_column;
+    /// Request of the change-detection GET, the columns wait for its answer. DONE if the walk isn't gated.
+    struct walker_column gate_column;
+    /// Values of the last complete walk of the agent and of this walk
+    walker_gate_t gate_cached;
+    walker_gate_t gate;
+    /// The agent reported no change, the columns have been skipped
+    bool unchanged;
+    /// Copy of the plan of the agent and its OIDs in the order of the output
+    vec_t(uint32_t) plan_data;
+    vec_t(walker_plan_entry_t) plan_entry_list;
+    /// GETs of the plan, the columns wait until they are done and are only walked if the instances don't match
+    vec_t(walker_column_t) plan_column_list;
+    int plan_active_count;
+    /// All columns have been read with the plan
+    bool planned;
+    /// The instances returned by the columns become the plan of the agent
+    bool record_plan;
+    /// Refresh after a trap, an unchanged agent is read with its plan instead of being skipped
+    bool trap;
+    /// A column returned its OIDs out of order, no plan is kept
+    bool plan_broken;
+    /// The columns are walked with GETBULKs (SNMPv2c), otherwise with GETNEXTs
+    bool bulk;
+    /// GETNEXT or GETBULK request with the community of the agent and its max-repetitions, the OID of the column is appended
+    snmp_ber_template_t request_template;
+    int request_repetitions;
+    /// GET request with the community of the agent, for the selective columns
+    snmp_ber_template_t get_template;
+    /// Column of ifType, the selective columns wait until it is done
+    struct walker_column *if_type_column;
+    /// Ethernet-like interfaces returned by the ifType column
+    vec_t(uint32_t) if_index_list;
+    walker_column_t *column_list;
+    int column_count;
+    /// Parsed OIDs of the list, the roots of the columns point into it
+    uint32_t *root_data;
+    int active_count;
+    int in_flight_count;
+    bool timed_out;
+    /// Timer of the deadline of the walk in the timer heap, its columns are cut off when it expires
+    struct walker_column deadline_timer;
+    bool deadline_exceeded;
+    sds return_str;
+    snmp_walker_done_fn done_fn;
+    void *param;
+} walker_walk_t;
+
+/**
+ * Token bucket of an agent, shared by all walks of the agent.
+ */
+typedef struct
+{
+    double tokens;
+    uint64_t refill_us;
+} walker_bucket_t;
+
+/**
+ * Bucket of the table of requests in flight, column is NULL for an empty bucket.
+ */
+typedef struct
+{
+    int32_t request_id;
+    walker_column_t *column;
+} walker_request_t;
+
+/// OIDs of ifPhysAddress, printed with the DISPLAY-HINT "1x:" of IF-MIB like snmpwalk does
+static const uint32_t walker_if_phys_address_oid[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 6 };
+
+/// sysUpTime.0, ifTableLastChange.0 and lldpStatsRemTablesLastChangeTime.0
+static const uint32_t walker_gate_oid_list[WALKER_GATE_OIDS][10] = {
+    { 1, 3, 6, 1, 2, 1, 1, 3, 0 },
+    { 1, 3, 6, 1, 2, 1, 31, 1, 5, 0 },
+    { 1, 0, 8802, 1, 1, 2, 1, 2, 1, 0 },
+};
+static const int walker_gate_oid_len[WALKER_GATE_OIDS] = { 9, 10, 10 };
+
+static int walker_window = SNMP_WALKER_WINDOW;
+static int walker_rate = SNMP_WALKER_RATE;
+static int walker_deadline_s = SNMP_WALKER_DEADLINE_S;
+static atomic_uint walker_next_request_id = 0;
+
+/// Agents walked before, the slot of an agent indexes walker_agent_list
+static host_table_t *walker_agent_table = NULL;
+static vec_t(walker_agent_t) walker_agent_list;
+/// Estimate over the SRTTs of all agents, agents without a sample start with its timeout
+static walker_rtt_t walker_fleet_rtt = { 0, 0, SNMP_WALKER_TIMEOUT_MS * 1000ULL };
+static pthread_mutex_t walker_agent_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/// Only used by the event thread while it runs
+static int walker_epoll_fd = -1;
+static int walker_event_fd = -1;
+static int walker_socket_list[SNMP_WALKER_SOCKETS];
+static int walker_socket_count = 0;
+static walker_request_t *walker_request_table = NULL;
+static uint32_t walker_request_mask = 0;
+/// Min heap of the columns with a request in flight or waiting for a token and of the deadlines of the walks, ordered by their timeout
+static walker_column_t **walker_timer_heap = NULL;
+static int walker_timer_count = 0;
+static uint8_t *walker_packet = NULL;
+static uint8_t *walker_request = NULL;
+static snmp_ber_template_t *walker_get_request = NULL;
+/// Token buckets of the agents walked before, the slot of an agent indexes walker_bucket_list
+static host_table_t *walker_bucket_table = NULL;
+static vec_t(walker_bucket_t) walker_bucket_list;
+
+static pthread_t walker_event_thread;
+static pthread_t walker_delivery_thread;
+static bool walker_running = false;
+
+/// Walks handed over between the threads, protected by walker_mutex
+static pthread_mutex_t walker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t walker_not_full = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t walker_done_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t walker_idle = PTHREAD_COND_INITIALIZER;
+static walker_walk_t *walker_submit_head = NULL;
+static walker_walk_t *walker_submit_tail = NULL;
+static walker_walk_t *walker_done_head = NULL;
+static walker_walk_t *walker_done_tail = NULL;
+/// Walks submitted which haven't been delivered yet
+static int walker_active_walks = 0;
+static bool walker_stop = false;
+
+/* -------------------------------------------------------------------------- */
+/* Round trip time                                                            */
+/* -------------------------------------------------------------------------- */
+
+static uint64_t walker_rtt_clamp(uint64_t rto_us)
+{
+    if(rto_us < SNMP_WALKER_MIN_TIMEOUT_MS * 1000ULL)
+        return SNMP_WALKER_MIN_TIMEOUT_MS * 1000ULL;
+    if(rto_us > SNMP_WALKER_MAX_TIMEOUT_MS * 1000ULL)
+        return SNMP_WALKER_MAX_TIMEOUT_MS * 1000ULL;
+
+    return rto_us;
+}
+
+/**
+ * @brief Adds a round trip time sample, the timeout becomes SRTT + 4 * RTTVAR again.
+ */
+static void walker_rtt_sample(walker_rtt_t *rtt, uint64_t sample_us)
+{
+    if(sample_us == 0)
+        sample_us = 1;
+
+    if(rtt->srtt_us == 0)
+    {
+        rtt->srtt_us = sample_us;
+        rtt->rttvar_us = sample_us / 2;
+    }
+    else
+    {
+        uint64_t deviation_us = rtt->srtt_us > sample_us ? rtt->srtt_us - sample_us : sample_us - rtt->srtt_us;
+        rtt->rttvar_us = (3 * rtt->rttvar_us + deviation_us) / 4;
+        rtt->srtt_us = (7 * rtt->srtt_us + sample_us) / 8;
+    }
+
+    rtt->rto_us = walker_rtt_clamp(rtt->srtt_us + 4 * rtt->rttvar_us);
+}
+
+/**
+ * @brief Returns what is known of an agent, agents without an estimate start with the timeout of the fleet.
+ *
+ * The plan isn't returned, it may be replaced as soon as the mutex is released (see walker_plan_load).
+ */
+static walker_agent_t walker_agent_get(ipv4_t host)
+{
+    walker_agent_t agent = { { 0, 0, SNMP_WALKER_TIMEOUT_MS * 1000ULL }, WALKER_SIZING_INIT, { false }, { NULL, 0 } };
+
+    pthread_mutex_lock(&walker_agent_mutex);
+    int slot = walker_agent_table != NULL ? host_table_find_slot(walker_agent_table, host) : -1;
+    if(slot >= 0)
+        agent = walker_agent_list.data[slot];
+    else
+        agent.rtt.rto_us = walker_fleet_rtt.rto_us;
+    pthread_mutex_unlock(&walker_agent_mutex);
+
+    agent.plan = (walker_plan_t){ NULL, 0 };
+
+    return agent;
+}
+
+/**
+ * @brief Saves the estimate and the learned sizes of an agent after a walk, its SRTT is a sample of the fleet estimate.
+ *
+ * The backoff only lasts for one walk, otherwise an agent which was down would start its next walks with long timeouts.
+ * Agents which never answered aren't saved, they start with the timeout of the fleet again. The values of the
+ * change-detection GET only become the reference for the next walks if all columns have been read.
+ *
+ * @param plan replaces the plan of the agent and is owned by it afterwards, NULL keeps the plan.
+ */
+static void walker_agent_put(ipv4_t host, const walker_rtt_t *rtt, const walker_sizing_t *sizing, const walker_gate_t *gate, walker_plan_t *plan)
+{
+    if(rtt->srtt_us == 0)
+    {
+        if(plan != NULL)
+            free(plan->data);
+        return;
+    }
+
+    walker_rtt_t saved_rtt = *rtt;
+    saved_rtt.rto_us = walker_rtt_clamp(rtt->srtt_us + 4 * rtt->rttvar_us);
+
+    pthread_mutex_lock(&walker_agent_mutex);
+
+    if(walker_agent_table != NULL)
+    {
+        int slot = host_table_find_slot(walker_agent_table, host);
+        if(slot < 0)
+        {
+            walker_agent_t agent = { saved_rtt, *sizing, { false }, { NULL, 0 } };
+
+            host_table_insert(walker_agent_table, host);
+            vec_push(&walker_agent_list, agent);
+            slot = walker_agent_list.size - 1;
+        }
+
+        walker_agent_list.data[slot].rtt = saved_rtt;
+        walker_agent_list.data[slot].sizing = *sizing;
+        if(gate != NULL)
+            walker_agent_list.data[slot].gate = *gate;
+        if(plan != NULL)
+        {
+            free(walker_agent_list.data[slot].plan.data);
+            walker_agent_list.data[slot].plan = *plan;
+            plan = NULL;
+        }
+    }
+
+    walker_rtt_sample(&walker_fleet_rtt, rtt->srtt_us);
+
+    pthread_mutex_unlock(&walker_agent_mutex);
+
+    if(plan != NULL)
+        free(plan->data);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Request sizes                                                              */
+/* -------------------------------------------------------------------------- */
+
+static void walker_size_grow(int *size, int threshold, int max)
+{
+    if(*size < threshold)
+        *size = *size * 2 < threshold ? *size * 2 : threshold;
+    else
+        *size += 1;
+
+    if(*size > max)
+        *size = max;
+}
+
+/**
+ * @brief Lowers a learned size, it only grows by one per answer from there.
+ */
+static void walker_size_shrink(int *size, int *threshold, int new_size)
+{
+    *size = new_size > 1 ? new_size : 1;
+    *threshold = *size;
+}
+
+/**
+ * @brief Learns from the answer to a request of requested OIDs or repetitions, of which answered came back.
+ *
+ * An agent which returns fewer repetitions than requested can't send more in one message. An answer slower than twice
+ * the smoothed round trip time (plus WALKER_SLOW_SLACK_US) shows an agent which is slow with large requests. Only timed answers to requests of
+ * the learned size let it grow.
+ */
+static void walker_size_adjust(const walker_walk_t *walk, int *size, int *threshold, int max, int requested, int answered)
+{
+    if(answered < requested)
+        walker_size_shrink(size, threshold, answered);
+    else if(walk->sample_us > 2 * walk->rtt.srtt_us + WALKER_SLOW_SLACK_US)
+        walker_size_shrink(size, threshold, requested * 3 / 4);
+    else if(walk->sample_us > 0 && requested >= *size)
+        walker_size_grow(size, *threshold, max);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Output                                                                     */
+/* -------------------------------------------------------------------------- */
+
+static sds walker_cat_oid(sds str, const uint32_t *oid, int oid_len)
+{
+    for(int i = 0; i < oid_len; i++)
+        str = sdscatfmt(str, ".%u", oid[i]);
+
+    return str;
+}
+
+static sds walker_cat_octet_string(sds str, const uint32_t *oid, int oid_len, const uint8_t *value, int len)
+{
+    int hint_len = sizeof(walker_if_phys_address_oid) / sizeof(uint32_t);
+    if(oid_len > hint_len && memcmp(oid, walker_if_phys_address_oid, sizeof(walker_if_phys_address_oid)) == 0)
+    {
+        str = sdscat(str, "STRING: ");
+        for(int i = 0; i < len; i++)
+            str = sdscatprintf(str, i > 0 ? ":%x" : "%x", value[i]);
+        return str;
+    }
+
+    bool printable = true;
+    for(int i = 0; i < len && printable; i++)
+        printable = isprint(value[i]) || isspace(value[i]);
+
+    if(!printable)
+    {
+        str = sdscat(str, "Hex-STRING: ");
+        for(int i = 0; i < len; i++)
+            str = sdscatprintf(str, "%02X ", value[i]);
+        return str;
+    }
+
+    str = sdscat(str, "STRING: \"");
+    for(int i = 0; i < len; i++)
+    {
+        if(value[i] == '"' || value[i] == '\\')
+            str = sdscatlen(str, "\\", 1);
+        str = sdscatlen(str, &value[i], 1);
+    }
+
+    return sdscat(str, "\"");
+}
+
+/**
+ * @brief Appends a value like snmpwalk -One prints it.
+ */
+static sds walker_cat_value(sds str, const uint32_t *oid, int oid_len, uint8_t tag, const uint8_t *value, int len)
+{
+    switch(tag)
+    {
+        case SNMP_BER_INTEGER:
+        {
+            uint32_t result = len > 0 && (value[0] & 0x80) ? 0xFFFFFFFF : 0;
+            for(int i = 0; i < len && i < 4; i++)
+                result = (result << 8) | value[i];
+            return sdscatfmt(str, "INTEGER: %i", (int)(int32_t)result);
+        }
+        case SNMP_BER_OCTET_STRING:
+            return walker_cat_octet_string(str, oid, oid_len, value, len);
+        case SNMP_BER_NULL:
+            return sdscat(str, "NULL");
+        case SNMP_BER_OID:
+        {
+            uint32_t value_oid[SNMP_WALKER_MAX_OID_LEN];
+            int value_oid_len = snmp_ber_decode_oid(value, len, value_oid);
+            return walker_cat_oid(sdscat(str, "OID: "), value_oid, value_oid_len > 0 ? value_oid_len : 0);
+        }
+        case SNMP_BER_IP_ADDRESS:
+            if(len == 4)
+                return sdscatprintf(str, "IpAddress: %u.%u.%u.%u", value[0], value[1], value[2], value[3]);
+            break;
+        case SNMP_BER_COUNTER32:
+            return sdscatfmt(str, "Counter32: %U", (unsigned long long)snmp_ber_decode_unsigned(value, len));
+        case SNMP_BER_GAUGE32:
+            return sdscatfmt(str, "Gauge32: %U", (unsigned long long)snmp_ber_decode_unsigned(value, len));
+        case SNMP_BER_COUNTER64:
+            return sdscatfmt(str, "Counter64: %U", (unsigned long long)snmp_ber_decode_unsigned(value, len));
+        case SNMP_BER_TIMETICKS:
+        {
+            uint64_t ticks = snmp_ber_decode_unsigned(value, len);
+            uint64_t days = ticks / 8640000;
+            str = sdscatprintf(str, "Timeticks: (%llu) ", (unsigned long long)ticks);
+            if(days > 0)
+                str = sdscatprintf(str, "%llu %s, ", (unsigned long long)days, days == 1 ? "day" : "days");
+            return sdscatprintf(str, "%d:%02d:%02d.%02d", (int)(ticks / 360000 % 24), (int)(ticks / 6000 % 60), (int)(ticks / 100 % 60), (int)(ticks % 100));
+        }
+        case SNMP_BER_NO_SUCH_OBJECT:
+            return sdscat(str, "No Such Object available on this agent at this OID");
+        case SNMP_BER_NO_SUCH_INSTANCE:
+            return sdscat(str, "No Such Instance currently exists at this OID");
+    }
+
+    str = sdscat(str, tag == SNMP_BER_OPAQUE ? "OPAQUE: " : "Hex-STRING: ");
+    for(int i = 0; i < len; i++)
+        str = sdscatprintf(str, "%02X ", value[i]);
+
+    return str;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Requests in flight                                                         */
+/* -------------------------------------------------------------------------- */
+
+/// Request-ids are handed out in sequence, so they spread evenly over the buckets
+static uint32_t walker_request_bucket(int32_t request_id)
+{
+    return (uint32_t)request_id & walker_request_mask;
+}
+
+static void walker_request_insert(walker_column_t *column)
+{
+    uint32_t bucket = walker_request_bucket(column->request_id);
+
+    while(walker_request_table[bucket].column != NULL)
+        bucket = (bucket + 1) & walker_request_mask;
+
+    walker_request_table[bucket].request_id = column->request_id;
+    walker_request_table[bucket].column = column;
+}
+
+static walker_column_t *walker_request_find(int32_t request_id)
+{
+    for(uint32_t bucket = walker_request_bucket(request_id); walker_request_table[bucket].column != NULL; bucket = (bucket + 1) & walker_request_mask)
+    {
+        if(walker_request_table[bucket].request_id == request_id)
+            return walker_request_table[bucket].column;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Removes a request, the following entries are moved back so lookups never need tombstones.
+ */
+static void walker_request_remove(int32_t request_id)
+{
+    uint32_t gap = walker_request_bucket(request_id);
+
+    while(walker_request_table[gap].column != NULL && walker_request_table[gap].request_id != request_id)
+        gap = (gap + 1) & walker_request_mask;
+
+    if(walker_request_table[gap].column == NULL)
+        return;
+
+    for(uint32_t bucket = (gap + 1) & walker_request_mask; walker_request_table[bucket].column != NULL; bucket = (bucket + 1) & walker_request_mask)
+    {
+        uint32_t home = walker_request_bucket(walker_request_table[bucket].request_id);
+
+        /// The entry may fill the gap if the gap lies between its home bucket and its bucket
+        if(((bucket - home) & walker_request_mask) >= ((bucket - gap) & walker_request_mask))
+        {
+            walker_request_table[gap] = walker_request_table[bucket];
+            gap = bucket;
+        }
+    }
+
+    walker_request_table[gap].column = NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Timers                                                                     */
+/* -------------------------------------------------------------------------- */
+
+static uint64_t walker_deadline(const walker_column_t *column)
+{
+    return column->sent_us + column->timeout_us;
+}
+
+static void walker_timer_swap(int a, int b)
+{
+    walker_column_t *column = walker_timer_heap[a];
+    walker_timer_heap[a] = walker_timer_heap[b];
+    walker_timer_heap[b] = column;
+    walker_timer_heap[a]->heap_index = a;
+    walker_timer_heap[b]->heap_index = b;
+}
+
+static void walker_timer_sift_up(int index)
+{
+    while(index > 0 && walker_deadline(walker_timer_heap[index]) < walker_deadline(walker_timer_heap[(index - 1) / 2]))
+    {
+        walker_timer_swap(index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+}
+
+static void walker_timer_sift_down(int index)
+{
+    while(true)
+    {
+        int smallest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+
+        if(left < walker_timer_count && walker_deadline(walker_timer_heap[left]) < walker_deadline(walker_timer_heap[smallest]))
+            smallest = left;
+        if(right < walker_timer_count && walker_deadline(walker_timer_heap[right]) < walker_deadline(walker_timer_heap[smallest]))
+            smallest = right;
+
+        if(smallest == index)
+            return;
+
+        walker_timer_swap(index, smallest);
+        index = smallest;
+    }
+}
+
+static void walker_timer_add(walker_column_t *column)
+{
+    column->heap_index = walker_timer_count;
+    walker_timer_heap[walker_timer_count++] = column;
+    walker_timer_sift_up(column->heap_index);
+}
+
+static void walker_timer_remove(walker_column_t *column)
+{
+    int index = column->heap_index;
+    if(index < 0)
+        return;
+
+    column->heap_index = -1;
+    walker_timer_count--;
+
+    if(index == walker_timer_count)
+        return;
+
+    walker_timer_heap[index] = walker_timer_heap[walker_timer_count];
+    walker_timer_heap[index]->heap_index = index;
+    walker_timer_sift_up(index);
+    walker_timer_sift_down(walker_timer_heap[index]->heap_index);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Walk                                                                       */
+/* -------------------------------------------------------------------------- */
+
+static int walker_parse_oid(const char *oid_str, uint32_t *oid)
+{
+    int oid_len = 0;
+    const char *pos = oid_str;
+
+    while(*pos != '\0')
+    {
+        if(*pos == '.')
+            pos++;
+
+        char *end;
+        unsigned long sub_id = strtoul(pos, &end, 10);
+        if(end == pos || oid_len >= SNMP_WALKER_MAX_OID_LEN || sub_id > UINT32_MAX)
+            return -1;
+
+        oid[oid_len++] = (uint32_t)sub_id;
+        pos = end;
+    }
+
+    return oid_len >= 2 ? oid_len : -1;
+}
+
+static int walker_oid_compare(const uint32_t *a, int a_len, const uint32_t *b, int b_len)
+{
+    int len = a_len < b_len ? a_len : b_len;
+
+    for(int i = 0; i < len; i++)
+    {
+        if(a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+
+    return a_len - b_len;
+}
+
+/**
+ * @brief Checks if an OID of the list is a column of the ifTable, which is only needed for Ethernet-like interfaces.
+ */
+static bool walker_is_selective(const char *oid_str)
+{
+    return strcmp(oid_str, IFMIB_ifSpeed) == 0 || strcmp(oid_str, IFMIB_ifPhysAddress) == 0
+        || strcmp(oid_str, IFMIB_ifOperStatus) == 0 || strcmp(oid_str, IFMIB_ifName) == 0;
+}
+
+/**
+ * @brief Sets the interfaces of the next GET of a selective column.
+ * @return false, if all interfaces have been read.
+ */
+static bool walker_column_batch(walker_column_t *column)
+{
+    int remaining = column->walk->if_index_list.size - column->instance_pos;
+    int batch_size = column->batch_size > 0 ? column->batch_size : column->walk->sizing.get_varbinds;
+
+    column->instance_count = remaining < batch_size ? remaining : batch_size;
+
+    return column->instance_count > 0;
+}
+
+static void walker_column_finish(walker_column_t *column)
+{
+    walker_walk_t *walk = column->walk;
+
+    /// Same as snmpwalk, which only prints the result of a GET on the root if the subtree is empty
+    if(column->count == 0 && !column->selective)
+    {
+        column->output_str = walker_cat_oid(column->output_str, column->root, column->root_len);
+        column->output_str = sdscat(column->output_str, " = No Such Object available on this agent at this OID\n");
+    }
+
+    column->state = WALKER_COLUMN_DONE;
+    walk->active_count--;
+    stats_record(STATS_PHASE_WALK_OID, stats_now_us() - column->start_us);
+
+    if(column != walk->if_type_column)
+        return;
+
+    /// The types of all interfaces are known, the selective columns start with the Ethernet-like ones
+    for(int i = 0; i < walk->column_count; i++)
+    {
+        walker_column_t *selective_column = &walk->column_list[i];
+        if(selective_column->state != WALKER_COLUMN_WAITING)
+            continue;
+
+        selective_column->state = WALKER_COLUMN_READY;
+        if(!walker_column_batch(selective_column))
+            walker_column_finish(selective_column);
+    }
+}
+
+/**
+ * @brief Builds the GET of the interfaces of a selective column in walker_get_request.
+ *
+ * If not all interfaces fit into a request, the rest is read with the next one.
+ *
+ * @return the length of the request.
+ */
+static size_t walker_column_encode_get(walker_column_t *column)
+{
+    walker_walk_t *walk = column->walk;
+
+    *walker_get_request = walk->get_template;
+    column->oid_len = column->root_len + 1;
+
+    for(int i = 0; i < column->instance_count; i++)
+    {
+        column->oid[column->root_len] = walk->if_index_list.data[column->instance_pos + i];
+
+        if(snmp_ber_template_add_oid(walker_get_request, column->oid, column->oid_len))
+        {
+            column->instance_count = i;
+            break;
+        }
+    }
+
+    snmp_ber_template_set_request_id(walker_get_request, column->request_id);
+
+    return walker_get_request->len;
+}
+
+/**
+ * @brief Builds the change-detection GET of a walk in walker_get_request.
+ * @return the length of the request.
+ */
+static size_t walker_gate_encode(walker_walk_t *walk)
+{
+    *walker_get_request = walk->get_template;
+
+    for(int i = 0; i < WALKER_GATE_OIDS; i++)
+        snmp_ber_template_add_oid(walker_get_request, walker_gate_oid_list[i], walker_gate_oid_len[i]);
+
+    snmp_ber_template_set_request_id(walker_get_request, walk->gate_column.request_id);
+
+    return walker_get_request->len;
+}
+
+/**
+ * @brief Hash of the roots of the columns, a plan is only used for the OID list it was recorded with.
+ */
+static uint32_t walker_plan_hash(const walker_walk_t *walk)
+{
+    uint32_t hash = 2166136261u;
+
+    for(int i = 0; i < walk->column_count; i++)
+    {
+        const walker_column_t *column = &walk->column_list[i];
+
+        hash = (hash ^ (uint32_t)column->root_len) * 16777619u;
+        for(int j = 0; j < column->root_len; j++)
+            hash = (hash ^ column->root[j]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Keeps the instance of an OID returned by a column for the plan of the next walks.
+ */
+static void walker_column_record(walker_column_t *column, const uint32_t *oid, int oid_len)
+{
+    if(!column->walk->record_plan)
+        return;
+
+    vec_push(&column->instance_data, (uint32_t)(oid_len - column->root_len));
+    for(int i = column->root_len; i < oid_len; i++)
+        vec_push(&column->instance_data, oid[i]);
+}
+
+/**
+ * @brief Collects the instances returned by the columns of a complete walk.
+ * @return the plan, its data is NULL if the walk doesn't record one.
+ */
+static walker_plan_t walker_plan_build(const walker_walk_t *walk)
+{
+    walker_plan_t plan = { NULL, 0 };
+
+    if(!walk->record_plan || walk->plan_broken)
+        return plan;
+
+    int len = 2 + walk->column_count;
+    for(int i = 0; i < walk->column_count; i++)
+        len += walk->column_list[i].instance_data.size;
+
+    plan.data = malloc(len * sizeof(uint32_t));
+    plan.data[plan.len++] = (uint32_t)walk->column_count;
+    plan.data[plan.len++] = walker_plan_hash(walk);
+
+    for(int i = 0; i < walk->column_count; i++)
+    {
+        const walker_column_t *column = &walk->column_list[i];
+
+        plan.data[plan.len++] = (uint32_t)column->count;
+        memcpy(plan.data + plan.len, column->instance_data.data, column->instance_data.size * sizeof(uint32_t));
+        plan.len += column->instance_data.size;
+    }
+
+    return plan;
+}
+
+/**
+ * @brief Builds the OID of an entry of the plan of a walk.
+ * @return the length of the OID.
+ */
+static int walker_plan_oid(const walker_walk_t *walk, const walker_plan_entry_t *entry, uint32_t *oid)
+{
+    const walker_column_t *column = &walk->column_list[entry->column_index];
+    const uint32_t *instance = &walk->plan_data.data[entry->instance_pos];
+
+    memcpy(oid, column->root, column->root_len * sizeof(uint32_t));
+    memcpy(oid + column->root_len, instance + 1, instance[0] * sizeof(uint32_t));
+
+    return column->root_len + (int)instance[0];
+}
+
+/**
+ * @brief Sets the entries of the next GET of a plan column: up to batch_size OIDs and the columns without instances
+ * between them.
+ *
+ * @return false, if all entries of the column have been read.
+ */
+static bool walker_plan_batch(walker_column_t *column)
+{
+    const walker_plan_entry_t *entry_list = column->walk->plan_entry_list.data;
+    int end = column->instance_pos;
+    int count = 0;
+
+    while(end < column->instance_end && (count < column->batch_size || entry_list[end].instance_pos < 0))
+    {
+        count += entry_list[end].instance_pos >= 0;
+        end++;
+    }
+
+    column->instance_count = end - column->instance_pos;
+
+    return column->instance_count > 0;
+}
+
+static void walker_plan_add_column(walker_walk_t *walk, int first, int end, int varbind_count)
+{
+    walker_column_t *column = vec_push_slot(&walk->plan_column_list);
+
+    memset(column, 0, sizeof(walker_column_t));
+    column->walk = walk;
+    column->heap_index = -1;
+    column->planned = true;
+    column->instance_pos = first;
+    column->instance_end = end;
+    column->batch_size = varbind_count;
+    column->output_str = sdsempty();
+    walker_plan_batch(column);
+
+    walk->plan_active_count++;
+}
+
+/**
+ * @brief Splits the OIDs of the plan of a walk into GETs, as many as fit into a request with at most the learned
+ * number of OIDs of the agent each. Uses walker_get_request.
+ *
+ * @return false, if an OID doesn't fit into a request or the plan has no OIDs.
+ */
+static bool walker_plan_pack(walker_walk_t *walk)
+{
+    uint32_t oid[SNMP_WALKER_MAX_OID_LEN];
+    int first = 0;
+    int varbind_count = 0;
+
+    *walker_get_request = walk->get_template;
+
+    for(int i = 0; i < walk->plan_entry_list.size; i++)
+    {
+        const walker_plan_entry_t *entry = &walk->plan_entry_list.data[i];
+        if(entry->instance_pos < 0)
+            continue;
+
+        int oid_len = walker_plan_oid(walk, entry, oid);
+
+        if(varbind_count == walk->sizing.get_varbinds || snmp_ber_template_add_oid(walker_get_request, oid, oid_len))
+        {
+            if(varbind_count == 0)
+                return false;
+
+            walker_plan_add_column(walk, first, i, varbind_count);
+            first = i;
+            varbind_count = 0;
+
+            *walker_get_request = walk->get_template;
+            if(snmp_ber_template_add_oid(walker_get_request, oid, oid_len))
+                return false;
+        }
+
+        varbind_count++;
+    }
+
+    if(varbind_count == 0)
+        return false;
+
+    walker_plan_add_column(walk, first, walk->plan_entry_list.size, varbind_count);
+
+    return true;
+}
+
+static void walker_plan_free(walker_walk_t *walk)
+{
+    walker_column_t *column;
+
+    vec_each(&walk->plan_column_list, column)
+        sdsfree(column->output_str);
+
+    vec_free(&walk->plan_column_list);
+    vec_free(&walk->plan_entry_list);
+    vec_free(&walk->plan_data);
+    walk->plan_active_count = 0;
+}
+
+/**
+ * @brief Prepares the GETs of the instances returned by the last complete walk of the agent, runs in the event thread.
+ *
+ * The GETs of the plan replace the GETNEXTs of the columns, one GET reads the rows of several columns.
+ *
+ * @return false, if the agent has no plan for the OID list of the walk. The columns are walked then.
+ */
+static bool walker_plan_load(walker_walk_t *walk)
+{
+    pthread_mutex_lock(&walker_agent_mutex);
+    int slot = walker_agent_table != NULL ? host_table_find_slot(walker_agent_table, walk->host) : -1;
+    if(slot >= 0)
+    {
+        const walker_plan_t *plan = &walker_agent_list.data[slot].plan;
+
+        vec_reserve(&walk->plan_data, plan->len);
+        memcpy(walk->plan_data.data, plan->data, plan->len * sizeof(uint32_t));
+        walk->plan_data.size = plan->len;
+    }
+    pthread_mutex_unlock(&walker_agent_mutex);
+
+    const uint32_t *data = walk->plan_data.data;
+    int len = walk->plan_data.size;
+    int pos = 2;
+
+    if(len < 2 || data[0] != (uint32_t)walk->column_count || data[1] != walker_plan_hash(walk))
+    {
+        walker_plan_free(walk);
+        return false;
+    }
+
+    for(int i = 0; i < walk->column_count; i++)
+    {
+        uint32_t count = data[pos++];
+
+        for(uint32_t j = 0; j < (count > 0 ? count : 1); j++)
+        {
+            walker_plan_entry_t *entry = vec_push_slot(&walk->plan_entry_list);
+            entry->column_index = i;
+            entry->instance_pos = count > 0 ? pos : -1;
+
+            if(count > 0)
+                pos += 1 + data[pos];
+        }
+    }
+
+    if(!walker_plan_pack(walk))
+    {
+        walker_plan_free(walk);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Builds the next GET of a plan column in walker_get_request.
+ * @return the length of the request.
+ */
+static size_t walker_plan_encode(walker_column_t *column)
+{
+    walker_walk_t *walk = column->walk;
+
+    *walker_get_request = walk->get_template;
+
+    for(int i = column->instance_pos; i < column->instance_pos + column->instance_count; i++)
+    {
+        const walker_plan_entry_t *entry = &walk->plan_entry_list.data[i];
+
+        /// Fits, walker_plan_pack has built the same request
+        if(entry->instance_pos >= 0)
+        {
+            column->oid_len = walker_plan_oid(walk, entry, column->oid);
+            snmp_ber_template_add_oid(walker_get_request, column->oid, column->oid_len);
+        }
+    }
+
+    snmp_ber_template_set_request_id(walker_get_request, column->request_id);
+
+    return walker_get_request->len;
+}
+
+static void walker_template_init(const walker_walk_t *walk, snmp_ber_template_t *template, uint8_t pdu_type, int max_repetitions)
+{
+    const snmp_credential_t *credential = walk->credential;
+
+    snmp_ber_template_init(template, pdu_type, credential->version == SNMP_VERSION_1 ? 0 : 1,
+        credential->community_str, sdslen(credential->community_str), 0, max_repetitions);
+}
+
+/**
+ * @brief Builds the GETNEXT of a column in walker_request, a GETBULK with the learned max-repetitions of the agent
+ * for SNMPv2c.
+ *
+ * @return the length of the request.
+ */
+static size_t walker_column_encode_next(walker_column_t *column)
+{
+    walker_walk_t *walk = column->walk;
+
+    if(walk->bulk && walk->request_repetitions != walk->sizing.repetitions)
+    {
+        walker_template_init(walk, &walk->request_template, SNMP_PDU_GETBULK, walk->sizing.repetitions);
+        walk->request_repetitions = walk->sizing.repetitions;
+    }
+
+    column->repetitions = walk->request_repetitions;
+
+    return snmp_ber_template_encode(&walk->request_template, column->request_id, column->oid, column->oid_len, walker_request);
+}
+
+/**
+ * @brief Sends the request of a column, again with the same request-id after a timeout.
+ */
+static void walker_column_send(walker_column_t *column)
+{
+    walker_walk_t *walk = column->walk;
+    const uint8_t *request = walker_request;
+    size_t request_len;
+
+    if(column == &walk->gate_column)
+    {
+        request_len = walker_gate_encode(walk);
+        request = walker_get_request->data;
+    }
+    else if(column->planned)
+    {
+        request_len = walker_plan_encode(column);
+        request = walker_get_request->data;
+    }
+    else if(column->selective)
+    {
+        request_len = walker_column_encode_get(column);
+        request = walker_get_request->data;
+    }
+    else
+    {
+        request_len = walker_column_encode_next(column);
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(SNMP_WALKER_PORT);
+    address.sin_addr.s_addr = htonl(walk->host);
+
+    /// A lost request is sent again after the timeout
+    sendto(walk->socket_fd, request, request_len, 0, (struct sockaddr *)&address, sizeof(address));
+
+    column->state = WALKER_COLUMN_IN_FLIGHT;
+    column->sent_us = stats_now_us();
+    column->timeout_us = walk->rtt.rto_us;
+
+    /// The last retry ends at the deadline of the request
+    uint64_t request_end_us = column->request_us + SNMP_WALKER_REQUEST_DEADLINE_MS * 1000ULL;
+    if(column->sent_us + column->timeout_us > request_end_us)
+        column->timeout_us = request_end_us > column->sent_us ? request_end_us - column->sent_us : 0;
+
+    walker_timer_add(column);
+}
+
+/**
+ * @brief Handles the response to the GETNEXT or GETBULK of a column, the column is ready for the next request or done.
+ *
+ * The varbinds of a GETBULK behind the end of the column belong to the next columns and are dropped, like
+ * snmpbulkwalk does.
+ */
+static void walker_column_response(walker_column_t *column, snmp_ber_pdu_t *pdu)
+{
+    walker_walk_t *walk = column->walk;
+    snmp_ber_varbind_t varbind;
+    uint32_t oid[SNMP_WALKER_MAX_OID_LEN];
+    int count = 0;
+
+    column->state = WALKER_COLUMN_READY;
+    column->retries = 0;
+
+    /// Some agents answer tooBig instead of returning fewer repetitions, the request is sent again with fewer
+    if(pdu->error_status == SNMP_ERROR_TOO_BIG && column->repetitions > 1)
+    {
+        walker_size_shrink(&walk->sizing.repetitions, &walk->sizing.repetitions_threshold, column->repetitions / 2);
+        return;
+    }
+
+    /// SNMPv1 agents answer noSuchName at the end of the MIB
+    while(pdu->error_status == 0 && snmp_ber_next_varbind(pdu, &varbind) == 1)
+    {
+        int oid_len = snmp_ber_decode_oid(varbind.oid, varbind.oid_len, oid);
+        if(oid_len < 0 || varbind.tag == SNMP_BER_END_OF_MIB_VIEW || oid_len <= column->root_len
+            || memcmp(oid, column->root, column->root_len * sizeof(uint32_t)) != 0)
+        {
+            walker_column_finish(column);
+            return;
+        }
+
+        if(walker_oid_compare(oid, oid_len, column->oid, column->oid_len) <= 0)
+        {
+            column->output_str = walker_cat_oid(sdscat(column->output_str, "Error: OID not increasing: "), column->oid, column->oid_len);
+            column->output_str = walker_cat_oid(sdscat(column->output_str, "\n >= "), oid, oid_len);
+            column->output_str = sdscat(column->output_str, "\n");
+            walk->plan_broken = true;
+            walker_column_finish(column);
+            return;
+        }
+
+        column->output_str = walker_cat_oid(column->output_str, oid, oid_len);
+        column->output_str = sdscat(column->output_str, " = ");
+        column->output_str = walker_cat_value(column->output_str, oid, oid_len, varbind.tag, varbind.value, varbind.value_len);
+        column->output_str = sdscat(column->output_str, "\n");
+
+        memcpy(column->oid, oid, oid_len * sizeof(uint32_t));
+        column->oid_len = oid_len;
+        column->count++;
+        walker_column_record(column, oid, oid_len);
+        count++;
+
+        if(column == walk->if_type_column && oid_len == column->root_len + 1 && varbind.tag == SNMP_BER_INTEGER
+            && snmp_oid_is_ethernet_if_type((int)snmp_ber_decode_unsigned(varbind.value, varbind.value_len)))
+        {
+            vec_push(&walk->if_index_list, oid[column->root_len]);
+        }
+    }
+
+    if(count == 0)
+    {
+        walker_column_finish(column);
+        return;
+    }
+
+    /// All varbinds belong to the column, so the answer shows how many repetitions the agent can return
+    if(column->repetitions > 0)
+        walker_size_adjust(walk, &walk->sizing.repetitions, &walk->sizing.repetitions_threshold, walk->policy.repetitions, column->repetitions, count);
+}
+
+/**
+ * @brief Handles the response to the GET of a selective column, the column is ready for the next GET or done.
+ */
+static void walker_column_get_response(walker_column_t *column, snmp_ber_pdu_t *pdu)
+{
+    snmp_ber_varbind_t varbind;
+    uint32_t oid[SNMP_WALKER_MAX_OID_LEN];
+
+    column->state = WALKER_COLUMN_READY;
+    column->retries = 0;
+
+    if(pdu->error_status == SNMP_ERROR_TOO_BIG && column->instance_count > 1)
+    {
+        walker_size_shrink(&column->walk->sizing.get_varbinds, &column->walk->sizing.get_threshold, column->instance_count / 2);
+        walker_column_batch(column);
+        return;
+    }
+
+    /// noSuchName of SNMPv1 if one interface is missing: the interfaces are read one by one, an interface which fails
+    /// on its own is skipped
+    if(pdu->error_status != 0 && column->instance_count > 1)
+    {
+        column->batch_size = 1;
+        column->instance_count = 1;
+        return;
+    }
+
+    if(pdu->error_status == 0 && column->batch_size == 0)
+    {
+        walker_size_adjust(column->walk, &column->walk->sizing.get_varbinds, &column->walk->sizing.get_threshold,
+            SNMP_WALKER_MAX_GET_VARBINDS, column->instance_count, column->instance_count);
+    }
+
+    while(pdu->error_status == 0 && snmp_ber_next_varbind(pdu, &varbind) == 1)
+    {
+        /// Interfaces removed since the ifType column was read are left out, like a walk wouldn't return them
+        int oid_len = snmp_ber_decode_oid(varbind.oid, varbind.oid_len, oid);
+        if(oid_len != column->root_len + 1 || memcmp(oid, column->root, column->root_len * sizeof(uint32_t)) != 0
+            || varbind.tag == SNMP_BER_NO_SUCH_OBJECT || varbind.tag == SNMP_BER_NO_SUCH_INSTANCE || varbind.tag == SNMP_BER_END_OF_MIB_VIEW)
+        {
+            continue;
+        }
+
+        column->output_str = walker_cat_oid(column->output_str, oid, oid_len);
+        column->output_str = sdscat(column->output_str, " = ");
+        column->output_str = walker_cat_value(column->output_str, oid, oid_len, varbind.tag, varbind.value, varbind.value_len);
+        column->output_str = sdscat(column->output_str, "\n");
+        column->count++;
+        walker_column_record(column, oid, oid_len);
+    }
+
+    column->instance_pos += column->instance_count;
+
+    if(!walker_column_batch(column))
+        walker_column_finish(column);
+}
+
+/**
+ * @brief Handles the answer to the change-detection GET, skips the columns if the agent reports no change.
+ *
+ * The tables of the agent are unchanged if it hasn't rebooted (sysUpTime didn't go back) and ifTableLastChange and
+ * lldpStatsRemTablesLastChangeTime are the same as before its last complete walk. Agents without one of these objects
+ * are always walked. The tables still have the same rows after SNMP_WALKER_GATE_MAX_AGE_S, if the policy of the
+ * agent doesn't skip walks or after a trap, their values are read with the plan of the last complete walk then.
+ * Many agents don't update ifTableLastChange when an ifOperStatus changes, a linkDown or linkUp trap would be missed.
+ */
+static void walker_gate_response(walker_walk_t *walk, snmp_ber_pdu_t *pdu)
+{
+    snmp_ber_varbind_t varbind;
+    const walker_gate_t *cached = &walk->gate_cached;
+    int count = 0;
+
+    walk->gate_column.state = WALKER_COLUMN_DONE;
+
+    while(pdu->error_status == 0 && count < WALKER_GATE_OIDS && snmp_ber_next_varbind(pdu, &varbind) == 1 && varbind.tag == SNMP_BER_TIMETICKS)
+        walk->gate.ticks[count++] = (uint32_t)snmp_ber_decode_unsigned(varbind.value, varbind.value_len);
+
+    walk->gate.valid = count == WALKER_GATE_OIDS;
+    walk->gate.read_us = walk->gate_column.sent_us;
+
+    if(!walk->gate.valid || !cached->valid || walk->gate.ticks[0] < cached->ticks[0]
+        || walk->gate.ticks[1] != cached->ticks[1] || walk->gate.ticks[2] != cached->ticks[2])
+    {
+        return;
+    }
+
+    if(walk->trap || !walk->policy.gate || walk->gate.read_us - cached->read_us > SNMP_WALKER_GATE_MAX_AGE_S * 1000000ULL)
+    {
+        walker_plan_load(walk);
+        return;
+    }
+
+    walk->unchanged = true;
+    stats_count(STATS_COUNTER_UNCHANGED, 1);
+
+    /// No column has sent a request yet
+    for(int i = 0; i < walk->column_count; i++)
+        walk->column_list[i].state = WALKER_COLUMN_DONE;
+    walk->active_count = 0;
+}
+
+/**
+ * @brief Prepares the walk of an OID list, runs in the thread of the caller.
+ */
+static walker_walk_t *walker_walk_init(const snmp_credential_t *credential, ipv4_t host_ip, oid_vec_t *oid_list, bool gate, bool trap, snmp_walker_done_fn done_fn, void *param)
+{
+    walker_walk_t *walk = calloc(1, sizeof(walker_walk_t));
+    walker_agent_t agent = walker_agent_get(host_ip);
+    walk->host = host_ip;
+    walk->credential = credential;
+    walk->socket_fd = walker_socket_list[host_ip % SNMP_WALKER_SOCKETS];
+    walk->rtt = agent.rtt;
+    walk->sizing = agent.sizing;
+    walk->gate_cached = agent.gate;
+    walk->policy = (snmp_policy_t){ walker_window, walker_rate, SNMP_WALKER_BURST, 1, SNMP_WALKER_MAX_REPETITIONS, walker_deadline_s };
+    snmp_policy_for_host(host_ip, &walk->policy);
+    walk->bulk = credential->version != SNMP_VERSION_1 && walk->policy.repetitions > 0;
+    if(walk->sizing.repetitions > walk->policy.repetitions)
+        walk->sizing.repetitions = walk->policy.repetitions;
+    walk->gate_column.walk = walk;
+    walk->gate_column.heap_index = -1;
+    walk->gate_column.state = gate ? WALKER_COLUMN_READY : WALKER_COLUMN_DONE;
+    walk->deadline_timer.walk = walk;
+    walk->deadline_timer.heap_index = -1;
+    walk->deadline_timer.state = WALKER_COLUMN_DONE;
+    walk->record_plan = gate;
+    walk->trap = trap;
+    walker_template_init(walk, &walk->request_template, SNMP_PDU_GETNEXT, 0);
+    walker_template_init(walk, &walk->get_template, SNMP_PDU_GET, 0);
+    vec_init(&walk->if_index_list);
+    vec_init(&walk->plan_data);
+    vec_init(&walk->plan_entry_list);
+    vec_init(&walk->plan_column_list);
+    walk->column_count = oid_list->size;
+    walk->column_list = calloc(oid_list->size > 0 ? oid_list->size : 1, sizeof(walker_column_t));
+    walk->root_data = malloc((oid_list->size > 0 ? oid_list->size : 1) * SNMP_WALKER_MAX_OID_LEN * sizeof(uint32_t));
+    walk->return_str = sdsempty();
+    walk->done_fn = done_fn;
+    walk->param = param;
+
+    for(int i = 0; i < walk->column_count; i++)
+    {
+        walker_column_t *column = &walk->column_list[i];
+        uint32_t *root = walk->root_data + i * SNMP_WALKER_MAX_OID_LEN;
+
+        column->walk = walk;
+        column->heap_index = -1;
+        column->output_str = sdsempty();
+        column->root = root;
+        column->root_len = walker_parse_oid(oid_list->data[i], root);
+
+        if(column->root_len < 0)
+        {
+            printf(KRED "[ERROR] snmp_walker_submit can't parse the OID %s\n" KNORMAL, oid_list->data[i]);
+            column->state = WALKER_COLUMN_DONE;
+            continue;
+        }
+
+        memcpy(column->oid, root, column->root_len * sizeof(uint32_t));
+        column->oid_len = column->root_len;
+        walk->active_count++;
+
+        if(strcmp(oid_list->data[i], IFMIB_ifType) == 0)
+            walk->if_type_column = column;
+    }
+
+    /// Walking ifSpeed, ifPhysAddress, ifOperStatus and ifName would return VLAN interfaces, loopbacks and tunnels,
+    /// which outnumber the ports on some switches. They wait for ifType and only read the Ethernet-like interfaces.
+    for(int i = 0; walk->if_type_column != NULL && i < walk->column_count; i++)
+    {
+        walker_column_t *column = &walk->column_list[i];
+
+        if(column->state == WALKER_COLUMN_READY && walker_is_selective(oid_list->data[i]))
+        {
+            column->selective = true;
+            column->state = WALKER_COLUMN_WAITING;
+            column->batch_size = 0;
+        }
+    }
+
+    return walk;
+}
+
+static void walker_walk_free(walker_walk_t *walk)
+{
+    for(int i = 0; i < walk->column_count; i++)
+    {
+        sdsfree(walk->column_list[i].output_str);
+        vec_free(&walk->column_list[i].instance_data);
+    }
+
+    sdsfree(walk->return_str);
+    vec_free(&walk->if_index_list);
+    walker_plan_free(walk);
+    free(walk->column_list);
+    free(walk->root_data);
+    free(walk);
+}
+
+/**
+ * @brief Drops the request of a column of an agent which stopped responding.
+ */
+static void walker_column_drop(walker_column_t *column)
+{
+    if(column->state == WALKER_COLUMN_IN_FLIGHT)
+    {
+        walker_request_remove(column->request_id);
+        walker_timer_remove(column);
+        column->state = WALKER_COLUMN_DONE;
+    }
+    else if(column->state == WALKER_COLUMN_PACED)
+    {
+        walker_timer_remove(column);
+        column->state = WALKER_COLUMN_DONE;
+    }
+}
+
+/**
+ * @brief Drops the plan of a walk whose agent returned other instances, the columns are walked and record a new plan.
+ */
+static void walker_plan_drop(walker_walk_t *walk)
+{
+    walker_column_t *column;
+
+    vec_each(&walk->plan_column_list, column)
+    {
+        if(column->state == WALKER_COLUMN_IN_FLIGHT)
+            walk->in_flight_count--;
+        if(walk->paced_column == column)
+            walk->paced_column = NULL;
+
+        walker_column_drop(column);
+        column->state = WALKER_COLUMN_DONE;
+    }
+
+    walk->plan_active_count = 0;
+}
+
+static void walker_plan_finish(walker_column_t *column)
+{
+    walker_walk_t *walk = column->walk;
+
+    column->state = WALKER_COLUMN_DONE;
+    if(--walk->plan_active_count > 0)
+        return;
+
+    /// No column has sent a request yet
+    walk->planned = true;
+    for(int i = 0; i < walk->column_count; i++)
+        walk->column_list[i].state = WALKER_COLUMN_DONE;
+    walk->active_count = 0;
+
+    stats_count(STATS_COUNTER_PLANNED, 1);
+}
+
+/**
+ * @brief Handles the response to a GET of a plan column, the column is ready for the next GET or done.
+ *
+ * An instance of the plan which the agent doesn't return anymore drops the plan, the columns are walked then.
+ */
+static void walker_plan_response(walker_column_t *column, snmp_ber_pdu_t *pdu)
+{
+    walker_walk_t *walk = column->walk;
+    snmp_ber_varbind_t varbind;
+    uint32_t oid[SNMP_WALKER_MAX_OID_LEN];
+    bool matched = pdu->error_status == 0;
+
+    column->state = WALKER_COLUMN_READY;
+    column->retries = 0;
+
+    /// The response doesn't fit into a message of the agent, the rest of the column is read with smaller GETs
+    if(pdu->error_status == SNMP_ERROR_TOO_BIG && column->batch_size > 1)
+    {
+        column->batch_size /= 2;
+        walker_size_shrink(&walk->sizing.get_varbinds, &walk->sizing.get_threshold, column->batch_size);
+        walker_plan_batch(column);
+        return;
+    }
+
+    int varbind_count = 0;
+
+    for(int i = column->instance_pos; matched && i < column->instance_pos + column->instance_count; i++)
+    {
+        const walker_plan_entry_t *entry = &walk->plan_entry_list.data[i];
+        const walker_column_t *walk_column = &walk->column_list[entry->column_index];
+
+        /// Same as walker_column_finish
+        if(entry->instance_pos < 0)
+        {
+            if(!walk_column->selective && walk_column->root_len >= 0)
+            {
+                column->output_str = walker_cat_oid(column->output_str, walk_column->root, walk_column->root_len);
+                column->output_str = sdscat(column->output_str, " = No Such Object available on this agent at this OID\n");
+            }
+            continue;
+        }
+
+        column->oid_len = walker_plan_oid(walk, entry, column->oid);
+        varbind_count++;
+
+        matched = snmp_ber_next_varbind(pdu, &varbind) == 1
+            && varbind.tag != SNMP_BER_NO_SUCH_OBJECT && varbind.tag != SNMP_BER_NO_SUCH_INSTANCE && varbind.tag != SNMP_BER_END_OF_MIB_VIEW
+            && snmp_ber_decode_oid(varbind.oid, varbind.oid_len, oid) == column->oid_len
+            && memcmp(oid, column->oid, column->oid_len * sizeof(uint32_t)) == 0;
+
+        if(matched)
+        {
+            column->output_str = walker_cat_oid(column->output_str, oid, column->oid_len);
+            column->output_str = sdscat(column->output_str, " = ");
+            column->output_str = walker_cat_value(column->output_str, oid, column->oid_len, varbind.tag, varbind.value, varbind.value_len);
+            column->output_str = sdscat(column->output_str, "\n");
+        }
+    }
+
+    if(!matched)
+    {
+        walker_plan_drop(walk);
+        return;
+    }
+
+    walker_size_adjust(walk, &walk->sizing.get_varbinds, &walk->sizing.get_threshold, SNMP_WALKER_MAX_GET_VARBINDS, varbind_count, varbind_count);
+
+    column->instance_pos += column->instance_count;
+
+    if(!walker_plan_batch(column))
+        walker_plan_finish(column);
+}
+
+/**
+ * @brief Checks if a GET of the plan of a walk which was cut off hasn't read all instances of a column yet.
+ */
+static bool walker_plan_unread(const walker_walk_t *walk, int column_index)
+{
+    walker_column_t *plan_column;
+
+    vec_each(&walk->plan_column_list, plan_column)
+    {
+        for(int i = plan_column->instance_pos; i < plan_column->instance_end; i++)
+        {
+            if(walk->plan_entry_list.data[i].column_index == column_index)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Collects the output of a finished walk and hands it to the delivery thread.
+ *
+ * A walk cut off by a timeout or its deadline keeps the rows read until then, also those read with the plan. Each
+ * column which wasn't read completely gets a line "<OID> = Incomplete: <reason>", so the rows of the last walk which
+ * are missing now aren't taken as removed.
+ */
+static void walker_walk_finish(walker_walk_t *walk)
+{
+    walker_column_t *plan_column;
+    /// The GETs of the plan were still running, the columns haven't sent a request
+    bool plan_cut_off = walk->plan_active_count > 0;
+
+    walker_column_drop(&walk->gate_column);
+    walker_timer_remove(&walk->deadline_timer);
+
+    vec_each(&walk->plan_column_list, plan_column)
+    {
+        walker_column_drop(plan_column);
+
+        /// The columns are empty then
+        if(walk->planned || plan_cut_off)
+        {
+            walk->return_str = sdscatsds(walk->return_str, plan_column->output_str);
+            stats_count(STATS_COUNTER_BYTES_RECEIVED, sdslen(plan_column->output_str));
+        }
+    }
+
+    const char *reason_str = walk->deadline_exceeded ? "Deadline Exceeded" : "No Response";
+    bool incomplete = false;
+
+    for(int i = 0; i < walk->column_count; i++)
+    {
+        walker_column_t *column = &walk->column_list[i];
+        bool column_incomplete = plan_cut_off ? walker_plan_unread(walk, i) : column->state != WALKER_COLUMN_DONE;
+
+        walker_column_drop(column);
+
+        walk->return_str = sdscatsds(walk->return_str, column->output_str);
+        stats_count(STATS_COUNTER_BYTES_RECEIVED, sdslen(column->output_str));
+
+        if(column_incomplete)
+        {
+            walk->return_str = walker_cat_oid(walk->return_str, column->root, column->root_len);
+            walk->return_str = sdscatprintf(walk->return_str, " = " SNMP_OID_INCOMPLETE ": %s\n", reason_str);
+            incomplete = true;
+        }
+    }
+
+    if(incomplete)
+        stats_count(STATS_COUNTER_INCOMPLETE, 1);
+
+    /// The other OIDs would time out as well, snmpwalk prints this once per OID
+    if(walk->timed_out)
+    {
+        sds host_ip_str = str_from_ipv4(walk->host);
+        walk->return_str = sdscatprintf(walk->return_str, "Timeout: No Response from %s\n", host_ip_str);
+        sdsfree(host_ip_str);
+    }
+
+    /// A walk read with the plan keeps the plan, a complete walk replaces it
+    bool complete = walk->gate.valid && !walk->timed_out && !walk->deadline_exceeded && !walk->unchanged;
+    walker_plan_t plan = complete && !walk->planned ? walker_plan_build(walk) : (walker_plan_t){ NULL, 0 };
+    walker_agent_put(walk->host, &walk->rtt, &walk->sizing, complete ? &walk->gate : NULL, complete && !walk->planned ? &plan : NULL);
+
+    pthread_mutex_lock(&walker_mutex);
+    walk->next = NULL;
+    if(walker_done_tail != NULL)
+        walker_done_tail->next = walk;
+    else
+        walker_done_head = walk;
+    walker_done_tail = walk;
+    pthread_cond_signal(&walker_done_ready);
+    pthread_mutex_unlock(&walker_mutex);
+}
+
+/**
+ * @brief Adds the tokens of the time since the last refill to the bucket of the agent of a walk.
+ */
+static walker_bucket_t *walker_bucket_refill(walker_walk_t *walk, uint64_t now_us)
+{
+    walker_bucket_t *bucket = &walker_bucket_list.data[walk->bucket_slot];
+
+    bucket->tokens += (now_us - bucket->refill_us) * (double)walk->policy.rate / 1e6;
+    if(bucket->tokens > walk->policy.burst)
+        bucket->tokens = walk->policy.burst;
+    bucket->refill_us = now_us;
+
+    return bucket;
+}
+
+/**
+ * @brief Takes a token of the agent of a walk for a request.
+ *
+ * @param force takes the token even if the bucket is empty, e.g. for a request sent again. Later requests wait longer.
+ * @return the microseconds until a token is available, 0 if the token has been taken.
+ */
+static uint64_t walker_bucket_take(walker_walk_t *walk, bool force)
+{
+    if(walk->policy.rate <= 0)
+        return 0;
+
+    walker_bucket_t *bucket = walker_bucket_refill(walk, stats_now_us());
+
+    if(bucket->tokens < 1 && !force)
+        return (uint64_t)((1 - bucket->tokens) * 1e6 / walk->policy.rate) + 1;
+
+    bucket->tokens -= 1;
+    return 0;
+}
+
+/**
+ * @brief Looks up the token bucket of the agent of a walk, a new agent starts with a full bucket.
+ */
+static void walker_bucket_attach(walker_walk_t *walk)
+{
+    walk->bucket_slot = host_table_find_slot(walker_bucket_table, walk->host);
+
+    if(walk->bucket_slot < 0)
+    {
+        walker_bucket_t bucket = { walk->policy.burst, stats_now_us() };
+
+        host_table_insert(walker_bucket_table, walk->host);
+        vec_push(&walker_bucket_list, bucket);
+        walk->bucket_slot = walker_bucket_list.size - 1;
+    }
+}
+
+/**
+ * @brief Sends the first request of a column. If the agent has no token left, the column waits in the timer heap
+ * until the bucket has been refilled.
+ *
+ * @return false, if the column waits for a token.
+ */
+static bool walker_column_start(walker_column_t *column)
+{
+    walker_walk_t *walk = column->walk;
+
+    uint64_t wait_us = walker_bucket_take(walk, false);
+    if(wait_us > 0)
+    {
+        column->state = WALKER_COLUMN_PACED;
+        column->sent_us = stats_now_us();
+        column->timeout_us = wait_us;
+        walker_timer_add(column);
+        walk->paced_column = column;
+        stats_count(STATS_COUNTER_PACED, 1);
+        return false;
+    }
+
+    column->request_id = snmp_ber_request_id(atomic_fetch_add(&walker_next_request_id, 1));
+    column->request_us = stats_now_us();
+    walker_request_insert(column);
+    walker_column_send(column);
+    walk->in_flight_count++;
+
+    return true;
+}
+
+/**
+ * @brief Sends requests of the columns in the order of the list until the window is full.
+ */
+static void walker_walk_fill(walker_walk_t *walk)
+{
+    /// The columns wait for the answer to the change-detection GET
+    if(walk->gate_column.state != WALKER_COLUMN_DONE)
+    {
+        if(walk->gate_column.state == WALKER_COLUMN_READY)
+            walker_column_start(&walk->gate_column);
+        return;
+    }
+
+    for(int i = 0; walk->paced_column == NULL && i < walk->plan_column_list.size && walk->in_flight_count < walk->policy.window; i++)
+    {
+        walker_column_t *column = &walk->plan_column_list.data[i];
+
+        if(column->state == WALKER_COLUMN_READY && !walker_column_start(column))
+            break;
+    }
+
+    /// The columns wait for the GETs of the plan
+    if(walk->plan_active_count > 0)
+        return;
+
+    for(int i = 0; walk->paced_column == NULL && i < walk->column_count && walk->in_flight_count < walk->policy.window; i++)
+    {
+        walker_column_t *column = &walk->column_list[i];
+
+        if(column->state == WALKER_COLUMN_READY && !walker_column_start(column))
+            break;
+    }
+
+    if(walk->active_count == 0)
+        walker_walk_finish(walk);
+}
+
+/**
+ * @brief Reads the responses of a socket and advances the walks they belong to.
+ */
+static void walker_receive(int socket_fd)
+{
+    for(int count = 0; count < WALKER_RECEIVE_BATCH; count++)
+    {
+        struct sockaddr_in address;
+        socklen_t address_len = sizeof(address);
+        ssize_t len = recvfrom(socket_fd, walker_packet, WALKER_MAX_PACKET, MSG_DONTWAIT, (struct sockaddr *)&address, &address_len);
+
+        if(len < 0)
+            return;
+
+        snmp_ber_pdu_t pdu;
+        if(!snmp_ber_decode_pdu(walker_packet, (size_t)len, &pdu) || pdu.pdu_type != SNMP_PDU_RESPONSE)
+            continue;
+
+        /// Late answers to requests of finished walks don't match anymore
+        walker_column_t *column = walker_request_find(pdu.request_id);
+        if(column == NULL || ntohl(address.sin_addr.s_addr) != column->walk->host || ntohs(address.sin_port) != SNMP_WALKER_PORT)
+            continue;
+
+        walker_walk_t *walk = column->walk;
+        walker_request_remove(pdu.request_id);
+        walker_timer_remove(column);
+        walk->in_flight_count--;
+
+        /// Karn's algorithm: the response to a request sent several times can't be timed
+        walk->sample_us = column->retries == 0 ? stats_now_us() - column->sent_us : 0;
+        if(column->retries == 0)
+            walker_rtt_sample(&walk->rtt, walk->sample_us);
+
+        if(column == &walk->gate_column)
+            walker_gate_response(walk, &pdu);
+        else if(column->planned)
+            walker_plan_response(column, &pdu);
+        else if(column->selective)
+            walker_column_get_response(column, &pdu);
+        else
+            walker_column_response(column, &pdu);
+        walker_walk_fill(walk);
+    }
+}
+
+/**
+ * @brief Sends requests again whose timeout expired, gives up on the agent after SNMP_WALKER_RETRIES or
+ * SNMP_WALKER_REQUEST_DEADLINE_MS. Finishes the walks whose deadline expired.
+ *
+ * The timeout of the agent doubles once per timeout, not once per request of the window that timed out. Agents may
+ * drop requests with large answers, so the learned size of the requests is halved as well.
+ */
+static void walker_expire_timers(void)
+{
+    uint64_t now_us = stats_now_us();
+
+    while(walker_timer_count > 0 && walker_deadline(walker_timer_heap[0]) <= now_us)
+    {
+        walker_column_t *column = walker_timer_heap[0];
+        walker_walk_t *walk = column->walk;
+
+        walker_timer_remove(column);
+
+        if(column == &walk->deadline_timer)
+        {
+            walk->deadline_exceeded = true;
+            walker_walk_finish(walk);
+            continue;
+        }
+
+        if(column->state == WALKER_COLUMN_PACED)
+        {
+            column->state = WALKER_COLUMN_READY;
+            walk->paced_column = NULL;
+            walker_walk_fill(walk);
+            continue;
+        }
+
+        if(column->retries >= SNMP_WALKER_RETRIES || now_us - column->request_us >= SNMP_WALKER_REQUEST_DEADLINE_MS * 1000ULL)
+        {
+            walk->timed_out = true;
+            walker_walk_finish(walk);
+            continue;
+        }
+
+        if(column->timeout_us >= walk->rtt.rto_us)
+        {
+            walk->rtt.rto_us = walker_rtt_clamp(walk->rtt.rto_us * 2);
+
+            if(column->planned || column->selective)
+                walker_size_shrink(&walk->sizing.get_varbinds, &walk->sizing.get_threshold, walk->sizing.get_varbinds / 2);
+            else if(column->repetitions > 1)
+                walker_size_shrink(&walk->sizing.repetitions, &walk->sizing.repetitions_threshold, walk->sizing.repetitions / 2);
+        }
+
+        column->retries++;
+        walker_bucket_take(walk, true);
+        walker_column_send(column);
+        stats_count(STATS_COUNTER_RETRANSMITS, 1);
+    }
+}
+
+/**
+ * @brief Starts the walks submitted since the last call.
+ */
+static void walker_start_submitted(void)
+{
+    eventfd_t count;
+    eventfd_read(walker_event_fd, &count);
+
+    pthread_mutex_lock(&walker_mutex);
+    walker_walk_t *walk = walker_submit_head;
+    walker_submit_head = NULL;
+    walker_submit_tail = NULL;
+    pthread_mutex_unlock(&walker_mutex);
+
+    uint64_t now_us = stats_now_us();
+
+    while(walk != NULL)
+    {
+        walker_walk_t *next = walk->next;
+        walk->next = NULL;
+
+        for(int i = 0; i < walk->column_count; i++)
+            walk->column_list[i].start_us = now_us;
+
+        if(walk->policy.deadline > 0)
+        {
+            walk->deadline_timer.sent_us = now_us;
+            walk->deadline_timer.timeout_us = walk->policy.deadline * 1000000ULL;
+            walker_timer_add(&walk->deadline_timer);
+        }
+
+        walker_bucket_attach(walk);
+        walker_walk_fill(walk);
+        walk = next;
+    }
+}
+
+/**
+ * @brief Event thread
+ *
+ * Owns all walks in progress, the sockets, the request table and the timers. Waits with epoll for responses, new
+ * walks and the next timeout.
+ */
+static void *walker_event_run(void *param)
+{
+    struct epoll_event events[SNMP_WALKER_SOCKETS + 1];
+
+    while(true)
+    {
+        int timeout_ms = -1;
+        if(walker_timer_count > 0)
+        {
+            uint64_t now_us = stats_now_us();
+            uint64_t deadline_us = walker_deadline(walker_timer_heap[0]);
+            timeout_ms = deadline_us > now_us ? (int)((deadline_us - now_us + 999) / 1000) : 0;
+        }
+
+        int count = epoll_wait(walker_epoll_fd, events, SNMP_WALKER_SOCKETS + 1, timeout_ms);
+
+        for(int i = 0; i < count; i++)
+        {
+            if(events[i].data.fd == walker_event_fd)
+                walker_start_submitted();
+            else
+                walker_receive(events[i].data.fd);
+        }
+
+        walker_expire_timers();
+
+        pthread_mutex_lock(&walker_mutex);
+        bool stop = walker_stop;
+        pthread_mutex_unlock(&walker_mutex);
+
+        if(stop)
+            break;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Delivery thread
+ *
+ * Passes finished walks to their callbacks, so slow callbacks don't delay the network I/O of the event thread.
+ */
+static void *walker_delivery_run(void *param)
+{
+    pthread_mutex_lock(&walker_mutex);
+
+    while(true)
+    {
+        while(walker_done_head == NULL && !walker_stop)
+            pthread_cond_wait(&walker_done_ready, &walker_mutex);
+
+        walker_walk_t *walk = walker_done_head;
+        if(walk == NULL)
+            break;
+
+        walker_done_head = walk->next;
+        if(walker_done_head == NULL)
+            walker_done_tail = NULL;
+
+        pthread_mutex_unlock(&walker_mutex);
+
+        sds return_str = walk->return_str;
+        walk->return_str = NULL;
+        int status = walk->timed_out || walk->deadline_exceeded ? EXIT_FAILURE : walk->unchanged ? SNMP_WALKER_UNCHANGED : EXIT_SUCCESS;
+        walk->done_fn(walk->host, status, return_str, walk->param);
+        walker_walk_free(walk);
+
+        pthread_mutex_lock(&walker_mutex);
+        walker_active_walks--;
+        pthread_cond_signal(&walker_not_full);
+        if(walker_active_walks == 0)
+            pthread_cond_broadcast(&walker_idle);
+    }
+
+    pthread_mutex_unlock(&walker_mutex);
+
+    return NULL;
+}
+
+/**
+ * @brief Opens the sockets and starts the event and delivery threads.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+static int walker_start(void)
+{
+    uint32_t table_size = 1;
+    while(table_size < 2u * SNMP_WALKER_MAX_WALKS * SNMP_WALKER_MAX_WINDOW)
+        table_size <<= 1;
+
+    walker_request_table = calloc(table_size, sizeof(walker_request_t));
+    walker_request_mask = table_size - 1;
+    /// A walk has at most window requests in flight or waiting for a token, plus its deadline timer
+    walker_timer_heap = calloc(SNMP_WALKER_MAX_WALKS * (SNMP_WALKER_MAX_WINDOW + 1), sizeof(walker_column_t *));
+    walker_timer_count = 0;
+    walker_packet = malloc(WALKER_MAX_PACKET);
+    walker_request = malloc(SNMP_BER_MAX_REQUEST);
+    walker_get_request = malloc(sizeof(snmp_ber_template_t));
+    walker_bucket_table = host_table_init();
+    vec_init(&walker_bucket_list);
+
+    walker_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    walker_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(walker_epoll_fd < 0 || walker_event_fd < 0)
+        return EXIT_FAILURE;
+
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = walker_event_fd };
+    epoll_ctl(walker_epoll_fd, EPOLL_CTL_ADD, walker_event_fd, &event);
+
+    for(int i = 0; i < SNMP_WALKER_SOCKETS; i++)
+    {
+        int receive_buffer = SNMP_WALKER_RECEIVE_BUFFER;
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+
+        int socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if(socket_fd < 0)
+            return EXIT_FAILURE;
+
+        walker_socket_list[walker_socket_count++] = socket_fd;
+        if(bind(socket_fd, (struct sockaddr *)&address, sizeof(address)))
+            return EXIT_FAILURE;
+
+        /// The kernel limits the buffer to net.core.rmem_max
+        setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+
+        event.data.fd = socket_fd;
+        epoll_ctl(walker_epoll_fd, EPOLL_CTL_ADD, socket_fd, &event);
+    }
+
+    walker_stop = false;
+
+    if(pthread_create(&walker_event_thread, NULL, walker_event_run, NULL))
+        return EXIT_FAILURE;
+
+    if(pthread_create(&walker_delivery_thread, NULL, walker_delivery_run, NULL))
+    {
+        pthread_mutex_lock(&walker_mutex);
+        walker_stop = true;
+        pthread_mutex_unlock(&walker_mutex);
+        eventfd_write(walker_event_fd, 1);
+        pthread_join(walker_event_thread, NULL);
+        return EXIT_FAILURE;
+    }
+
+    walker_running = true;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Starts the walker.
+ *
+ * All walks run in one event thread over SNMP_WALKER_SOCKETS UDP sockets. At most SNMP_WALKER_MAX_WALKS walks are in
+ * progress at the same time, so the memory is bounded independent of the number of agents.
+ *
+ * Each agent has a token bucket, which limits the requests to the agent to rate per second after a burst of
+ * SNMP_WALKER_BURST requests, no matter how many walks run. Rules of snmp_policy override the limits per subnet.
+ *
+ * @param window max number of requests in flight to a single agent, 0 walks with the external snmpwalk.
+ * @param rate max number of requests per second to a single agent, 0 for no limit.
+ * @param deadline_s seconds a walk of an agent may take, also of the walks with snmpwalk, 0 for no limit.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int snmp_walker_setup(int window, int rate, int deadline_s)
+{
+    if(window < 0 || window > SNMP_WALKER_MAX_WINDOW)
+    {
+        printf(KRED "[ERROR] snmp_walker_setup: the window must be between 0 and %d.\n" KNORMAL, SNMP_WALKER_MAX_WINDOW);
+        return EXIT_FAILURE;
+    }
+
+    if(rate < 0)
+    {
+        printf(KRED "[ERROR] snmp_walker_setup: the rate can't be negative.\n" KNORMAL);
+        return EXIT_FAILURE;
+    }
+
+    if(deadline_s < 0)
+    {
+        printf(KRED "[ERROR] snmp_walker_setup: the deadline can't be negative.\n" KNORMAL);
+        return EXIT_FAILURE;
+    }
+
+    walker_window = window;
+    walker_rate = rate;
+    walker_deadline_s = deadline_s;
+    /// Responses to requests of an earlier run must not match
+    atomic_store(&walker_next_request_id, (unsigned int)stats_now_us());
+
+    pthread_mutex_lock(&walker_agent_mutex);
+    if(walker_agent_table == NULL)
+    {
+        walker_agent_table = host_table_init();
+        vec_init(&walker_agent_list);
+    }
+    pthread_mutex_unlock(&walker_agent_mutex);
+
+    if(window == 0 || walker_running)
+        return EXIT_SUCCESS;
+
+    if(walker_start())
+    {
+        printf(KRED "[ERROR] snmp_walker_setup can't start the walker: %s\n" KNORMAL, strerror(errno));
+        snmp_walker_shutdown();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Waits for the walks in progress, stops the walker and frees what it kept of the agents.
+ */
+void snmp_walker_shutdown(void)
+{
+    if(walker_running)
+    {
+        snmp_walker_wait_idle();
+
+        pthread_mutex_lock(&walker_mutex);
+        walker_stop = true;
+        pthread_cond_broadcast(&walker_done_ready);
+        pthread_cond_broadcast(&walker_not_full);
+        pthread_mutex_unlock(&walker_mutex);
+
+        eventfd_write(walker_event_fd, 1);
+        pthread_join(walker_event_thread, NULL);
+        pthread_join(walker_delivery_thread, NULL);
+        walker_running = false;
+    }
+
+    for(int i = 0; i < walker_socket_count; i++)
+        close(walker_socket_list[i]);
+    walker_socket_count = 0;
+
+    if(walker_epoll_fd >= 0)
+        close(walker_epoll_fd);
+    if(walker_event_fd >= 0)
+        close(walker_event_fd);
+    walker_epoll_fd = -1;
+    walker_event_fd = -1;
+
+    free(walker_request_table);
+    free(walker_timer_heap);
+    free(walker_packet);
+    free(walker_request);
+    free(walker_get_request);
+    walker_request_table = NULL;
+    walker_timer_heap = NULL;
+    walker_packet = NULL;
+    walker_request = NULL;
+    walker_get_request = NULL;
+
+    if(walker_bucket_table != NULL)
+    {
+        host_table_destroy(walker_bucket_table);
+        vec_free(&walker_bucket_list);
+    }
+    walker_bucket_table = NULL;
+
+    pthread_mutex_lock(&walker_agent_mutex);
+    if(walker_agent_table != NULL)
+    {
+        walker_agent_t *agent;
+        vec_each(&walker_agent_list, agent)
+            free(agent->plan.data);
+
+        host_table_destroy(walker_agent_table);
+        vec_free(&walker_agent_list);
+    }
+    walker_agent_table = NULL;
+    walker_fleet_rtt = (walker_rtt_t){ 0, 0, SNMP_WALKER_TIMEOUT_MS * 1000ULL };
+    pthread_mutex_unlock(&walker_agent_mutex);
+}
+
+/**
+ * @brief Returns the max number of requests in flight to a single agent, 0 if the external snmpwalk is used.
+ */
+int snmp_walker_window(void)
+{
+    return walker_window;
+}
+
+/**
+ * @brief Returns the seconds a walk of an agent may take after the rules of snmp_policy, 0 for no limit.
+ */
+int snmp_walker_deadline(ipv4_t host_ip)
+{
+    snmp_policy_t policy = { walker_window, walker_rate, SNMP_WALKER_BURST, 1, SNMP_WALKER_MAX_REPETITIONS, walker_deadline_s };
+    snmp_policy_for_host(host_ip, &policy);
+
+    return policy.deadline;
+}
+
+/**
+ * @brief Hands a walk to the event thread, blocks while SNMP_WALKER_MAX_WALKS walks are in progress.
+ */
+static int walker_submit(const snmp_credential_t* credential, ipv4_t host_ip, oid_vec_t* oid_list, bool gate, bool trap, snmp_walker_done_fn done_fn, void *param)
+{
+    if(!walker_running || walker_window == 0 || credential->version == SNMP_VERSION_3 || sdslen(credential->community_str) > 255)
+        return EXIT_FAILURE;
+
+    walker_walk_t *walk = walker_walk_init(credential, host_ip, oid_list, gate, trap, done_fn, param);
+
+    pthread_mutex_lock(&walker_mutex);
+
+    while(walker_active_walks >= SNMP_WALKER_MAX_WALKS && !walker_stop)
+        pthread_cond_wait(&walker_not_full, &walker_mutex);
+
+    if(walker_stop)
+    {
+        pthread_mutex_unlock(&walker_mutex);
+        walker_walk_free(walk);
+        return EXIT_FAILURE;
+    }
+
+    walker_active_walks++;
+
+    if(walker_submit_tail != NULL)
+        walker_submit_tail->next = walk;
+    else
+        walker_submit_head = walk;
+    walker_submit_tail = walk;
+
+    pthread_mutex_unlock(&walker_mutex);
+
+    eventfd_write(walker_event_fd, 1);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Starts the SNMP walk of multiple OIDs on a single host without forking snmpwalk
+ *
+ * Each OID is walked with GETNEXT requests like snmpwalk does, or with GETBULK requests like snmpbulkwalk for SNMPv2c
+ * agents, but up to a window of requests of independent OIDs are in flight at the same time and matched to their OID by the request-id. The window and the rate limit of the
+ * agent are snmp_walker_window and the rate of snmp_walker_setup, unless a rule of snmp_policy overrides them. On high latency links the walk
+ * takes about 1 / window of the time of walking one OID after the other. The output is the same as the output of
+ * snmpwalk -One for each OID of the list, in the order of the list. If the list contains ifType, the columns ifSpeed,
+ * ifPhysAddress, ifOperStatus and ifName are read with GETs after ifType and only contain the Ethernet-like interfaces.
+ *
+ * The timeout of the requests follows the smoothed round trip time of the agent, which is kept across walks, and
+ * doubles after each timeout. Agents which haven't been walked before start with the timeout of the whole fleet. The
+ * max-repetitions of the GETBULKs and the OIDs per GET are learned per agent and kept across walks as well.
+ *
+ * Only SNMPv1 and v2c are supported, v3 credentials need the external snmpwalk. Blocks while SNMP_WALKER_MAX_WALKS
+ * walks are in progress.
+ *
+ * @param credential The credential used to make the SNMP walk, must stay valid until the walk has finished.
+ * @param host_ip The IPv4 address of the host, to make the SNMP walk on.
+ * @param oid_list A string list which can contain multiple OIDs to perform the SNMP walk on.
+ * @param done_fn called with the output of the walk, the status is 1 (FAILURE) if the agent stopped responding.
+ * @param param passed to done_fn.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE if the walk can't be started, done_fn isn't called then)
+ */
+int snmp_walker_submit(const snmp_credential_t* credential, ipv4_t host_ip, oid_vec_t* oid_list, snmp_walker_done_fn done_fn, void *param)
+{
+    return walker_submit(credential, host_ip, oid_list, false, false, done_fn, param);
+}
+
+/**
+ * @brief Same as snmp_walker_submit, but skips the walk if the agent reports no change since its last walk.
+ *
+ * Before the walk sysUpTime, ifTableLastChange and lldpStatsRemTablesLastChangeTime are read with a single GET. If the
+ * agent hasn't rebooted and both tables haven't changed since its last complete walk, done_fn is called with the
+ * status SNMP_WALKER_UNCHANGED and an empty output. Agents which don't support these objects are always walked.
+ *
+ * The instances returned by the last complete walk are kept as the plan of the agent. After a trap, once
+ * SNMP_WALKER_GATE_MAX_AGE_S have passed, or always if a policy rule with "gate 0" applies, the values of an
+ * unchanged agent are read with GETs of the plan instead, with the same output as a walk. ifTableLastChange doesn't
+ * have to move when the state of a link changes, so a refresh after a linkDown or linkUp trap is never skipped. If
+ * the agent doesn't return an instance of the plan, the columns are walked and the plan is rebuilt.
+ *
+ * @param credential The credential used to make the SNMP walk, must stay valid until the walk has finished.
+ * @param host_ip The IPv4 address of the host, to make the SNMP walk on.
+ * @param oid_list A string list which can contain multiple OIDs to perform the SNMP walk on.
+ * @param trap true if a trap of the agent caused the refresh, false for the startup and the rescans.
+ * @param done_fn called with the output of the walk.
+ * @param param passed to done_fn.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE if the walk can't be started, done_fn isn't called then)
+ */
+int snmp_walker_refresh(const snmp_credential_t* credential, ipv4_t host_ip, oid_vec_t* oid_list, bool trap, snmp_walker_done_fn done_fn, void *param)
+{
+    return walker_submit(credential, host_ip, oid_list, true, trap, done_fn, param);
+}
+
+/**
+ * Result of a walk for snmp_walker_walk.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t finished_cond;
+    bool finished;
+    int status;
+    sds return_str;
+} walker_result_t;
+
+static void walker_result_done(ipv4_t host_ip, int status, sds return_str, void *param)
+{
+    walker_result_t *result = param;
+
+    pthread_mutex_lock(&result->mutex);
+    result->status = status;
+    result->return_str = return_str;
+    result->finished = true;
+    pthread_cond_signal(&result->finished_cond);
+    pthread_mutex_unlock(&result->mutex);
+}
+
+/**
+ * @brief SNMP walk of multiple OIDs on a single host, waits until the walk has finished.
+ *
+ * Same as snmp_walker_submit, for callers which need the result right away.
+ *
+ * @param credential The credential used to make the SNMP walk.
+ * @param host_ip The IPv4 address of the host, to make the SNMP walk on.
+ * @param oid_list A string list which can contain multiple OIDs to perform the SNMP walk on.
+ * @param return_str The output of the walks is appended to it.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE if the agent didn't respond, the OIDs walked before are returned anyway)
+ */
+int snmp_walker_walk(const snmp_credential_t* credential, ipv4_t host_ip, oid_vec_t* oid_list, sds* return_str)
+{
+    walker_result_t result;
+    pthread_mutex_init(&result.mutex, NULL);
+    pthread_cond_init(&result.finished_cond, NULL);
+    result.finished = false;
+    result.status = EXIT_FAILURE;
+    result.return_str = NULL;
+
+    if(snmp_walker_submit(credential, host_ip, oid_list, walker_result_done, &result))
+    {
+        printf(KRED "[ERROR] snmp_walker_walk only supports SNMPv1 and v2c communities.\n" KNORMAL);
+        pthread_cond_destroy(&result.finished_cond);
+        pthread_mutex_destroy(&result.mutex);
+        return EXIT_FAILURE;
+    }
+
+    pthread_mutex_lock(&result.mutex);
+    while(!result.finished)
+        pthread_cond_wait(&result.finished_cond, &result.mutex);
+    pthread_mutex_unlock(&result.mutex);
+
+    *return_str = sdscatsds(*return_str, result.return_str);
+    sdsfree(result.return_str);
+
+    pthread_cond_destroy(&result.finished_cond);
+    pthread_mutex_destroy(&result.mutex);
+
+    return result.status;
+}
+
+/**
+ * @brief Blocks until all submitted walks have been passed to their callbacks.
+ */
+void snmp_walker_wait_idle(void)
+{
+    if(!walker_running)
+        return;
+
+    pthread_mutex_lock(&walker_mutex);
+    while(walker_active_walks > 0)
+        pthread_cond_wait(&walker_idle, &walker_mutex);
+    pthread_mutex_unlock(&walker_mutex);
+}
@@ -0,0 +1,124 @@
+#ifndef SNMP_WALKER_H
+#define SNMP_WALKER_H
+
+#include "lib/sds.h"
+
+#include "ip.h"
+#include "snmp_ber.h"
+#include "snmp_oid.h"
+#include "snmp_credential.h"
+
+/// Max number of requests in flight to a single agent, 0 walks with the external snmpwalk instead.
+#ifndef SNMP_WALKER_WINDOW
+#define SNMP_WALKER_WINDOW 4
+#endif
+
+/// Max number of requests per second to a single agent, 0 for no limit. Protects the control plane of weak switches.
+#ifndef SNMP_WALKER_RATE
+#define SNMP_WALKER_RATE 200
+#endif
+
+/// Number of requests an idle agent gets back to back before the rate applies.
+#ifndef SNMP_WALKER_BURST
+#define SNMP_WALKER_BURST 10
+#endif
+
+/// Largest window that can be set, the tables of the requests in flight are sized for the window.
+#ifndef SNMP_WALKER_MAX_WINDOW
+#define SNMP_WALKER_MAX_WINDOW 64
+#endif
+
+/// OIDs read with one GET of ifSpeed, ifPhysAddress, ifOperStatus, ifName or a plan until the agent's size is learned.
+#ifndef SNMP_WALKER_GET_VARBINDS
+#define SNMP_WALKER_GET_VARBINDS 16
+#endif
+
+#ifndef SNMP_WALKER_MAX_GET_VARBINDS
+#define SNMP_WALKER_MAX_GET_VARBINDS 64
+#endif
+
+/// max-repetitions of the GETBULKs of SNMPv2c walks until the agent's size is learned.
+#ifndef SNMP_WALKER_REPETITIONS
+#define SNMP_WALKER_REPETITIONS 8
+#endif
+
+#ifndef SNMP_WALKER_MAX_REPETITIONS
+#define SNMP_WALKER_MAX_REPETITIONS 64
+#endif
+
+/// Max number of walks in progress at the same time, bounds the memory. snmp_walker_submit blocks while all are used.
+#ifndef SNMP_WALKER_MAX_WALKS
+#define SNMP_WALKER_MAX_WALKS 1024
+#endif
+
+/// Number of UDP sockets the walks are spread over.
+#ifndef SNMP_WALKER_SOCKETS
+#define SNMP_WALKER_SOCKETS 2
+#endif
+
+/// Receive buffer of each socket in bytes, holds the responses of a burst while the event thread is busy.
+#ifndef SNMP_WALKER_RECEIVE_BUFFER
+#define SNMP_WALKER_RECEIVE_BUFFER (4 * 1024 * 1024)
+#endif
+
+/// Milliseconds to wait for a response as long as no round trip time has been measured.
+#ifndef SNMP_WALKER_TIMEOUT_MS
+#define SNMP_WALKER_TIMEOUT_MS 1000
+#endif
+
+/// Bounds of the timeout derived from the round trip times of an agent, in milliseconds.
+#ifndef SNMP_WALKER_MIN_TIMEOUT_MS
+#define SNMP_WALKER_MIN_TIMEOUT_MS 100
+#endif
+
+#ifndef SNMP_WALKER_MAX_TIMEOUT_MS
+#define SNMP_WALKER_MAX_TIMEOUT_MS 4000
+#endif
+
+/// Number of times a request is sent again before the agent counts as not responding, the timeout doubles each time.
+#ifndef SNMP_WALKER_RETRIES
+#define SNMP_WALKER_RETRIES 3
+#endif
+
+/// Milliseconds a request may take with all its retries before the agent counts as not responding.
+#ifndef SNMP_WALKER_REQUEST_DEADLINE_MS
+#define SNMP_WALKER_REQUEST_DEADLINE_MS 6000
+#endif
+
+/// Seconds a walk of an agent may take, the columns read until then are kept and the others marked as incomplete.
+/// 0 for no limit.
+#ifndef SNMP_WALKER_DEADLINE_S
+#define SNMP_WALKER_DEADLINE_S 60
+#endif
+
+/// Seconds after which an agent is walked again, even if it reports no change.
+#ifndef SNMP_WALKER_GATE_MAX_AGE_S
+#define SNMP_WALKER_GATE_MAX_AGE_S 600
+#endif
+
+#ifndef SNMP_WALKER_PORT
+#define SNMP_WALKER_PORT 161
+#endif
+
+/// Largest number of sub identifiers of an OID.
+#define SNMP_WALKER_MAX_OID_LEN SNMP_BER_MAX_OID_LEN
+
+/// Status passed to snmp_walker_done_fn if snmp_walker_refresh skipped the walk.
+#define SNMP_WALKER_UNCHANGED 2
+
+/**
+ * Called from the delivery thread of the walker when a walk has finished, the ownership of return_str is passed on.
+ * It may block, e.g. on a full queue, without delaying other walks.
+ */
+typedef void (*snmp_walker_done_fn)(ipv4_t host_ip, int status, sds return_str, void *param);
+
+int snmp_walker_setup(int window, int rate, int deadline_s);
+void snmp_walker_shutdown(void);
+int snmp_walker_window(void);
+int snmp_walker_deadline(ipv4_t host_ip);
+int snmp_walker_submit(const snmp_credential_t* credential, ipv4_t host_ip, oid_vec_t* oid_list, snmp_walker_done_fn done_fn, void *param);
+int snmp_walker_refresh(const snmp_credential_t* credential, ipv4_t host_ip, oid_vec_t* oid_list, bool trap, snmp_walker_done_fn done_fn, void *param);
+int snmp_walker_walk(const snmp_credential_t* credential, ipv4_t host_ip, oid_vec_t* oid_list, sds* return_str);
+void snmp_walker_wait_idle(void);
+
+#endif
@@ -0,0 +1,389 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "kcolor.h"
+#include "stats.h"
+
+typedef struct
+{
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t sum_us;
+    atomic_uint_fast64_t max_us;
+    atomic_uint_fast64_t buckets[STATS_HISTOGRAM_BUCKETS];
+} stats_atomic_histogram_t;
+
+/**
+ * Statistics of a single thread
+ *
+ * Only the owning thread writes to its shard, so updates are plain relaxed loads and stores without any lock or
+ * read-modify-write instruction. Readers sum up all shards.
+ */
+typedef struct stats_shard
+{
+    struct stats_shard *next;
+    stats_atomic_histogram_t phases[STATS_PHASE_COUNT];
+    atomic_uint_fast64_t counters[STATS_COUNTER_COUNT];
+} stats_shard_t;
+
+/// Shards of all threads which recorded anything, shards are kept after their thread exited so no values get lost.
+static stats_shard_t *stats_shards = NULL;
+static pthread_mutex_t stats_shards_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local stats_shard_t *stats_local_shard = NULL;
+
+static atomic_int_fast64_t stats_gauges[STATS_GAUGE_COUNT];
+
+static const char *stats_phase_names[STATS_PHASE_COUNT] = {
+    "sweep",
+    "walk_oid",
+    "fetch",
+    "parse",
+    "db_map",
+    "db_commit",
+    "host",
+};
+
+static const char *stats_counter_names[STATS_COUNTER_COUNT] = {
+    "hosts",
+    "varbinds",
+    "bytes_received",
+    "traps_received",
+    "traps_dropped",
+    "rescan_new_hosts",
+    "retransmits",
+    "paced_requests",
+    "unchanged_walks",
+    "planned_walks",
+    "incomplete_walks",
+};
+
+static const char *stats_gauge_names[STATS_GAUGE_COUNT] = {
+    "trap_buffer_used",
+    "pipeline_pending",
+    "stale_hosts",
+};
+
+static pthread_t stats_thread;
+static atomic_bool stats_thread_running = false;
+
+/**
+ * @brief Waits for SIGUSR1 and prints the current statistics
+ *
+ * The signal is blocked in all threads and only received here with sigwait, so printing is safe.
+ */
+static void *stats_signal_thread(void *param)
+{
+    sigset_t signal_set;
+    sigemptyset(&signal_set);
+    sigaddset(&signal_set, SIGUSR1);
+
+    int signo;
+    while(sigwait(&signal_set, &signo) == 0 && atomic_load(&stats_thread_running))
+        stats_print_summary();
+
+    return NULL;
+}
+
+/**
+ * @brief Sets up the live dump of the statistics on SIGUSR1
+ *
+ * Must be called before any other thread gets created, the threads inherit the blocked SIGUSR1.
+ *
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int stats_setup(void)
+{
+    sigset_t signal_set;
+    sigemptyset(&signal_set);
+    sigaddset(&signal_set, SIGUSR1);
+
+    if(pthread_sigmask(SIG_BLOCK, &signal_set, NULL))
+    {
+        printf(KRED "[ERROR] stats_setup couldn't block SIGUSR1.\n" KNORMAL);
+        return EXIT_FAILURE;
+    }
+
+    atomic_store(&stats_thread_running, true);
+
+    if(pthread_create(&stats_thread, NULL, stats_signal_thread, NULL))
+    {
+        atomic_store(&stats_thread_running, false);
+        printf(KRED "[ERROR] stats_setup couldn't create signal thread.\n" KNORMAL);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Stops the SIGUSR1 thread.
+ */
+void stats_shutdown(void)
+{
+    if(!atomic_exchange(&stats_thread_running, false))
+        return;
+
+    pthread_kill(stats_thread, SIGUSR1);
+    pthread_join(stats_thread, NULL);
+}
+
+/**
+ * @brief Returns a monotonic timestamp in microseconds.
+ */
+uint64_t stats_now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Bucket 0..3 hold 0..3 us, after that each power of two is split into STATS_HISTOGRAM_SUB_BUCKETS buckets.
+ */
+static int stats_histogram_bucket(uint64_t value_us)
+{
+    if(value_us < STATS_HISTOGRAM_SUB_BUCKETS)
+        return (int)value_us;
+
+    int power = 63 - __builtin_clzll(value_us);
+    int sub_bucket = (value_us >> (power - 2)) & (STATS_HISTOGRAM_SUB_BUCKETS - 1);
+    int bucket = (power - 1) * STATS_HISTOGRAM_SUB_BUCKETS + sub_bucket;
+
+    return bucket < STATS_HISTOGRAM_BUCKETS ? bucket : STATS_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * @brief Returns the largest duration counted in a histogram bucket.
+ *
+ * @param bucket index of the bucket.
+ * @return duration in microseconds.
+ */
+uint64_t stats_histogram_bucket_upper_us(int bucket)
+{
+    if(bucket < STATS_HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+
+    int power = bucket / STATS_HISTOGRAM_SUB_BUCKETS + 1;
+    uint64_t sub_bucket = bucket % STATS_HISTOGRAM_SUB_BUCKETS;
+    uint64_t lower = (STATS_HISTOGRAM_SUB_BUCKETS + sub_bucket) << (power - 2);
+
+    return lower + ((uint64_t)1 << (power - 2)) - 1;
+}
+
+/**
+ * @brief Adds a value to a histogram which is owned by the caller, e.g. for latencies measured outside of the phases.
+ *
+ * @param histogram the histogram, not thread safe.
+ * @param duration_us duration in microseconds.
+ */
+void stats_histogram_add(stats_histogram_t *histogram, uint64_t duration_us)
+{
+    histogram->count++;
+    histogram->sum_us += duration_us;
+    histogram->buckets[stats_histogram_bucket(duration_us)]++;
+
+    if(duration_us > histogram->max_us)
+        histogram->max_us = duration_us;
+}
+
+/**
+ * @brief Returns the shard of the calling thread, the shard gets registered on first use.
+ */
+static stats_shard_t *stats_shard(void)
+{
+    if(stats_local_shard == NULL)
+    {
+        stats_shard_t *shard = (stats_shard_t *)calloc(1, sizeof(stats_shard_t));
+
+        pthread_mutex_lock(&stats_shards_mutex);
+        shard->next = stats_shards;
+        stats_shards = shard;
+        pthread_mutex_unlock(&stats_shards_mutex);
+
+        stats_local_shard = shard;
+    }
+
+    return stats_local_shard;
+}
+
+/// Adds to a value which is only written by the calling thread.
+static inline void stats_local_add(atomic_uint_fast64_t *value, uint64_t add)
+{
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + add, memory_order_relaxed);
+}
+
+/**
+ * @brief Records the duration of a phase, can be called from any thread.
+ *
+ * @param phase the timed phase.
+ * @param duration_us duration in microseconds.
+ */
+void stats_record(stats_phase_t phase, uint64_t duration_us)
+{
+    stats_atomic_histogram_t *histogram = &stats_shard()->phases[phase];
+
+    stats_local_add(&histogram->count, 1);
+    stats_local_add(&histogram->sum_us, duration_us);
+    stats_local_add(&histogram->buckets[stats_histogram_bucket(duration_us)], 1);
+
+    if(duration_us > atomic_load_explicit(&histogram->max_us, memory_order_relaxed))
+        atomic_store_explicit(&histogram->max_us, duration_us, memory_order_relaxed);
+}
+
+/**
+ * @brief Adds a value to a counter, can be called from any thread.
+ *
+ * @param counter the counter.
+ * @param value the value to add.
+ */
+void stats_count(stats_counter_t counter, uint64_t value)
+{
+    stats_local_add(&stats_shard()->counters[counter], value);
+}
+
+/**
+ * @brief Sets a gauge, can be called from any thread.
+ *
+ * @param gauge the gauge.
+ * @param value the current value.
+ */
+void stats_gauge_set(stats_gauge_t gauge, int64_t value)
+{
+    atomic_store_explicit(&stats_gauges[gauge], value, memory_order_relaxed);
+}
+
+/**
+ * @brief Copies the current statistics, sums up the shards of all threads.
+ *
+ * @param phases returns a histogram for each phase.
+ * @param counters returns the value of each counter.
+ * @param gauges returns the value of each gauge.
+ */
+void stats_snapshot(stats_histogram_t phases[STATS_PHASE_COUNT], uint64_t counters[STATS_COUNTER_COUNT], int64_t gauges[STATS_GAUGE_COUNT])
+{
+    memset(phases, 0, STATS_PHASE_COUNT * sizeof(stats_histogram_t));
+    memset(counters, 0, STATS_COUNTER_COUNT * sizeof(uint64_t));
+
+    pthread_mutex_lock(&stats_shards_mutex);
+
+    for(stats_shard_t *shard = stats_shards; shard != NULL; shard = shard->next)
+    {
+        for(int phase = 0; phase < STATS_PHASE_COUNT; phase++)
+        {
+            stats_atomic_histogram_t *histogram = &shard->phases[phase];
+
+            phases[phase].count += atomic_load_explicit(&histogram->count, memory_order_relaxed);
+            phases[phase].sum_us += atomic_load_explicit(&histogram->sum_us, memory_order_relaxed);
+
+            uint64_t max_us = atomic_load_explicit(&histogram->max_us, memory_order_relaxed);
+            if(max_us > phases[phase].max_us)
+                phases[phase].max_us = max_us;
+
+            for(int bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+                phases[phase].buckets[bucket] += atomic_load_explicit(&histogram->buckets[bucket], memory_order_relaxed);
+        }
+
+        for(int counter = 0; counter < STATS_COUNTER_COUNT; counter++)
+            counters[counter] += atomic_load_explicit(&shard->counters[counter], memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&stats_shards_mutex);
+
+    for(int gauge = 0; gauge < STATS_GAUGE_COUNT; gauge++)
+        gauges[gauge] = atomic_load_explicit(&stats_gauges[gauge], memory_order_relaxed);
+}
+
+/**
+ * @brief Estimates a percentile from a histogram
+ *
+ * @param histogram the histogram.
+ * @param percentile the percentile between 0 and 1.
+ * @return upper bound of the bucket which contains the percentile in microseconds.
+ */
+uint64_t stats_histogram_percentile(const stats_histogram_t *histogram, double percentile)
+{
+    if(histogram->count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(percentile * histogram->count + 0.5);
+    if(rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for(int bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+    {
+        seen += histogram->buckets[bucket];
+        if(seen >= rank)
+        {
+            uint64_t upper_us = stats_histogram_bucket_upper_us(bucket);
+            return upper_us < histogram->max_us ? upper_us : histogram->max_us;
+        }
+    }
+
+    return histogram->max_us;
+}
+
+const char *stats_phase_name(stats_phase_t phase)
+{
+    return stats_phase_names[phase];
+}
+
+const char *stats_counter_name(stats_counter_t counter)
+{
+    return stats_counter_names[counter];
+}
+
+const char *stats_gauge_name(stats_gauge_t gauge)
+{
+    return stats_gauge_names[gauge];
+}
+
+/**
+ * @brief Prints the duration of each phase and all counters.
+ */
+void stats_print_summary(void)
+{
+    static stats_histogram_t phases[STATS_PHASE_COUNT];
+    static pthread_mutex_t summary_mutex = PTHREAD_MUTEX_INITIALIZER;
+    uint64_t counters[STATS_COUNTER_COUNT];
+    int64_t gauges[STATS_GAUGE_COUNT];
+
+    pthread_mutex_lock(&summary_mutex);
+
+    stats_snapshot(phases, counters, gauges);
+
+    printf("Timing (ms):\n");
+    printf("%-10s %8s %10s %10s %10s %10s %10s\n", "phase", "count", "avg", "p50", "p90", "p99", "max");
+
+    for(int phase = 0; phase < STATS_PHASE_COUNT; phase++)
+    {
+        stats_histogram_t *histogram = &phases[phase];
+        if(histogram->count == 0)
+            continue;
+
+        printf("%-10s %8llu %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+            stats_phase_names[phase],
+            (unsigned long long)histogram->count,
+            histogram->sum_us / 1000.0 / histogram->count,
+            stats_histogram_percentile(histogram, 0.5) / 1000.0,
+            stats_histogram_percentile(histogram, 0.9) / 1000.0,
+            stats_histogram_percentile(histogram, 0.99) / 1000.0,
+            histogram->max_us / 1000.0);
+    }
+
+    for(int counter = 0; counter < STATS_COUNTER_COUNT; counter++)
+        printf("%s: %llu\n", stats_counter_names[counter], (unsigned long long)counters[counter]);
+
+    for(int gauge = 0; gauge < STATS_GAUGE_COUNT; gauge++)
+        printf("%s: %lld\n", stats_gauge_names[gauge], (long long)gauges[gauge]);
+
+    fflush(stdout);
+
+    pthread_mutex_unlock(&summary_mutex);
+}
@@ -0,0 +1,82 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/// Sub-buckets per power of two, the histogram resolution is 1/4 of a power of two (~19%).
+#define STATS_HISTOGRAM_SUB_BUCKETS 4
+/// Largest tracked power of two, longer durations than 2^40 us end up in the last bucket.
+#define STATS_HISTOGRAM_MAX_POWER 40
+#define STATS_HISTOGRAM_BUCKETS (STATS_HISTOGRAM_SUB_BUCKETS * STATS_HISTOGRAM_MAX_POWER)
+
+/**
+ * Timed phases of the discovery
+ */
+typedef enum
+{
+    STATS_PHASE_SWEEP,      ///< Network scan for SNMP devices.
+    STATS_PHASE_WALK_OID,   ///< A single SNMP walk of one OID.
+    STATS_PHASE_FETCH,      ///< All SNMP walks of one host.
+    STATS_PHASE_PARSE,      ///< Parsing the walks of one host.
+    STATS_PHASE_DB_MAP,     ///< Mapping the data of one host to the database.
+    STATS_PHASE_DB_COMMIT,  ///< Resolving pending links and committing a batch.
+    STATS_PHASE_HOST,       ///< A host from submit until it has been written.
+    STATS_PHASE_COUNT
+} stats_phase_t;
+
+typedef enum
+{
+    STATS_COUNTER_HOSTS,            ///< Hosts written to the database.
+    STATS_COUNTER_VARBINDS,         ///< Parsed variable bindings.
+    STATS_COUNTER_BYTES_RECEIVED,   ///< Bytes read from the SNMP walks.
+    STATS_COUNTER_TRAPS_RECEIVED,   ///< SNMP traps read from snmptrapd.
+    STATS_COUNTER_TRAPS_DROPPED,    ///< SNMP traps dropped because the trap buffer was full.
+    STATS_COUNTER_RESCAN_NEW_HOSTS, ///< Devices found by the background rescan after the discovery.
+    STATS_COUNTER_RETRANSMITS,      ///< SNMP requests sent again after a timeout.
+    STATS_COUNTER_PACED,            ///< SNMP requests delayed by the rate limit of their agent.
+    STATS_COUNTER_UNCHANGED,        ///< Walks skipped because the agent reported no change since its last walk.
+    STATS_COUNTER_PLANNED,          ///< Walks read with the GETs of the instances of the last complete walk.
+    STATS_COUNTER_INCOMPLETE,       ///< Walks cut off by a timeout or their deadline, the columns read until then are kept.
+    STATS_COUNTER_COUNT
+} stats_counter_t;
+
+/**
+ * Values which are set instead of summed up
+ */
+typedef enum
+{
+    STATS_GAUGE_TRAP_BUFFER_USED,   ///< Traps waiting in the trap buffer.
+    STATS_GAUGE_PIPELINE_PENDING,   ///< Hosts submitted to the pipeline which haven't been written yet.
+    STATS_GAUGE_STALE_HOSTS,        ///< Devices which stopped answering the background rescan.
+    STATS_GAUGE_COUNT
+} stats_gauge_t;
+
+/**
+ * Latency histogram in microseconds with logarithmic buckets
+ */
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t buckets[STATS_HISTOGRAM_BUCKETS];
+} stats_histogram_t;
+
+int stats_setup(void);
+void stats_shutdown(void);
+
+uint64_t stats_now_us(void);
+void stats_record(stats_phase_t phase, uint64_t duration_us);
+void stats_count(stats_counter_t counter, uint64_t value);
+void stats_gauge_set(stats_gauge_t gauge, int64_t value);
+
+void stats_snapshot(stats_histogram_t phases[STATS_PHASE_COUNT], uint64_t counters[STATS_COUNTER_COUNT], int64_t gauges[STATS_GAUGE_COUNT]);
+void stats_histogram_add(stats_histogram_t *histogram, uint64_t duration_us);
+uint64_t stats_histogram_percentile(const stats_histogram_t *histogram, double percentile);
+uint64_t stats_histogram_bucket_upper_us(int bucket);
+const char *stats_phase_name(stats_phase_t phase);
+const char *stats_counter_name(stats_counter_t counter);
+const char *stats_gauge_name(stats_gauge_t gauge);
+void stats_print_summary(void);
+
+#endif
@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kcolor.h"
+#include "sweep_cache.h"
+
+/**
+ * Cache file format, all integers are 32 bit little endian:
+ *
+ *   magic "SWEEPCA2"
+ *   range_count, range_count * (first, last)   the swept target set
+ *   last_full_sweep, responder_count
+ *   bitmap of the responders, one bit per address of the target set in ascending order
+ *   responder_count * last_seen, in address order
+ *
+ * Times are seconds since the epoch. A /16 needs an 8 KiB bitmap plus 4 bytes per responder.
+ */
+
+static sds cache_path_str = NULL;
+/// Swept addresses, owned by the caller of sweep_cache_setup
+static target_set_t *cache_target_set = NULL;
+static uint32_t cache_size = 0;
+static uint32_t cache_last_full_sweep = 0;
+static uint8_t *cache_bitmap = NULL;
+/// Last time each address answered, only valid for addresses set in the bitmap
+static uint32_t *cache_last_seen = NULL;
+
+static bool sweep_cache_test(uint32_t offset)
+{
+    return cache_bitmap[offset >> 3] & (1 << (offset & 7));
+}
+
+static void sweep_cache_put_u32(FILE *file, uint32_t value)
+{
+    uint8_t bytes[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF };
+    fwrite(bytes, 1, 4, file);
+}
+
+static int sweep_cache_get_u32(FILE *file, uint32_t *value)
+{
+    uint8_t bytes[4];
+    if(fread(bytes, 1, 4, file) != 4)
+        return EXIT_FAILURE;
+
+    *value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Reads the target set of a cache file and compares it with the swept one.
+ * @return 0 if the file covers the swept target set, 1 if not or on a read error.
+ */
+static int sweep_cache_check_ranges(FILE *file)
+{
+    ipv4_range_vec_t *range_list = target_set_ranges(cache_target_set);
+    uint32_t range_count;
+
+    if(sweep_cache_get_u32(file, &range_count) || range_count != (uint32_t)range_list->size)
+        return EXIT_FAILURE;
+
+    for(int i = 0; i < range_list->size; i++)
+    {
+        uint32_t first, last;
+        if(sweep_cache_get_u32(file, &first) || sweep_cache_get_u32(file, &last)
+            || first != range_list->data[i].first || last != range_list->data[i].last)
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Loads the cache file, the cache starts empty if the file doesn't exist or covers other targets.
+ */
+static void sweep_cache_load(uint32_t now)
+{
+    FILE *file = fopen(cache_path_str, "rb");
+    if(file == NULL)
+        return;
+
+    char magic[SWEEP_CACHE_MAGIC_LEN];
+    uint32_t last_full_sweep, responder_count;
+
+    if(fread(magic, 1, SWEEP_CACHE_MAGIC_LEN, file) != SWEEP_CACHE_MAGIC_LEN || memcmp(magic, SWEEP_CACHE_MAGIC, SWEEP_CACHE_MAGIC_LEN) != 0)
+    {
+        printf(KYELLOW "[WARNING] sweep_cache_load ignores %s, it isn't a sweep cache.\n" KNORMAL, cache_path_str);
+        fclose(file);
+        return;
+    }
+
+    /// The cache of other targets is useless, the next shutdown overwrites it
+    if(sweep_cache_check_ranges(file) || sweep_cache_get_u32(file, &last_full_sweep) || sweep_cache_get_u32(file, &responder_count))
+    {
+        fclose(file);
+        return;
+    }
+
+    uint32_t bitmap_len = (cache_size + 7) / 8;
+    uint8_t *bitmap = calloc(bitmap_len, 1);
+    uint32_t loaded_count = 0;
+    int status = fread(bitmap, 1, bitmap_len, file) == bitmap_len ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    for(uint32_t offset = 0; status == EXIT_SUCCESS && offset < cache_size; offset++)
+    {
+        if(!(bitmap[offset >> 3] & (1 << (offset & 7))))
+            continue;
+
+        uint32_t last_seen;
+        status = loaded_count < responder_count ? sweep_cache_get_u32(file, &last_seen) : EXIT_FAILURE;
+
+        /// Responders which haven't answered for a long time are probably gone
+        if(status == EXIT_SUCCESS && now - last_seen < SWEEP_CACHE_EXPIRE)
+        {
+            cache_bitmap[offset >> 3] |= 1 << (offset & 7);
+            cache_last_seen[offset] = last_seen;
+        }
+
+        loaded_count++;
+    }
+
+    if(status == EXIT_SUCCESS)
+    {
+        cache_last_full_sweep = last_full_sweep;
+    }
+    else
+    {
+        printf(KYELLOW "[WARNING] sweep_cache_load ignores %s, the file is truncated.\n" KNORMAL, cache_path_str);
+        memset(cache_bitmap, 0, bitmap_len);
+    }
+
+    free(bitmap);
+    fclose(file);
+}
+
+/**
+ * @brief Loads the responders of earlier sweeps of the same targets.
+ *
+ * The cache is disabled (sweep_cache_enabled returns false) for more than SWEEP_CACHE_MAX_ADDRESSES addresses.
+ *
+ * @param path cache file, created on shutdown if it doesn't exist.
+ * @param target_set the addresses to sweep, must not be changed until sweep_cache_shutdown.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int sweep_cache_setup(const char* path, target_set_t* target_set)
+{
+    uint64_t size = target_set_size(target_set);
+
+    if(size > SWEEP_CACHE_MAX_ADDRESSES)
+    {
+        printf(KYELLOW "[WARNING] sweep_cache_setup: the sweep cache only covers up to %d addresses.\n" KNORMAL, SWEEP_CACHE_MAX_ADDRESSES);
+        return EXIT_SUCCESS;
+    }
+
+    cache_target_set = target_set;
+    cache_size = (uint32_t)size;
+    cache_bitmap = calloc((cache_size + 7) / 8 + 1, 1);
+    cache_last_seen = calloc(cache_size + 1, sizeof(uint32_t));
+    cache_last_full_sweep = 0;
+    cache_path_str = sdsnew(path);
+
+    sweep_cache_load((uint32_t)time(NULL));
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Saves the cache and frees it.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int sweep_cache_shutdown(void)
+{
+    if(!sweep_cache_enabled())
+        return EXIT_SUCCESS;
+
+    int status = EXIT_FAILURE;
+    FILE *file = fopen(cache_path_str, "wb");
+
+    if(file != NULL)
+    {
+        ipv4_range_vec_t *range_list = target_set_ranges(cache_target_set);
+
+        uint32_t responder_count = 0;
+        for(uint32_t offset = 0; offset < cache_size; offset++)
+            responder_count += sweep_cache_test(offset);
+
+        fwrite(SWEEP_CACHE_MAGIC, 1, SWEEP_CACHE_MAGIC_LEN, file);
+        sweep_cache_put_u32(file, range_list->size);
+        for(int i = 0; i < range_list->size; i++)
+        {
+            sweep_cache_put_u32(file, range_list->data[i].first);
+            sweep_cache_put_u32(file, range_list->data[i].last);
+        }
+        sweep_cache_put_u32(file, cache_last_full_sweep);
+        sweep_cache_put_u32(file, responder_count);
+        fwrite(cache_bitmap, 1, (cache_size + 7) / 8, file);
+
+        for(uint32_t offset = 0; offset < cache_size; offset++)
+        {
+            if(sweep_cache_test(offset))
+                sweep_cache_put_u32(file, cache_last_seen[offset]);
+        }
+
+        status = fclose(file) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(status)
+        printf(KRED "[ERROR] sweep_cache_shutdown can't write %s.\n" KNORMAL, cache_path_str);
+
+    free(cache_bitmap);
+    free(cache_last_seen);
+    sdsfree(cache_path_str);
+    cache_bitmap = NULL;
+    cache_last_seen = NULL;
+    cache_path_str = NULL;
+    cache_target_set = NULL;
+
+    return status;
+}
+
+/**
+ * @brief Returns true if the targets are covered by the cache.
+ */
+bool sweep_cache_enabled(void)
+{
+    return cache_bitmap != NULL;
+}
+
+/**
+ * @brief Returns true if the addresses that never answered should be swept again.
+ */
+bool sweep_cache_full_sweep_due(void)
+{
+    return !sweep_cache_enabled() || (uint32_t)time(NULL) - cache_last_full_sweep >= SWEEP_CACHE_FULL_INTERVAL;
+}
+
+/**
+ * @brief Adds the addresses that answered an earlier sweep to responder_set.
+ */
+void sweep_cache_get_responders(target_set_t* responder_set)
+{
+    if(!sweep_cache_enabled())
+        return;
+
+    target_set_iter_t iter;
+    target_set_iter_init(&iter, cache_target_set);
+
+    ipv4_t host;
+    for(uint32_t offset = 0; target_set_iter_next(&iter, &host); offset++)
+    {
+        if(sweep_cache_test(offset))
+            target_set_add_range(responder_set, host, host);
+    }
+}
+
+/**
+ * @brief Adds the addresses that haven't answered an earlier sweep to unknown_set.
+ *
+ * The responders are excluded from the swept ranges, unknown_set needs one range per responder at most.
+ */
+void sweep_cache_get_unknown(target_set_t* unknown_set)
+{
+    if(!sweep_cache_enabled())
+        return;
+
+    ipv4_range_vec_t *range_list = target_set_ranges(cache_target_set);
+    for(int i = 0; i < range_list->size; i++)
+        target_set_add_range(unknown_set, range_list->data[i].first, range_list->data[i].last);
+
+    target_set_iter_t iter;
+    target_set_iter_init(&iter, cache_target_set);
+
+    ipv4_t host;
+    for(uint32_t offset = 0; target_set_iter_next(&iter, &host); offset++)
+    {
+        if(sweep_cache_test(offset))
+            target_set_exclude_range(unknown_set, host, host);
+    }
+}
+
+/**
+ * @brief Records that the hosts answered now, hosts outside of the targets are ignored.
+ */
+void sweep_cache_mark_seen(ipv4_vec_t* host_list)
+{
+    uint32_t now = (uint32_t)time(NULL);
+
+    for(int i = 0; sweep_cache_enabled() && i < host_list->size; i++)
+    {
+        int64_t offset = target_set_index_of(cache_target_set, host_list->data[i]);
+        if(offset < 0)
+            continue;
+
+        cache_bitmap[offset >> 3] |= 1 << (offset & 7);
+        cache_last_seen[offset] = now;
+    }
+}
+
+/**
+ * @brief Records that all targets have been swept now.
+ */
+void sweep_cache_mark_full_sweep(void)
+{
+    cache_last_full_sweep = (uint32_t)time(NULL);
+}
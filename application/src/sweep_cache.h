@@ -0,0 +1,54 @@
+#ifndef SWEEP_CACHE_H
+#define SWEEP_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ip.h"
+#include "target_set.h"
+
+/// File the sweep results are kept in between runs.
+#ifndef SWEEP_CACHE_PATH
+#define SWEEP_CACHE_PATH "sweep.cache"
+#endif
+
+/// Seconds after which the addresses that never answered are swept again.
+#ifndef SWEEP_CACHE_FULL_INTERVAL
+#define SWEEP_CACHE_FULL_INTERVAL 3600
+#endif
+
+/// Seconds after which a responder that hasn't been seen is forgotten.
+#ifndef SWEEP_CACHE_EXPIRE
+#define SWEEP_CACHE_EXPIRE (7 * 24 * 3600)
+#endif
+
+/// Milliseconds onesixtyone waits per address when sweeping the addresses that never answered.
+#ifndef SWEEP_CACHE_EMPTY_WAIT_MS
+#define SWEEP_CACHE_EMPTY_WAIT_MS 20
+#endif
+
+/// Milliseconds to wait for late responses of the known responders, they are walked as soon as the probe ends.
+#ifndef SWEEP_CACHE_KNOWN_TAIL_MS
+#define SWEEP_CACHE_KNOWN_TAIL_MS 1000
+#endif
+
+/// Largest number of addresses the cache covers, it needs 4 bytes and 1 bit per address.
+#ifndef SWEEP_CACHE_MAX_ADDRESSES
+#define SWEEP_CACHE_MAX_ADDRESSES (1 << 20)
+#endif
+
+/// First bytes of a cache file, the digit is the format version.
+#define SWEEP_CACHE_MAGIC "SWEEPCA2"
+#define SWEEP_CACHE_MAGIC_LEN 8
+
+int sweep_cache_setup(const char* path, target_set_t* target_set);
+int sweep_cache_shutdown(void);
+
+bool sweep_cache_enabled(void);
+bool sweep_cache_full_sweep_due(void);
+void sweep_cache_get_responders(target_set_t* responder_set);
+void sweep_cache_get_unknown(target_set_t* unknown_set);
+void sweep_cache_mark_seen(ipv4_vec_t* host_list);
+void sweep_cache_mark_full_sweep(void);
+
+#endif
@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "kcolor.h"
+#include "stats.h"
+#include "host_table.h"
+#include "sweep_cache.h"
+#include "snmp_network.h"
+#include "snmp_pipeline.h"
+#include "snmp_credential.h"
+#include "sweeper.h"
+
+static pthread_t sweeper_thread;
+static bool sweeper_running = false;
+static bool sweeper_stop = false;
+static pthread_mutex_t sweeper_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sweeper_wakeup = PTHREAD_COND_INITIALIZER;
+
+static sds sweeper_exec_path_str = NULL;
+/// Addresses to rescan, owned by the caller of sweeper_setup
+static target_set_t *sweeper_target_set = NULL;
+static int sweeper_interval_s = SWEEPER_INTERVAL;
+
+/// Known devices, only used by the sweeper thread. The slot of a device indexes the lists below.
+static host_table_t *sweeper_hosts = NULL;
+/// Number of complete rescans each device missed in a row
+static vec_t(int) sweeper_missed_list;
+/// Devices which answered during the current rescan
+static vec_t(bool) sweeper_seen_list;
+static int sweeper_stale_count = 0;
+
+/**
+ * @brief Waits until the timeout expires or sweeper_shutdown is called.
+ *
+ * @return true if the sweeper should stop.
+ */
+static bool sweeper_wait(int timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&sweeper_mutex);
+    while(!sweeper_stop && pthread_cond_timedwait(&sweeper_wakeup, &sweeper_mutex, &deadline) != ETIMEDOUT);
+    bool stop = sweeper_stop;
+    pthread_mutex_unlock(&sweeper_mutex);
+
+    return stop;
+}
+
+static int sweeper_add_host(ipv4_t host)
+{
+    host_table_insert(sweeper_hosts, host);
+    vec_push(&sweeper_missed_list, 0);
+    vec_push(&sweeper_seen_list, false);
+
+    return host_table_size(sweeper_hosts) - 1;
+}
+
+/**
+ * @brief Queues new devices and devices which answer again in the pipeline.
+ */
+static void sweeper_host_found(ipv4_t host)
+{
+    int slot = host_table_find_slot(sweeper_hosts, host);
+
+    if(slot < 0)
+    {
+        slot = sweeper_add_host(host);
+
+        sds ip_str = str_from_ipv4(host);
+        printf("[NOTICE] Rescan found the new device %s\n", ip_str);
+        sdsfree(ip_str);
+
+        stats_count(STATS_COUNTER_RESCAN_NEW_HOSTS, 1);
+        snmp_pipeline_submit(host);
+    }
+    else if(sweeper_missed_list.data[slot] >= SWEEPER_STALE_PASSES)
+    {
+        sds ip_str = str_from_ipv4(host);
+        printf("[NOTICE] Stale device %s answers again\n", ip_str);
+        sdsfree(ip_str);
+
+        sweeper_stale_count--;
+        stats_gauge_set(STATS_GAUGE_STALE_HOSTS, sweeper_stale_count);
+
+        snmp_pipeline_submit_stale(host, false);
+        snmp_pipeline_submit(host);
+    }
+
+    sweeper_missed_list.data[slot] = 0;
+    sweeper_seen_list.data[slot] = true;
+}
+
+/**
+ * @brief Counts a missed rescan for each device which didn't answer, marks devices stale after SWEEPER_STALE_PASSES.
+ */
+static void sweeper_finish_pass(void)
+{
+    for(int slot = 0; slot < host_table_size(sweeper_hosts); slot++)
+    {
+        if(sweeper_seen_list.data[slot])
+        {
+            sweeper_seen_list.data[slot] = false;
+            continue;
+        }
+
+        if(++sweeper_missed_list.data[slot] != SWEEPER_STALE_PASSES)
+            continue;
+
+        ipv4_t host = host_table_slot(sweeper_hosts, slot)->host;
+
+        sds ip_str = str_from_ipv4(host);
+        printf("[NOTICE] Device %s stopped answering, marked as stale\n", ip_str);
+        sdsfree(ip_str);
+
+        sweeper_stale_count++;
+        stats_gauge_set(STATS_GAUGE_STALE_HOSTS, sweeper_stale_count);
+
+        snmp_pipeline_submit_stale(host, true);
+    }
+
+    sweep_cache_mark_full_sweep();
+}
+
+/**
+ * @brief Rescans all targets slice by slice.
+ *
+ * @return true if the sweeper should stop.
+ */
+static bool sweeper_pass(void)
+{
+    /// onesixtyone sends all probes of a host back to back and then waits, the wait bounds the packet rate
+    int probe_count = snmp_credential_probe_count();
+    int wait_ms = (probe_count * 1000 + SWEEPER_MAX_PPS - 1) / SWEEPER_MAX_PPS;
+    uint64_t size = target_set_size(sweeper_target_set);
+    uint64_t start_us = stats_now_us();
+
+    for(uint64_t start = 0; start < size; start += SWEEPER_SLICE_SIZE)
+    {
+        /// Walks after traps go first, the rescan waits until the pipeline has caught up
+        while(snmp_pipeline_pending() > SWEEPER_MAX_PENDING)
+        {
+            if(sweeper_wait(100))
+                return true;
+        }
+
+        if(sweeper_wait(0))
+            return true;
+
+        target_set_t slice_set;
+        target_set_init(&slice_set);
+        target_set_slice(sweeper_target_set, start, SWEEPER_SLICE_SIZE, &slice_set);
+
+        ipv4_vec_t found_list;
+        vec_init(&found_list);
+        int status = snmp_network_scan_run(&sweeper_exec_path_str, &slice_set, wait_ms, SWEEPER_TAIL_MS, &found_list);
+
+        sweep_cache_mark_seen(&found_list);
+        for(int i = 0; i < found_list.size; i++)
+            sweeper_host_found(found_list.data[i]);
+
+        vec_free(&found_list);
+        target_set_free(&slice_set);
+
+        /// An incomplete rescan doesn't count, otherwise devices could be marked stale by mistake
+        if(status)
+        {
+            printf(KYELLOW "[WARNING] sweeper_pass: the rescan has been interrupted.\n" KNORMAL);
+            return sweeper_wait(SWEEPER_TAIL_MS);
+        }
+    }
+
+    sweeper_finish_pass();
+
+    printf("[NOTICE] Rescan finished in %.1f s, %d known devices, %d stale.\n",
+        (stats_now_us() - start_us) / 1e6, host_table_size(sweeper_hosts), sweeper_stale_count);
+
+    return false;
+}
+
+static void *sweeper_run(void *param)
+{
+    /// Lower the priority of the thread and of the onesixtyone processes it forks
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), SWEEPER_NICE);
+
+    while(!sweeper_wait(sweeper_interval_s * 1000))
+    {
+        if(sweeper_pass())
+            break;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the background rescan of the targets.
+ *
+ * Every interval_s seconds all targets are scanned again with at most SWEEPER_MAX_PPS probe packets per second.
+ * New devices are queued in the pipeline right away, devices which missed SWEEPER_STALE_PASSES rescans are marked
+ * stale in the database. The rescan runs at a lower priority and pauses while the pipeline is busy, so it doesn't
+ * delay the walks after traps.
+ *
+ * @param exec_path_str The path from the main application
+ * @param target_set the addresses to rescan, must not be changed until sweeper_shutdown.
+ * @param snmp_device_list the devices found by the discovery.
+ * @param interval_s seconds between two rescans, 0 disables the rescan.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+int sweeper_setup(sds* exec_path_str, target_set_t* target_set, ipv4_vec_t* snmp_device_list, int interval_s)
+{
+    if(interval_s <= 0)
+        return EXIT_SUCCESS;
+
+    sweeper_exec_path_str = sdsdup(*exec_path_str);
+    sweeper_target_set = target_set;
+    sweeper_interval_s = interval_s;
+    sweeper_stop = false;
+
+    /// Merges the ranges before the thread starts, the set is only read afterwards
+    target_set_size(target_set);
+
+    sweeper_hosts = host_table_init();
+    vec_init(&sweeper_missed_list);
+    vec_init(&sweeper_seen_list);
+
+    for(int i = 0; i < snmp_device_list->size; i++)
+    {
+        if(host_table_find_slot(sweeper_hosts, snmp_device_list->data[i]) < 0)
+            sweeper_add_host(snmp_device_list->data[i]);
+    }
+
+    if(pthread_create(&sweeper_thread, NULL, sweeper_run, NULL))
+    {
+        printf(KRED "[ERROR] sweeper_setup couldn't create the rescan thread.\n" KNORMAL);
+        sweeper_shutdown();
+        return EXIT_FAILURE;
+    }
+
+    sweeper_running = true;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Stops the background rescan, waits for the current slice to finish.
+ */
+void sweeper_shutdown(void)
+{
+    if(sweeper_running)
+    {
+        pthread_mutex_lock(&sweeper_mutex);
+        sweeper_stop = true;
+        pthread_cond_broadcast(&sweeper_wakeup);
+        pthread_mutex_unlock(&sweeper_mutex);
+
+        pthread_join(sweeper_thread, NULL);
+        sweeper_running = false;
+    }
+
+    if(sweeper_hosts != NULL)
+        host_table_destroy(sweeper_hosts);
+    sweeper_hosts = NULL;
+
+    vec_free(&sweeper_missed_list);
+    vec_free(&sweeper_seen_list);
+    sdsfree(sweeper_exec_path_str);
+    sweeper_exec_path_str = NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef SWEEPER_H
+#define SWEEPER_H
+
+#include "lib/sds.h"
+
+#include "ip.h"
+#include "target_set.h"
+
+/// Seconds between the starts of two background rescans, 0 disables them.
+#ifndef SWEEPER_INTERVAL
+#define SWEEPER_INTERVAL 600
+#endif
+
+/// Max probe packets per second of a rescan.
+#ifndef SWEEPER_MAX_PPS
+#define SWEEPER_MAX_PPS 50
+#endif
+
+/// Addresses scanned by one onesixtyone run, the rescan can only stop between two runs.
+#ifndef SWEEPER_SLICE_SIZE
+#define SWEEPER_SLICE_SIZE 256
+#endif
+
+/// Milliseconds onesixtyone waits for late responses at the end of a slice.
+#ifndef SWEEPER_TAIL_MS
+#define SWEEPER_TAIL_MS 1000
+#endif
+
+/// A device is marked stale after it missed this many complete rescans in a row.
+#ifndef SWEEPER_STALE_PASSES
+#define SWEEPER_STALE_PASSES 2
+#endif
+
+/// The rescan pauses while more hosts than this wait in the pipeline, e.g. after a burst of traps.
+#ifndef SWEEPER_MAX_PENDING
+#define SWEEPER_MAX_PENDING 4
+#endif
+
+/// Nice value of the rescan thread and its onesixtyone processes.
+#ifndef SWEEPER_NICE
+#define SWEEPER_NICE 10
+#endif
+
+int sweeper_setup(sds* exec_path_str, target_set_t* target_set, ipv4_vec_t* snmp_device_list, int interval_s);
+void sweeper_shutdown(void);
+
+#endif
@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "kcolor.h"
+#include "target_set.h"
+
+static int target_set_compare_range(const void *a, const void *b)
+{
+    const ipv4_range_t *range_a = a;
+    const ipv4_range_t *range_b = b;
+
+    if(range_a->first != range_b->first)
+        return range_a->first < range_b->first ? -1 : 1;
+
+    return 0;
+}
+
+/**
+ * @brief Sorts a range list and merges overlapping and adjacent ranges in place.
+ */
+static void target_set_merge(ipv4_range_vec_t *list)
+{
+    if(list->size == 0)
+        return;
+
+    qsort(list->data, list->size, sizeof(ipv4_range_t), target_set_compare_range);
+
+    int merged = 0;
+    for(int i = 1; i < list->size; i++)
+    {
+        ipv4_range_t *current = &list->data[merged];
+
+        if((uint64_t)list->data[i].first <= (uint64_t)current->last + 1)
+        {
+            if(list->data[i].last > current->last)
+                current->last = list->data[i].last;
+        }
+        else
+        {
+            list->data[++merged] = list->data[i];
+        }
+    }
+
+    list->size = merged + 1;
+}
+
+/**
+ * @brief Rebuilds range_list and offset_list after ranges have been added.
+ */
+static void target_set_normalize(target_set_t *set)
+{
+    if(!set->dirty)
+        return;
+
+    target_set_merge(&set->include_list);
+    target_set_merge(&set->exclude_list);
+
+    vec_clear(&set->range_list);
+    vec_clear(&set->offset_list);
+
+    /// Both lists are sorted, each include range is cut by the exclude ranges it overlaps
+    int exclude = 0;
+    uint64_t offset = 0;
+
+    for(int i = 0; i < set->include_list.size; i++)
+    {
+        uint64_t first = set->include_list.data[i].first;
+        uint64_t last = set->include_list.data[i].last;
+
+        while(exclude < set->exclude_list.size && set->exclude_list.data[exclude].last < first)
+            exclude++;
+
+        for(int e = exclude; e < set->exclude_list.size && set->exclude_list.data[e].first <= last && first <= last; e++)
+        {
+            if(set->exclude_list.data[e].first > first)
+            {
+                ipv4_range_t range = { (ipv4_t)first, set->exclude_list.data[e].first - 1 };
+                vec_push(&set->range_list, range);
+                vec_push(&set->offset_list, offset);
+                offset += (uint64_t)range.last - range.first + 1;
+            }
+
+            first = (uint64_t)set->exclude_list.data[e].last + 1;
+        }
+
+        if(first <= last)
+        {
+            ipv4_range_t range = { (ipv4_t)first, (ipv4_t)last };
+            vec_push(&set->range_list, range);
+            vec_push(&set->offset_list, offset);
+            offset += last - first + 1;
+        }
+    }
+
+    set->dirty = false;
+}
+
+/**
+ * @brief Parses "a.b.c.d", "a.b.c.d/prefix" or "a.b.c.d-e.f.g.h" into a range.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE)
+ */
+static int target_set_parse_range(sds target_str, ipv4_range_t *range)
+{
+    char *slash = strchr(target_str, '/');
+    char *dash = strchr(target_str, '-');
+    int prefix = 32;
+    struct in_addr address;
+
+    if(slash != NULL)
+    {
+        char *end;
+        prefix = (int)strtol(slash + 1, &end, 10);
+        if(*end != '\0' || end == slash + 1 || prefix < 0 || prefix > 32)
+            return EXIT_FAILURE;
+        *slash = '\0';
+    }
+    else if(dash != NULL)
+    {
+        *dash = '\0';
+        if(inet_pton(AF_INET, dash + 1, &address) != 1)
+            return EXIT_FAILURE;
+        range->last = ntohl(address.s_addr);
+    }
+
+    if(inet_pton(AF_INET, target_str, &address) != 1)
+        return EXIT_FAILURE;
+
+    range->first = ntohl(address.s_addr);
+
+    if(dash == NULL || slash != NULL)
+    {
+        uint32_t host_mask = prefix == 0 ? 0xFFFFFFFF : (prefix == 32 ? 0 : 0xFFFFFFFFu >> prefix);
+        range->first &= ~host_mask;
+        range->last = range->first | host_mask;
+    }
+
+    return range->first <= range->last ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void target_set_init(target_set_t *set)
+{
+    vec_init(&set->include_list);
+    vec_init(&set->exclude_list);
+    vec_init(&set->range_list);
+    vec_init(&set->offset_list);
+    set->dirty = false;
+}
+
+void target_set_free(target_set_t *set)
+{
+    vec_free(&set->include_list);
+    vec_free(&set->exclude_list);
+    vec_free(&set->range_list);
+    vec_free(&set->offset_list);
+    set->dirty = false;
+}
+
+/**
+ * @brief Adds the addresses first to last (inclusive) to the set.
+ */
+void target_set_add_range(target_set_t *set, ipv4_t first, ipv4_t last)
+{
+    ipv4_range_t range = { first, last };
+    vec_push(&set->include_list, range);
+    set->dirty = true;
+}
+
+/**
+ * @brief Removes the addresses first to last (inclusive) from the set, also if they are added later.
+ */
+void target_set_exclude_range(target_set_t *set, ipv4_t first, ipv4_t last)
+{
+    ipv4_range_t range = { first, last };
+    vec_push(&set->exclude_list, range);
+    set->dirty = true;
+}
+
+/**
+ * @brief Adds or excludes a comma separated list of targets.
+ *
+ * Each target is an address (192.168.0.1), a network (192.168.0.0/24) or a range (192.168.0.10-192.168.0.20).
+ *
+ * @param set the target set.
+ * @param targets the list of targets.
+ * @param exclude true to exclude the targets from the set.
+ * @return Status Code (0 = SUCESS, 1 = FAILURE), nothing is added if a target can't be parsed.
+ */
+int target_set_add_str(target_set_t *set, const char *targets, bool exclude)
+{
+    int count;
+    sds *tokens = sdssplitlen(targets, strlen(targets), ",", 1, &count);
+    ipv4_range_vec_t parsed_list;
+    vec_init(&parsed_list);
+    int status = tokens != NULL && count > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    for(int i = 0; status == EXIT_SUCCESS && i < count; i++)
+    {
+        ipv4_range_t range;
+        tokens[i] = sdstrim(tokens[i], " \t");
+
+        sds target_str = sdsdup(tokens[i]);
+        int parse_status = target_set_parse_range(target_str, &range);
+        sdsfree(target_str);
+
+        if(parse_status)
+        {
+            printf(KRED "[ERROR] target_set_add_str can't parse the target %s.\n" KNORMAL, tokens[i]);
+            status = EXIT_FAILURE;
+        }
+        else
+        {
+            vec_push(&parsed_list, range);
+        }
+    }
+
+    for(int i = 0; status == EXIT_SUCCESS && i < parsed_list.size; i++)
+    {
+        if(exclude)
+            target_set_exclude_range(set, parsed_list.data[i].first, parsed_list.data[i].last);
+        else
+            target_set_add_range(set, parsed_list.data[i].first, parsed_list.data[i].last);
+    }
+
+    vec_free(&parsed_list);
+    sdsfreesplitres(tokens, count);
+
+    return status;
+}
+
+/**
+ * @brief Returns the sorted, disjoint ranges of the set, the list must not be changed.
+ */
+ipv4_range_vec_t *target_set_ranges(target_set_t *set)
+{
+    target_set_normalize(set);
+    return &set->range_list;
+}
+
+/**
+ * @brief Returns the number of addresses in the set.
+ */
+uint64_t target_set_size(target_set_t *set)
+{
+    target_set_normalize(set);
+
+    if(set->range_list.size == 0)
+        return 0;
+
+    ipv4_range_t *last = &set->range_list.data[set->range_list.size - 1];
+    return set->offset_list.data[set->offset_list.size - 1] + ((uint64_t)last->last - last->first + 1);
+}
+
+/**
+ * @brief Returns the index of the range containing host, -1 if no range contains it.
+ */
+static int target_set_find(ipv4_range_vec_t *list, ipv4_t host)
+{
+    int low = 0;
+    int high = list->size - 1;
+
+    while(low <= high)
+    {
+        int middle = low + (high - low) / 2;
+
+        if(host < list->data[middle].first)
+            high = middle - 1;
+        else if(host > list->data[middle].last)
+            low = middle + 1;
+        else
+            return middle;
+    }
+
+    return -1;
+}
+
+bool target_set_contains(target_set_t *set, ipv4_t host)
+{
+    target_set_normalize(set);
+    return target_set_find(&set->range_list, host) >= 0;
+}
+
+/**
+ * @brief Returns true if host is in an excluded range, it must not be probed.
+ */
+bool target_set_excludes(target_set_t *set, ipv4_t host)
+{
+    target_set_normalize(set);
+    return target_set_find(&set->exclude_list, host) >= 0;
+}
+
+/**
+ * @brief Returns the position of host in the ascending order of the set, -1 if host isn't in the set.
+ */
+int64_t target_set_index_of(target_set_t *set, ipv4_t host)
+{
+    target_set_normalize(set);
+
+    int range = target_set_find(&set->range_list, host);
+    if(range < 0)
+        return -1;
+
+    return set->offset_list.data[range] + (host - set->range_list.data[range].first);
+}
+
+/**
+ * @brief Adds the addresses with the indexes start to start + count - 1 of set to slice_set.
+ *
+ * Used to scan a large set in parts, slice_set needs at most one range per range of set.
+ */
+void target_set_slice(target_set_t *set, uint64_t start, uint64_t count, target_set_t *slice_set)
+{
+    ipv4_range_vec_t *list = target_set_ranges(set);
+    uint64_t end = start + count;
+
+    for(int i = 0; i < list->size; i++)
+    {
+        uint64_t range_start = set->offset_list.data[i];
+        uint64_t range_end = range_start + ((uint64_t)list->data[i].last - list->data[i].first + 1);
+
+        if(range_end <= start || range_start >= end)
+            continue;
+
+        uint64_t first = start > range_start ? start - range_start : 0;
+        uint64_t last = (end < range_end ? end : range_end) - range_start - 1;
+        target_set_add_range(slice_set, list->data[i].first + (ipv4_t)first, list->data[i].first + (ipv4_t)last);
+    }
+}
+
+/**
+ * @brief Describes the set as a comma separated list of ranges.
+ *
+ * @return the description, needs to be freed with sdsfree.
+ */
+sds target_set_to_str(target_set_t *set)
+{
+    ipv4_range_vec_t *list = target_set_ranges(set);
+    sds set_str = sdsempty();
+
+    for(int i = 0; i < list->size; i++)
+    {
+        sds first_str = str_from_ipv4(list->data[i].first);
+        sds last_str = str_from_ipv4(list->data[i].last);
+
+        if(i > 0)
+            set_str = sdscat(set_str, ",");
+
+        if(list->data[i].first == list->data[i].last)
+            set_str = sdscatsds(set_str, first_str);
+        else
+            set_str = sdscatprintf(set_str, "%s-%s", first_str, last_str);
+
+        sdsfree(first_str);
+        sdsfree(last_str);
+    }
+
+    return set_str;
+}
+
+/**
+ * @brief Starts streaming the addresses of a set, the set must not be changed while iterating.
+ */
+void target_set_iter_init(target_set_iter_t *iter, target_set_t *set)
+{
+    iter->set = set;
+    iter->range = 0;
+    iter->next = 0;
+
+    ipv4_range_vec_t *list = target_set_ranges(set);
+    if(list->size > 0)
+        iter->next = list->data[0].first;
+}
+
+/**
+ * @brief Returns the next address of the set.
+ *
+ * @param iter an iterator started with target_set_iter_init.
+ * @param host the next address.
+ * @return false if all addresses have been returned.
+ */
+bool target_set_iter_next(target_set_iter_t *iter, ipv4_t *host)
+{
+    ipv4_range_vec_t *list = &iter->set->range_list;
+
+    if(iter->range >= list->size)
+        return false;
+
+    *host = iter->next;
+
+    if(iter->next == list->data[iter->range].last)
+    {
+        iter->range++;
+        if(iter->range < list->size)
+            iter->next = list->data[iter->range].first;
+    }
+    else
+    {
+        iter->next++;
+    }
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef TARGET_SET_H
+#define TARGET_SET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lib/sds.h"
+
+#include "ip.h"
+#include "vec.h"
+
+/**
+ * Inclusive range of IPv4 addresses.
+ */
+typedef struct
+{
+    ipv4_t first;
+    ipv4_t last;
+} ipv4_range_t;
+
+typedef vec_t(ipv4_range_t) ipv4_range_vec_t;
+
+/**
+ * Set of addresses to scan: included ranges minus excluded ranges.
+ *
+ * Ranges can be added in any order and may overlap. They are sorted and merged lazily, so the memory depends on the
+ * number of ranges, not on the number of addresses. The set is not thread safe.
+ */
+typedef struct
+{
+    ipv4_range_vec_t include_list;
+    ipv4_range_vec_t exclude_list;
+    /// Sorted, disjoint and non adjacent ranges of include_list minus exclude_list, valid if dirty is false.
+    ipv4_range_vec_t range_list;
+    /// Number of addresses in range_list before each range, to map addresses to indexes.
+    vec_t(uint64_t) offset_list;
+    bool dirty;
+} target_set_t;
+
+/**
+ * Streams the addresses of a target set in ascending order.
+ */
+typedef struct
+{
+    target_set_t *set;
+    int range;
+    ipv4_t next;
+} target_set_iter_t;
+
+void target_set_init(target_set_t *set);
+void target_set_free(target_set_t *set);
+void target_set_add_range(target_set_t *set, ipv4_t first, ipv4_t last);
+void target_set_exclude_range(target_set_t *set, ipv4_t first, ipv4_t last);
+int target_set_add_str(target_set_t *set, const char *targets, bool exclude);
+
+ipv4_range_vec_t *target_set_ranges(target_set_t *set);
+uint64_t target_set_size(target_set_t *set);
+bool target_set_contains(target_set_t *set, ipv4_t host);
+bool target_set_excludes(target_set_t *set, ipv4_t host);
+int64_t target_set_index_of(target_set_t *set, ipv4_t host);
+void target_set_slice(target_set_t *set, uint64_t start, uint64_t count, target_set_t *slice_set);
+sds target_set_to_str(target_set_t *set);
+
+void target_set_iter_init(target_set_iter_t *iter, target_set_t *set);
+bool target_set_iter_next(target_set_iter_t *iter, ipv4_t *host);
+
+#endif
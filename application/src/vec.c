@@ -0,0 +1,30 @@
+#include "vec.h"
+
+/// Capacity of a vector after its first allocation.
+#define VEC_MIN_CAPACITY 8
+
+/**
+ * @brief Grows the storage of a vector, used by vec_reserve.
+ *
+ * The capacity is doubled until min_capacity fits, so pushing is amortized O(1).
+ *
+ * @param data the current storage, can be NULL.
+ * @param capacity the current capacity, gets updated.
+ * @param min_capacity the number of elements that need to fit.
+ * @param element_size size of a single element.
+ * @return the new storage.
+ */
+void *vec_grow(void *data, int *capacity, int min_capacity, size_t element_size)
+{
+    if(min_capacity <= *capacity)
+        return data;
+
+    int new_capacity = *capacity > 0 ? *capacity : VEC_MIN_CAPACITY;
+    while(new_capacity < min_capacity)
+        new_capacity *= 2;
+
+    data = realloc(data, new_capacity * element_size);
+    *capacity = new_capacity;
+
+    return data;
+}
@@ -0,0 +1,45 @@
+#ifndef VEC_H
+#define VEC_H
+
+#include <stdlib.h>
+
+/**
+ * Typed growable array, elements are stored by value in one contiguous block.
+ *
+ * Example:
+ * typedef vec_t(ipv4_t) ipv4_vec_t;
+ * ipv4_vec_t list;
+ * vec_init(&list);
+ * vec_push(&list, ip);
+ * for(int i = 0; i < list.size; i++) print(list.data[i]);
+ * vec_free(&list);
+ */
+#define vec_t(T) struct { T *data; int size; int capacity; }
+
+/// Initializes an empty vector, doesn't allocate.
+#define vec_init(v) ((v)->data = NULL, (v)->size = 0, (v)->capacity = 0)
+
+/// Frees the storage of the vector, the elements themself need to be released before.
+#define vec_free(v) (free((v)->data), vec_init(v))
+
+/// Makes sure the vector can hold n elements without growing.
+#define vec_reserve(v, n) ((v)->data = vec_grow((v)->data, &(v)->capacity, (n), sizeof(*(v)->data)))
+
+/// Appends a copy of value.
+#define vec_push(v, value) (vec_reserve((v), (v)->size + 1), (v)->data[(v)->size++] = (value))
+
+/// Appends an uninitialized element and returns a pointer to it.
+#define vec_push_slot(v) (vec_reserve((v), (v)->size + 1), &(v)->data[(v)->size++])
+
+/// Removes element i by moving the last element into its place, O(1) but doesn't keep the order.
+#define vec_remove_swap(v, i) ((v)->data[(i)] = (v)->data[--(v)->size])
+
+/// Removes all elements but keeps the storage.
+#define vec_clear(v) ((v)->size = 0)
+
+/// Iterates over pointers to all elements.
+#define vec_each(v, ptr) for((ptr) = (v)->data; (ptr) < (v)->data + (v)->size; (ptr)++)
+
+void *vec_grow(void *data, int *capacity, int min_capacity, size_t element_size);
+
+#endif